@@ -1,14 +1,9 @@
 #version 450
 #extension GL_GOOGLE_include_directive : enable
 #include "tm_helpers.glsl"
+#include "frame_constants.glsl"
 
-layout(set = 0, binding = 0) uniform sampler2D litSampler;
-
-layout(set = 0, binding = 1) uniform ToneMappingUniforms {
-    float aperture;
-    float shutterSpeed;
-    float iso;
-} tmUbo;
+layout(set = 1, binding = 0) uniform sampler2D litSampler;
 
 layout(location = 0) in vec2 fragUV;
 
@@ -24,14 +19,8 @@ void main()
     // TONE MAPPING
     //---------------
 
-    // Calculate EV100
-    float ev100 = CalculateEV100FromPhysicalCamera(tmUbo.aperture, tmUbo.shutterSpeed,tmUbo.iso);
-
-    // Calculate exposure
-    float exposure = ConvertEV100ToExposure(ev100);
-
-    // Reinhard
-    vec3 mapped = Uncharted2ToneMapping(litColor * exposure);
+    // Exposure (EV100 from the physical camera, resolved on the CPU)
+    vec3 mapped = Uncharted2ToneMapping(litColor * frame.exposure);
 
     // Gamma Correction
     mapped = pow(mapped, vec3(1.0 / GAMMA));
@@ -0,0 +1,119 @@
+#ifndef CASCADES_GLSL
+#define CASCADES_GLSL
+
+// CASCADED SHADOWS
+//------------------
+// include after frame_constants.glsl, the cascades live in the frame constants
+// the shadow map is one layer per cascade, layer i covers view depths up to frame.cascadeSplits[i]
+
+// cascade of a world position, SHADOW_CASCADE_COUNT when it lies beyond the last one
+int SelectCascade(vec3 worldPos)
+{
+    float viewDepth = (frame.view * vec4(worldPos, 1.0)).z;
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+    {
+        if (viewDepth <= frame.cascadeSplits[i])
+            return i;
+    }
+    return SHADOW_CASCADE_COUNT;
+}
+
+// light space position of the cascade, xy = uv, z = depth, false when outside of it
+bool GetCascadeCoords(vec3 worldPos, int cascade, out vec3 coords)
+{
+    vec4 lightClip = frame.cascadeViewProj[cascade] * vec4(worldPos, 1.0);
+    vec3 proj = lightClip.xyz / lightClip.w;
+
+    coords = vec3(proj.xy * 0.5 + 0.5, proj.z);
+    return abs(proj.x) <= 1.0 && abs(proj.y) <= 1.0 && proj.z >= 0.0 && proj.z <= 1.0;
+}
+
+// 3x3 PCF, 1 = lit
+float CalculateShadow(vec3 worldPos, vec3 normal, sampler2DArray shadowMap)
+{
+    int cascade = SelectCascade(worldPos);
+    vec3 coords;
+    if (cascade >= SHADOW_CASCADE_COUNT || !GetCascadeCoords(worldPos, cascade, coords))
+        return 1.0;
+
+    // bias: smaller values reduce peter-panning but avoid being too large
+    vec3 L = normalize(-frame.lightDir);
+    float bias = max(0.0005 * (1.0 - dot(normal, L)), 0.00005);
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            vec2 sampleUV = coords.xy + vec2(x, y) * texelSize;
+            float sampledDepth = texture(shadowMap, vec3(sampleUV, float(cascade))).r;
+            shadow += (coords.z - bias) > sampledDepth ? 0.0 : 1.0;
+        }
+    }
+    return shadow / 9.0;
+}
+
+// single tap for ray marching, 1 = lit
+float SampleShadowVisibility(vec3 worldPos, sampler2DArray shadowMap)
+{
+    int cascade = SelectCascade(worldPos);
+    vec3 coords;
+    if (cascade >= SHADOW_CASCADE_COUNT || !GetCascadeCoords(worldPos, cascade, coords))
+        return 1.0;
+
+    float shadowDepth = texture(shadowMap, vec3(coords.xy, float(cascade))).r;
+    return (coords.z <= shadowDepth + 0.001) ? 1.0 : 0.0;
+}
+
+// visibility shared by every point of the segment a - b, 1 = lit, 0 = shadowed, -1 = mixed or unknown.
+// the light projection is orthographic, so the segment covers the uv rect & depth range of its end points.
+// minMaxPyramid holds the nearest & farthest shadow depth, level 0 is half the shadow map
+float ClassifyShadowSegment(vec3 a, vec3 b, sampler2DArray minMaxPyramid)
+{
+    // the view depth along a ray is monotonic, so equal cascades at the ends mean one cascade in between
+    int cascade = SelectCascade(a);
+    if (cascade != SelectCascade(b))
+        return -1.0;
+    if (cascade >= SHADOW_CASCADE_COUNT)
+        return 1.0;
+
+    vec3 coordsA, coordsB;
+    if (!GetCascadeCoords(a, cascade, coordsA) || !GetCascadeCoords(b, cascade, coordsB))
+        return -1.0;
+
+    vec2 uvMin = min(coordsA.xy, coordsB.xy);
+    vec2 uvMax = max(coordsA.xy, coordsB.xy);
+    vec2 depthRange = vec2(min(coordsA.z, coordsB.z), max(coordsA.z, coordsB.z));
+
+    // coarsest level with texels at least as large as the footprint, so 2x2 of them cover it
+    vec2 baseSize = vec2(textureSize(minMaxPyramid, 0).xy);
+    float footprint = max(max((uvMax.x - uvMin.x) * baseSize.x, (uvMax.y - uvMin.y) * baseSize.y), 1.0);
+    int level = min(int(ceil(log2(footprint))), textureQueryLevels(minMaxPyramid) - 1);
+
+    ivec2 levelSize = textureSize(minMaxPyramid, level).xy;
+    ivec2 texelMin = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 texelMax = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+    if (any(greaterThan(texelMax - texelMin, ivec2(1))))
+        return -1.0;
+
+    vec2 minMax = vec2(1.0, 0.0);
+    for (int y = texelMin.y; y <= texelMax.y; ++y)
+    {
+        for (int x = texelMin.x; x <= texelMax.x; ++x)
+        {
+            vec2 texel = texelFetch(minMaxPyramid, ivec3(x, y, cascade), level).rg;
+            minMax = vec2(min(minMax.x, texel.x), max(minMax.y, texel.y));
+        }
+    }
+
+    // same bias as SampleShadowVisibility
+    if (depthRange.y <= minMax.x + 0.001)
+        return 1.0;
+    if (depthRange.x > minMax.y + 0.001)
+        return 0.0;
+    return -1.0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CLUSTERS_GLSL
+#define CLUSTERS_GLSL
+
+// LIGHT CLUSTERS
+//------------------
+// include after frame_constants.glsl, keep in sync with LightClusterPass.
+// the view frustum is split in a camera aligned grid, xy follow the screen uv, z is split exponentially between
+// CLUSTER_NEAR & CLUSTER_FAR. The first & last slice reach to the camera & to infinity.
+// every cluster owns CLUSTER_MAX_LIGHTS slots in the index list, lights past that are dropped & the cluster is counted
+// as overflowing, see LightClusterPass::GetOverflowClusters.
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_MAX_LIGHTS 256
+
+const float CLUSTER_NEAR = 0.5;
+const float CLUSTER_FAR = 500.0;
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+    float intensity;
+    float radius;
+};
+
+uint ClusterIndex(uvec3 cluster)
+{
+    return (cluster.z * CLUSTER_GRID_Y + cluster.y) * CLUSTER_GRID_X + cluster.x;
+}
+
+// view depth of the near boundary of a slice
+float ClusterSliceDepth(uint slice)
+{
+    if (slice == 0u)
+        return 0.0;
+    if (slice >= CLUSTER_GRID_Z)
+        return 1e30;
+    return CLUSTER_NEAR * pow(CLUSTER_FAR / CLUSTER_NEAR, float(slice - 1u) / float(CLUSTER_GRID_Z - 2));
+}
+
+// inverse of ClusterSliceDepth
+uint ClusterSlice(float viewDepth)
+{
+    if (viewDepth < CLUSTER_NEAR)
+        return 0u;
+    float t = log(viewDepth / CLUSTER_NEAR) / log(CLUSTER_FAR / CLUSTER_NEAR);
+    return min(uint(t * float(CLUSTER_GRID_Z - 2)) + 1u, uint(CLUSTER_GRID_Z - 1));
+}
+
+uvec3 GetCluster(vec2 uv, float viewDepth)
+{
+    uvec2 tile = min(uvec2(uv * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    return uvec3(tile, ClusterSlice(viewDepth));
+}
+
+// view space ray through uv with a view depth of 1
+vec3 ClusterViewRay(vec2 uv)
+{
+    vec4 farView = frame.invProj * vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    return farView.xyz / farView.w / (farView.z / farView.w);
+}
+
+#endif
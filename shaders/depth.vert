@@ -1,10 +1,6 @@
 #version 450
-
-layout(set = 0,binding = 0) uniform UniformBufferObject 
-{
-    mat4 view;
-    mat4 proj;
-} ubo;
+#extension GL_GOOGLE_include_directive : enable
+#include "frame_constants.glsl"
 
 layout(push_constant) uniform pushConstant 
 {
@@ -20,5 +16,5 @@ layout(location = 5) in vec3 inBitangent;
 
 void main() 
 {
-    gl_Position = ubo.proj * ubo.view * ps.model * vec4(inPosition, 1.0);
+    gl_Position = frame.viewProj * ps.model * vec4(inPosition, 1.0);
 }
\ No newline at end of file
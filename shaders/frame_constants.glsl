@@ -0,0 +1,28 @@
+
+// FRAME CONSTANTS
+//------------------
+// written once per frame by FrameConstants and bound at set 0 by every pass
+#define SHADOW_CASCADE_COUNT 4
+
+layout(set = 0, binding = 0) uniform FrameConstantsUBO
+{
+    mat4 view;
+    mat4 proj;
+    mat4 invView;
+    mat4 invProj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    mat4 prevViewProj; // of the previous frame, for reprojection
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 cascadeSplits; // view space far distance of every cascade
+
+    vec4 cameraPos;
+    vec4 viewport; // width, height, 1 / width, 1 / height
+
+    vec3 lightDir;
+    float lightIntensity;
+    vec3 lightColor;
+    float exposure;
+
+    uint pointLightCount;
+} frame;
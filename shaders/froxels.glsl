@@ -0,0 +1,93 @@
+#ifndef FROXELS_GLSL
+#define FROXELS_GLSL
+
+#include "volumetric_helpers.glsl"
+
+// FROXELS
+//------------------
+// include after frame_constants.glsl.
+// the fog volume is a camera aligned grid, xy follow the screen uv, z is split exponentially between froxelNear & froxelFar.
+// the low resolution ray march shares the settings & the fog model
+
+// pipeline variants, see VolumetricPass::CreatePipeline
+layout(constant_id = 0) const uint VOLUMETRIC_MODE = 0;   // 0 = froxels, 1 = ray march
+layout(constant_id = 1) const bool USE_MULTIPLE_SCATTERING = true;
+layout(constant_id = 2) const uint MARCH_STEPS = 32;
+layout(constant_id = 3) const bool USE_SKIPPING = true;   // empty space skipping of the ray march
+
+layout(set = 1, binding = 3) uniform VolumetricsUBO
+{
+    uvec4 gridSize; // xyz = froxels
+
+    float fogDensity;
+    float froxelNear;
+    float froxelFar;
+    float fogPhaseK; // Schlick phase of the fog
+
+    float rayStrength;
+    float rayDensity;
+    float multiScatterStrength;
+    uint frameCounter; // moves the jitter every frame
+
+    uvec2 marchSize;  // low resolution ray march
+    uint isHistoryValid;
+    float historyWeight;
+} ubo;
+
+// light scattered towards the camera per unit length, visibility = shadow of the directional light
+vec3 FogInScattering(vec3 viewDir, float visibility)
+{
+    vec3 lightDir = normalize(frame.lightDir);
+    vec3 light = frame.lightColor * frame.lightIntensity;
+
+    // fog
+    float cosTheta = dot(viewDir, lightDir);
+    float phase = SchlickPhase(cosTheta, ubo.fogPhaseK);
+
+    // god rays, a narrow forward lobe towards the light
+    float cosSun = -cosTheta;
+    float directness = pow(clamp(cosSun * 2.0, 0.0, 1.0), 3.0);
+    phase += HenyeyGreensteinPhase(cosSun, 0.95) * (1.0 + directness * 2.0) * ubo.rayDensity * ubo.rayStrength;
+
+    vec3 inScattering = light * ubo.fogDensity * visibility * phase;
+
+    // light scattered more than once also reaches the shadowed fog, approximated as isotropic
+    if (USE_MULTIPLE_SCATTERING)
+        inScattering += light * ubo.fogDensity * ubo.multiScatterStrength / (4.0 * PI);
+
+    return inScattering;
+}
+
+// view depth at slice coordinate t, 0 = froxelNear, 1 = froxelFar
+float FroxelSliceDepth(float t)
+{
+    return ubo.froxelNear * pow(ubo.froxelFar / ubo.froxelNear, t);
+}
+
+// inverse of FroxelSliceDepth
+float FroxelSliceCoord(float viewDepth)
+{
+    return log(max(viewDepth, ubo.froxelNear) / ubo.froxelNear) / log(ubo.froxelFar / ubo.froxelNear);
+}
+
+// view space ray through uv with a view depth of 1
+vec3 FroxelViewRay(vec2 uv)
+{
+    vec4 farView = frame.invProj * vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    return farView.xyz / farView.w / (farView.z / farView.w);
+}
+
+vec3 FroxelToWorld(vec2 uv, float viewDepth)
+{
+    vec3 viewPos = FroxelViewRay(uv) * viewDepth;
+    return (frame.invView * vec4(viewPos, 1.0)).xyz;
+}
+
+// view depth of a depth buffer sample
+float LinearViewDepth(vec2 uv, float depth)
+{
+    vec4 viewPos = frame.invProj * vec4(uv * 2.0 - 1.0, depth, 1.0);
+    return viewPos.z / viewPos.w;
+}
+
+#endif
@@ -0,0 +1,32 @@
+// gbuffer.glsl
+#ifndef GBUFFER_GLSL
+#define GBUFFER_GLSL
+
+// G-BUFFER PACKING
+//------------------
+// albedo   RGBA8_SRGB  rgb albedo
+// normal   RG16_SFLOAT octahedral world normal
+// specular RG8_UNORM   r = metallic, g = roughness
+// the world position is not stored, it is reconstructed from the depth buffer with GetWorldPositionFromDepth
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector -> [-1, 1]^2
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+}
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+#endif
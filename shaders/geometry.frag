@@ -1,8 +1,8 @@
 #version 450
+#extension GL_GOOGLE_include_directive : enable
+#include "gbuffer.glsl"
 
 
-
-layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inUV;
 layout(location = 3) in vec3 inNormal;
@@ -11,9 +11,8 @@ layout(location = 5) in vec3 inBitangent;
 layout(early_fragment_tests) in;
 
 layout(location = 0) out vec4 outAlbedo;
-layout(location = 1) out vec4 outNormal;
-layout(location = 2) out vec4 outSpecular;
-layout(location = 3) out vec4 outWorld;
+layout(location = 1) out vec2 outNormal;
+layout(location = 2) out vec2 outSpecular;
 
 layout(set = 1, binding = 0) uniform sampler2D albedoSampler;
 layout(set = 1, binding = 1) uniform sampler2D normalSampler;
@@ -34,13 +33,9 @@ void main()
     vec3 sampledNormal = texture(normalSampler, inUV).rgb * 2.0 - 1.0;
     vec3 normal = normalize(tangentSpace * sampledNormal);
     
-    outNormal = vec4(normal * 0.5 + 0.5, 1.0);
+    outNormal = EncodeOctahedral(normal);
 
-    // specular
+    // specular, gltf stores roughness in g & metallic in b
     vec3 spec = texture(specularSampler, inUV).rgb;
-    outSpecular.b = spec.b;
-    outSpecular.g = spec.g;
-
-    // world position
-    outWorld = vec4(inPosition, 1.0);
+    outSpecular = vec2(spec.b, spec.g);
 }
\ No newline at end of file
@@ -1,10 +1,6 @@
 #version 450
-
-layout(set = 0, binding = 0) uniform UniformBufferObject 
-{
-    mat4 view;
-    mat4 proj;
-} ubo;
+#extension GL_GOOGLE_include_directive : enable
+#include "frame_constants.glsl"
 
 layout(push_constant) uniform pushConstant 
 {
@@ -29,7 +25,7 @@ layout(location = 5) out vec3 outBitangent;
 
 void main() 
 {
-    gl_Position = ubo.proj * ubo.view * ps.model * vec4(inPosition, 1.0);
+    gl_Position = frame.viewProj * ps.model * vec4(inPosition, 1.0);
     
     outPosition = (ps.model * vec4(inPosition, 1.0)).rgb;
     outColor = inColor;
@@ -1,18 +1,15 @@
 #version 450
-
-layout(set = 0,binding = 0) uniform LightMatrixUBO  
-{
-    mat4 proj;
-    mat4 view;
-} ubo;
+#extension GL_GOOGLE_include_directive : enable
+#include "frame_constants.glsl"
 
 
 layout(push_constant) uniform PushConstant {
     mat4 model;
+    uint cascade;
 } pc;
 
 layout(location = 0) in vec3 inPosition;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * pc.model * vec4(inPosition, 1.0);
+    gl_Position = frame.cascadeViewProj[pc.cascade] * pc.model * vec4(inPosition, 1.0);
 }
\ No newline at end of file
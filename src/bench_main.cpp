@@ -0,0 +1,31 @@
+#include "core/Benchmark.h"
+#include <iostream>
+#include <stdexcept>
+
+int main(int argc, char* argv[])
+{
+	cat::Benchmark::Options options{};
+	try
+	{
+		options = cat::Benchmark::ParseArguments({ argv + 1, argv + argc });
+	}
+	catch (const std::invalid_argument& e)
+	{
+		std::cerr << e.what() << std::endl;
+		cat::Benchmark::OutputUsage();
+		return cat::Benchmark::EXIT_BAD_ARGUMENTS;
+	}
+
+	try
+	{
+		cat::Benchmark benchmark{ options };
+		benchmark.Run();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return cat::Benchmark::EXIT_FAILED;
+	}
+
+	return cat::Benchmark::EXIT_OK;
+}
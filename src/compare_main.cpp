@@ -0,0 +1,72 @@
+#include "vulkan/utils/PerformanceComparison.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Diffs two catnip_bench CSVs, exits with 1 when a metric regressed, see PerformanceComparison
+namespace
+{
+	void OutputUsage()
+	{
+		std::cout << "usage: catnip_compare <baseline.csv> <candidate.csv> [options]" << std::endl;
+		std::cout << "\t--threshold <percent>\t slower than this fails, " << cat::PerformanceComparison::DEFAULT_THRESHOLD_PERCENT << std::endl;
+		std::cout << "\t--min-ms <ms>\t\t smaller differences never fail, " << cat::PerformanceComparison::DEFAULT_MIN_DIFFERENCE_MS << std::endl;
+		std::cout << "\t--metric <column>\t compared CSV column, repeatable, the frame & pass times by default" << std::endl;
+		std::cout << "exit codes: 0 no regression, 1 regressed, 2 bad arguments, unreadable CSV or a metric missing from a run" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	constexpr int EXIT_REGRESSED = 1;
+	constexpr int EXIT_BAD_ARGUMENTS = 2;
+
+	std::vector<std::string> files;
+	std::vector<std::string> metrics;
+	double thresholdPercent = cat::PerformanceComparison::DEFAULT_THRESHOLD_PERCENT;
+	double minDifferenceMs = cat::PerformanceComparison::DEFAULT_MIN_DIFFERENCE_MS;
+
+	try
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (argument == "--threshold" && hasValue) thresholdPercent = std::stod(argv[++i]);
+			else if (argument == "--min-ms" && hasValue) minDifferenceMs = std::stod(argv[++i]);
+			else if (argument == "--metric" && hasValue) metrics.push_back(argv[++i]);
+			else if (argument.rfind("--", 0) == 0) throw std::invalid_argument("unknown option or missing value " + argument);
+			else files.push_back(argument);
+		}
+		if (files.size() != 2)
+			throw std::invalid_argument("expected a baseline & a candidate CSV");
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		OutputUsage();
+		return EXIT_BAD_ARGUMENTS;
+	}
+
+	try
+	{
+		const cat::PerformanceComparison comparison{ files[0], files[1] };
+		if (metrics.empty())
+			metrics = comparison.GetDefaultMetrics();
+		const auto results = comparison.Compare(metrics, thresholdPercent, minDifferenceMs);
+		cat::PerformanceComparison::OutputResults(results, thresholdPercent);
+
+		for (const auto& result : results)
+		{
+			if (result.isRegression) return EXIT_REGRESSED;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_BAD_ARGUMENTS;
+	}
+
+	return EXIT_SUCCESS;
+}
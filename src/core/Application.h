@@ -19,6 +19,8 @@ public:
 
 		while (!glfwWindowShouldClose(window.GetWindow()))
 		{
+			renderer.WaitForNextFrame(); // paces the loop, the input is sampled right after
+
 			auto currentTime = clock::now();
 			std::chrono::duration<float> delta = currentTime - lastTime;
 			lastTime = currentTime;
@@ -0,0 +1,173 @@
+#include "Benchmark.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace cat
+{
+	namespace
+	{
+		uint32_t ParseCount(const std::string& option, const std::string& value)
+		{
+			size_t end = 0;
+			unsigned long count = 0;
+			try
+			{
+				count = std::stoul(value, &end);
+			}
+			catch (const std::exception&)
+			{
+				end = 0;
+			}
+			if (end == 0 || end != value.size() || value[0] == '-')
+				throw std::invalid_argument(option + " expects a positive number, got \"" + value + "\"");
+			return static_cast<uint32_t>(count);
+		}
+	}
+
+	// Methods
+	//--------------------
+	Benchmark::Options Benchmark::ParseArguments(const std::vector<std::string>& arguments)
+	{
+		Options options{};
+		for (size_t i{ 0 }; i < arguments.size(); ++i)
+		{
+			const std::string& option = arguments[i];
+			const auto nextValue = [&]() -> const std::string&
+				{
+					if (i + 1 >= arguments.size())
+						throw std::invalid_argument(option + " expects a value");
+					return arguments[++i];
+				};
+
+			// OUTPUT
+			if (option == "--width") options.width = static_cast<int>(ParseCount(option, nextValue()));
+			else if (option == "--height") options.height = static_cast<int>(ParseCount(option, nextValue()));
+			else if (option == "--scene") options.scene = nextValue();
+			else if (option == "--frames") options.frames = ParseCount(option, nextValue());
+			else if (option == "--warmup") options.warmupFrames = ParseCount(option, nextValue());
+			else if (option == "--output") options.output = nextValue();
+			else if (option == "--camera-path") options.cameraPath = nextValue();
+			else if (option == "--frames-in-flight") options.framesInFlight = ParseCount(option, nextValue());
+			else if (option == "--fence-timeout") options.fenceTimeoutSeconds = ParseCount(option, nextValue());
+
+			// PASS TOGGLES
+			else if (option == "--no-occlusion-culling") options.useOcclusionCulling = false;
+			else if (option == "--no-shadow-cache") options.useShadowCache = false;
+			else if (option == "--no-async-compute") options.useAsyncCompute = false;
+			else if (option == "--no-multi-scattering") options.useMultiScattering = false;
+			else if (option == "--no-empty-space-skipping") options.volumetrics.useEmptySpaceSkipping = false;
+			else if (option == "--march-steps") options.volumetrics.marchSteps = ParseCount(option, nextValue());
+			else if (option == "--point-lights") options.pointLights = static_cast<int>(ParseCount(option, nextValue()));
+			else if (option == "--volumetrics")
+			{
+				const std::string& mode = nextValue();
+				if (mode == "froxels") options.volumetrics.mode = VolumetricPass::Mode::Froxels;
+				else if (mode == "half") options.volumetrics = { VolumetricPass::Mode::RayMarch, 2, options.volumetrics.marchSteps, options.volumetrics.useEmptySpaceSkipping };
+				else if (mode == "quarter") options.volumetrics = { VolumetricPass::Mode::RayMarch, 4, options.volumetrics.marchSteps, options.volumetrics.useEmptySpaceSkipping };
+				else throw std::invalid_argument("--volumetrics expects froxels, half or quarter, got \"" + mode + "\"");
+			}
+			else throw std::invalid_argument("unknown option " + option);
+		}
+
+		// VALIDATION
+		if (options.width == 0 || options.height == 0)
+			throw std::invalid_argument("--width & --height have to be at least 1");
+		if (options.framesInFlight == 0 || options.framesInFlight > MAX_FRAMES_IN_FLIGHT)
+			throw std::invalid_argument("--frames-in-flight has to be 1 - " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+		if (options.fenceTimeoutSeconds == 0)
+			throw std::invalid_argument("--fence-timeout has to be at least 1");
+		if (options.volumetrics.marchSteps < 4 || options.volumetrics.marchSteps > 256)
+			throw std::invalid_argument("--march-steps has to be 4 - 256");
+		if (std::find(Renderer::SCENE_NAMES.begin(), Renderer::SCENE_NAMES.end(), options.scene) == Renderer::SCENE_NAMES.end())
+			throw std::invalid_argument("unknown scene " + options.scene);
+
+		return options;
+	}
+
+	void Benchmark::OutputUsage()
+	{
+		std::cout << "usage: catnip_bench [options]" << std::endl;
+		std::cout << "\t--width <px>, --height <px>\t\t render resolution, 1920 x 1080" << std::endl;
+		std::cout << "\t--scene <name>\t\t\t\t one of:";
+		for (const char* name : Renderer::SCENE_NAMES) std::cout << " " << name;
+		std::cout << std::endl;
+		std::cout << "\t--camera-path <path>\t\t\t replays a path recorded with R, see CameraPath" << std::endl;
+		std::cout << "\t--frames <n>\t\t\t\t recorded frames, the whole camera path or " << DEFAULT_FRAMES << std::endl;
+		std::cout << "\t--warmup <n>\t\t\t\t frames rendered before recording, 30" << std::endl;
+		std::cout << "\t--output <path>\t\t\t\t the CSV, performance.csv" << std::endl;
+		std::cout << "\t--frames-in-flight <n>\t\t\t 1 - " << MAX_FRAMES_IN_FLIGHT << std::endl;
+		std::cout << "\t--fence-timeout <s>\t\t\t a frame taking longer fails the run, 60" << std::endl;
+		std::cout << "\t--no-occlusion-culling, --no-shadow-cache, --no-async-compute, --no-multi-scattering" << std::endl;
+		std::cout << "\t--volumetrics froxels|half|quarter, --march-steps <4 - 256>, --no-empty-space-skipping" << std::endl;
+		std::cout << "\t--point-lights <n>\t\t\t random point lights added to the scene" << std::endl;
+		std::cout << "exit codes: " << EXIT_OK << " done, " << EXIT_FAILED << " the renderer failed, " << EXIT_BAD_ARGUMENTS << " bad arguments" << std::endl;
+	}
+
+	void Benchmark::Run()
+	{
+		// loaded first, a bad path fails before the scene is
+		CameraPath cameraPath{};
+		if (!m_Options.cameraPath.empty())
+			cameraPath = CameraPath::Load(m_Options.cameraPath);
+
+		uint32_t frames = m_Options.frames;
+		if (frames == 0)
+			frames = cameraPath.IsEmpty() ? DEFAULT_FRAMES : static_cast<uint32_t>(std::ceil(cameraPath.GetDuration() / FIXED_DELTA_TIME)) + 1;
+
+		Window window{ m_Options.width, m_Options.height };
+		Renderer renderer{ window };
+
+		// SETUP
+		//-----------------
+		renderer.SelectScene(m_Options.scene);
+		renderer.AddRandomPointLights(m_Options.pointLights);
+		renderer.SetUseAsyncCompute(m_Options.useAsyncCompute);
+		renderer.GetHiZPass().SetOcclusionCulling(m_Options.useOcclusionCulling);
+		renderer.GetShadowPass().SetUseCache(m_Options.useShadowCache);
+		renderer.GetVolumetricPass().SetUseMultiScattering(m_Options.useMultiScattering);
+		renderer.SetVolumetricSettings(m_Options.volumetrics);
+
+		// unpaced, nothing is shown so there is no refresh rate to pace to
+		FramePacer::Settings pacing = FramePacer::GetProfileSettings(FramePacer::Profile::MaxThroughput, 0);
+		pacing.framesInFlight = m_Options.framesInFlight;
+		pacing.fenceTimeoutNs = static_cast<uint64_t>(m_Options.fenceTimeoutSeconds) * 1'000'000'000;
+		renderer.ApplyFramePacing(pacing);
+
+		// FRAMES
+		//-----------------
+		const auto runStart = std::chrono::high_resolution_clock::now();
+		PerformanceTimer& timer = renderer.GetPerformanceTimer();
+		timer.StopRecording();
+		renderer.SetPerformanceCsvPath({});
+
+		// the warmup flies the path too, the recorded frames replay it from the start
+		if (!cameraPath.IsEmpty())
+			renderer.StartCameraReplay(cameraPath);
+
+		for (uint32_t frame{ 0 }; frame < m_Options.warmupFrames + frames; ++frame)
+		{
+			if (frame == m_Options.warmupFrames)
+			{
+				if (!cameraPath.IsEmpty())
+					renderer.StartCameraReplay(cameraPath);
+				timer.StartRecording(frames);
+			}
+
+			renderer.WaitForNextFrame();
+			renderer.Update(FIXED_DELTA_TIME);
+			renderer.Render();
+		}
+
+		timer.StopRecording();
+		timer.SaveToCSV(m_Options.output);
+
+		const double runSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStart).count();
+		std::cout << "Benchmark: " << frames << " frames of " << m_Options.scene << " at " << m_Options.width << "x" << m_Options.height
+			<< " recorded after " << m_Options.warmupFrames << " warmup frames in " << runSeconds << " s, written to " << m_Options.output << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Window.h"
+
+// std
+#include <string>
+#include <vector>
+
+namespace cat
+{
+	// Renders a fixed number of frames of a scene headless & writes the PerformanceTimer CSV, see bench_main.cpp.
+	//	- no window, surface or swapchain, so it runs on display-less machines & software rasterizers like lavapipe,
+	//	- every frame advances the scene by the same FIXED_DELTA_TIME, a camera path is replayed at the same step,
+	//	  so two runs of the same options render the same frames,
+	//	- the warmup frames are rendered but not recorded, they cover the first uploads & pipeline warmup.
+	class Benchmark final
+	{
+	public:
+		static constexpr float FIXED_DELTA_TIME = CameraPath::REPLAY_TIME_STEP;
+		static constexpr uint32_t DEFAULT_FRAMES = 500;
+
+		// exit codes
+		static constexpr int EXIT_OK = 0;
+		static constexpr int EXIT_FAILED = 1;			// the renderer threw
+		static constexpr int EXIT_BAD_ARGUMENTS = 2;
+
+		struct Options
+		{
+			int width = 1920;
+			int height = 1080;
+			std::string scene = "sponza";
+			uint32_t frames = 0;			// 0 records the whole camera path, or DEFAULT_FRAMES without one
+			uint32_t warmupFrames = 30;
+			std::string output = "performance.csv";
+			std::string cameraPath{};		// see CameraPath, the camera stands still without one
+			uint32_t framesInFlight = MAX_FRAMES_IN_FLIGHT;
+			uint32_t fenceTimeoutSeconds = 60;	// software rasterizers & high resolutions take far longer per frame than the interactive 5 s
+
+			// pass toggles, the interactive defaults
+			bool useOcclusionCulling = true;
+			bool useShadowCache = true;
+			bool useAsyncCompute = true;
+			bool useMultiScattering = true;
+			VolumetricPass::Settings volumetrics{};
+			int pointLights = 0;
+		};
+
+		// CTOR & DTOR
+		//--------------------
+		explicit Benchmark(const Options& options) : m_Options{ options } {}
+
+		// Methods
+		//--------------------
+		// throws std::invalid_argument on an unknown or malformed option
+		static Options ParseArguments(const std::vector<std::string>& arguments);
+		static void OutputUsage();
+
+		void Run();
+
+	private:
+		Options m_Options;
+	};
+}
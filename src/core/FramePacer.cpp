@@ -0,0 +1,178 @@
+#include "FramePacer.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vulkan/vk_enum_string_helper.h>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	FramePacer::FramePacer(Device& device, SwapChain& swapChain, const Settings& settings)
+		: m_Device{ device }, m_SwapChain{ swapChain }
+	{
+		SetSettings(settings);
+	}
+
+
+	// Methods
+	//--------------------
+	FramePacer::Settings FramePacer::GetProfileSettings(Profile profile, int refreshRate)
+	{
+		Settings settings{};
+		switch (profile)
+		{
+		case Profile::LowLatency:
+			settings.framesInFlight = 1;
+			settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			settings.targetFrameMs = refreshRate > 0 ? 1000.0 / refreshRate : 0.0;
+			break;
+		case Profile::MaxThroughput:
+			settings.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+			settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			settings.targetFrameMs = 0.0;
+			break;
+		}
+		return settings;
+	}
+
+	void FramePacer::WaitForFrame(uint32_t frameIndex)
+	{
+		// WAIT FOR THE SLOT
+		Slot& slot = m_Slots[frameIndex];
+		if (slot.isPending)
+		{
+			const VkResult result = vkWaitForFences(m_Device.GetDevice(), 1, m_SwapChain.GetInFlightFences(static_cast<uint16_t>(frameIndex)), VK_TRUE, m_Settings.fenceTimeoutNs);
+			if (result == VK_TIMEOUT)
+				throw std::runtime_error("failed to wait for the frame fence, the GPU did not finish a frame within " + std::to_string(m_Settings.fenceTimeoutNs / 1'000'000'000) + " seconds!");
+			if (result != VK_SUCCESS)
+				throw std::runtime_error("failed to wait for the frame fence!" + std::string(string_VkResult(result)));
+		}
+		PollFences();
+
+		// JUST IN TIME INPUT, sleep so the frame is sampled as late as the prediction allows
+		Clock::time_point now = Clock::now();
+		double sleepMs = 0.0;
+		if (m_Settings.targetFrameMs > 0.0)
+		{
+			const auto target = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_Settings.targetFrameMs));
+			const auto predicted = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_PredictedLatencyMs + MARGIN_MS));
+
+			// a missed deadline restarts the cadence from the earliest one this frame can make
+			m_Deadline += target;
+			m_Deadline = std::max(m_Deadline, now + predicted);
+
+			const Clock::time_point wakeTime = m_Deadline - predicted;
+			if (wakeTime > now)
+			{
+				SleepUntil(wakeTime);
+				sleepMs = std::chrono::duration<double, std::milli>(Clock::now() - now).count();
+				now = Clock::now();
+			}
+		}
+
+		// INPUT SAMPLED
+		slot.inputTime = now;
+		if (m_LastInput != Clock::time_point{})
+		{
+			m_LastIntervalMs = std::chrono::duration<double, std::milli>(now - m_LastInput).count();
+			m_Intervals.Add(m_LastIntervalMs);
+		}
+		m_LastInput = now;
+		m_LastSleepMs = sleepMs;
+		m_Sleeps.Add(sleepMs);
+	}
+
+	void FramePacer::EndFrame(uint32_t frameIndex)
+	{
+		m_Slots[frameIndex].isPending = true;
+	}
+
+
+	// Getters & Setters
+	//--------------------
+	void FramePacer::SetSettings(const Settings& settings)
+	{
+		m_Settings = settings;
+		m_Settings.framesInFlight = std::clamp<uint32_t>(settings.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+
+		m_Slots = {};
+		m_Deadline = {};
+		m_LastInput = {};
+		m_PredictedLatencyMs = 0.0;
+		m_Latencies.Clear();
+		m_Intervals.Clear();
+		m_Sleeps.Clear();
+	}
+
+	FramePacer::Stats FramePacer::GetStats() const
+	{
+		const auto average = [](const std::vector<double>& values)
+			{
+				return values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+			};
+
+		Stats stats{};
+		stats.avgLatencyMs = average(m_Latencies.values);
+		stats.maxLatencyMs = m_Latencies.values.empty() ? 0.0 : *std::max_element(m_Latencies.values.begin(), m_Latencies.values.end());
+		stats.avgIntervalMs = average(m_Intervals.values);
+		stats.avgSleepMs = average(m_Sleeps.values);
+
+		double variance = 0.0;
+		for (double interval : m_Intervals.values)
+		{
+			variance += (interval - stats.avgIntervalMs) * (interval - stats.avgIntervalMs);
+		}
+		stats.jitterMs = m_Intervals.values.empty() ? 0.0 : std::sqrt(variance / static_cast<double>(m_Intervals.values.size()));
+		return stats;
+	}
+
+
+	// Private methods
+	//--------------------
+	void FramePacer::PollFences()
+	{
+		// a fence that signaled before this poll is counted as signaled now, the latency can only be overestimated
+		const Clock::time_point now = Clock::now();
+		for (uint32_t frameIndex{ 0 }; frameIndex < m_Settings.framesInFlight; ++frameIndex)
+		{
+			Slot& slot = m_Slots[frameIndex];
+			if (!slot.isPending || vkGetFenceStatus(m_Device.GetDevice(), *m_SwapChain.GetInFlightFences(static_cast<uint16_t>(frameIndex))) != VK_SUCCESS)
+				continue;
+
+			slot.isPending = false;
+			m_LastLatencyMs = std::chrono::duration<double, std::milli>(now - slot.inputTime).count();
+			m_Latencies.Add(m_LastLatencyMs);
+
+			// a slower frame raises the prediction at once so the next deadline is not missed, faster ones lower it slowly
+			m_PredictedLatencyMs = std::max(m_LastLatencyMs, m_PredictedLatencyMs * 0.95 + m_LastLatencyMs * 0.05);
+		}
+	}
+
+	void FramePacer::SleepUntil(Clock::time_point time)
+	{
+		// the OS sleep overshoots by up to a scheduler tick, the last stretch is spun
+		constexpr auto spinTime = std::chrono::milliseconds(2);
+		if (time - Clock::now() > spinTime)
+			std::this_thread::sleep_until(time - spinTime);
+
+		while (Clock::now() < time)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void FramePacer::Samples::Add(double value)
+	{
+		if (values.size() < STATS_WINDOW)
+			values.push_back(value);
+		else
+			values[next] = value;
+		next = (next + 1) % STATS_WINDOW;
+	}
+}
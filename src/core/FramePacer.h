@@ -0,0 +1,121 @@
+#pragma once
+
+#include "../vulkan/SwapChain.h"
+
+// std
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace cat
+{
+	// Paces the main loop & measures how long input takes to reach the GPU's finished frame.
+	//	- waits for the fence of the frame slot about to be reused, a GPU that stops finishing frames throws instead of hanging,
+	//	- with a target frame time it sleeps before the input is sampled, so the frame finishes just before its deadline
+	//	  instead of queuing behind the frames in flight,
+	//	- latency is input sampled -> the frame's fence seen signaled, the scanout after it is not visible without present timing.
+	class FramePacer final
+	{
+	public:
+		// chosen per deployment, see GetProfileSettings
+		enum class Profile
+		{
+			LowLatency,		// a single frame in flight, mailbox & paced to the refresh rate
+			MaxThroughput	// every frame in flight, immediate & unpaced
+		};
+
+		struct Settings
+		{
+			uint32_t framesInFlight = 2;									// 1 - MAX_FRAMES_IN_FLIGHT
+			VkPresentModeKHR presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;	// FIFO when unsupported
+			double targetFrameMs = 0.0;										// 0 runs unpaced
+			uint64_t fenceTimeoutNs = 5'000'000'000;						// a frame taking longer throws, the GPU is taken as hung
+		};
+
+		// over the last STATS_WINDOW frames
+		struct Stats
+		{
+			double avgLatencyMs = 0.0;
+			double maxLatencyMs = 0.0;
+			double avgIntervalMs = 0.0;	// between the input samples of two frames
+			double jitterMs = 0.0;		// standard deviation of that interval
+			double avgSleepMs = 0.0;	// waited for the next input sample
+		};
+
+		static constexpr size_t STATS_WINDOW = 240;
+		static constexpr double MARGIN_MS = 1.0;	// the frame is started this much before the prediction says it has to
+
+		// CTOR & DTOR
+		//------------------------------
+		FramePacer(Device& device, SwapChain& swapChain, const Settings& settings);
+		~FramePacer() = default;
+
+		FramePacer(const FramePacer&) = delete;
+		FramePacer& operator=(const FramePacer&) = delete;
+		FramePacer(FramePacer&&) = delete;
+		FramePacer& operator=(FramePacer&&) = delete;
+
+
+		// METHODS
+		//------------------------------
+		// refreshRate in Hz, 0 when unknown leaves the low latency profile unpaced
+		static Settings GetProfileSettings(Profile profile, int refreshRate);
+
+		// waits until frameIndex can be recorded again & its input should be sampled
+		void WaitForFrame(uint32_t frameIndex);
+		// the frame in frameIndex was submitted, its fence signals once the GPU finished it
+		void EndFrame(uint32_t frameIndex);
+
+		// Getters & Setters
+		// the device has to be idle, the frames restart at slot 0
+		void SetSettings(const Settings& settings);
+		const Settings& GetSettings() const { return m_Settings; }
+
+		Stats GetStats() const;
+		double GetLastLatencyMs() const { return m_LastLatencyMs; }
+		double GetLastIntervalMs() const { return m_LastIntervalMs; }
+		double GetLastSleepMs() const { return m_LastSleepMs; }
+
+	private:
+		using Clock = std::chrono::high_resolution_clock;
+
+		// Private methods
+		//------------------------------
+		void PollFences();
+		static void SleepUntil(Clock::time_point time);
+
+		// Private members
+		//------------------------------
+		struct Slot
+		{
+			Clock::time_point inputTime{};
+			bool isPending = false;	// submitted, its fence was not seen signaled yet
+		};
+
+		// the last STATS_WINDOW values
+		struct Samples
+		{
+			std::vector<double> values{};
+			size_t next = 0;
+
+			void Add(double value);
+			void Clear() { values.clear(); next = 0; }
+		};
+
+		Device& m_Device;
+		SwapChain& m_SwapChain;
+		Settings m_Settings;
+
+		std::array<Slot, MAX_FRAMES_IN_FLIGHT> m_Slots{};
+		Clock::time_point m_Deadline{};		// the current frame should be finished by then
+		Clock::time_point m_LastInput{};
+		double m_PredictedLatencyMs = 0.0;	// rises with every slower frame at once, decays slowly
+
+		double m_LastLatencyMs = 0.0;
+		double m_LastIntervalMs = 0.0;
+		double m_LastSleepMs = 0.0;
+		Samples m_Latencies{};
+		Samples m_Intervals{};
+		Samples m_Sleeps{};
+	};
+}
@@ -1,6 +1,9 @@
 #include "Renderer.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <random>
 #include <vulkan/vk_enum_string_helper.h>
 
 #include "Window.h"
@@ -18,13 +21,15 @@ namespace cat
 		m_Camera.SetPitchYaw(-2.40000081f, -34.5999947f);
 		m_Camera.SetSpecs({ .fovy = glm::radians(90.f), .nearPlane = 0.1f, .farPlane = 1500.f, .aperture = 1.4f, .shutterSpeed = 1.0f / 60.0f, .iso = 1600.f });
 		InitializeVulkan();
-		OutputKeybinds();
+		if (!m_Window.IsHeadless())
+			OutputKeybinds();
 	}
 
 	Renderer::~Renderer()
 	{
 		m_PerformanceTimer.StopRecording();
-		m_PerformanceTimer.SaveToCSV("performance.csv");
+		if (!m_PerformanceCsvPath.empty())
+			m_PerformanceTimer.SaveToCSV(m_PerformanceCsvPath);
 
 		vkDeviceWaitIdle(m_Device.GetDevice());
 
@@ -37,8 +42,9 @@ namespace cat
 		{
 			delete scene;
 		}
-		delete m_pUniformBuffer;
-		delete m_pCommandBuffer;
+		m_pFrameSubmitter.reset();
+		m_pParallelRecorder.reset();
+		m_pThreadPool.reset();
 
 		glfwTerminate();
 	}
@@ -50,6 +56,9 @@ namespace cat
 		// SCATTERING TOGGLE
 		std::cout << COLOR_GREEN << "VOLUMETRICS: " << COLOR_RESET << std::endl;
 		std::cout << COLOR_YELLOW << "\t Press M to toggle multi-scattering" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press V to cycle froxels / half / quarter resolution ray march" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press Z/X to halve/double the ray march steps" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press N to toggle empty space skipping of the ray march & print the steps per texel" << COLOR_RESET << std::endl;
 
 		// SCENE SWITCHING
 		std::cout << COLOR_GREEN	<< "SCENE SWITCHING: " << COLOR_RESET << std::endl;
@@ -60,11 +69,41 @@ namespace cat
 		std::cout << COLOR_GREEN << "PERFORMANCE TESTING: " << COLOR_RESET << std::endl;
 		std::cout << COLOR_YELLOW << "\t Press P to start/stop recording (500 frames)" << COLOR_RESET << std::endl;
 		std::cout << COLOR_YELLOW << "\t Press F5 to save snapshot while recording" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press R to start/stop recording the camera path to " << CAMERA_PATH_FILE << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press T to start/stop replaying it at fixed time steps" << COLOR_RESET << std::endl;
+
+		// RENDER GRAPH
+		std::cout << COLOR_GREEN << "RENDER GRAPH: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press G to dump the frame graph to render_graph.dot" << COLOR_RESET << std::endl;
+
+		// OCCLUSION CULLING
+		std::cout << COLOR_GREEN << "OCCLUSION CULLING: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press H to toggle Hi-Z occlusion culling & print the visible draws" << COLOR_RESET << std::endl;
+
+		// SHADOW CACHE
+		std::cout << COLOR_GREEN << "SHADOW CACHE: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press K to toggle the shadow cascade cache & print the shadow casters" << COLOR_RESET << std::endl;
+
+		// POINT LIGHTS
+		std::cout << COLOR_GREEN << "POINT LIGHTS: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press J to add 256 random point lights to the scene" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press U to remove all point lights" << COLOR_RESET << std::endl;
+
+		// ASYNC COMPUTE
+		std::cout << COLOR_GREEN << "ASYNC COMPUTE: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press C to toggle the async compute queue & print the queue times" << COLOR_RESET << std::endl;
+
+		// FRAME PACING
+		std::cout << COLOR_GREEN << "FRAME PACING: " << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press B to switch between the low latency & max throughput profile & print the latency" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press F to cycle 1 - 3 frames in flight" << COLOR_RESET << std::endl;
+		std::cout << COLOR_YELLOW << "\t Press I to cycle the immediate / mailbox / fifo present mode" << COLOR_RESET << std::endl;
 	}
 
 	void Renderer::Update(float deltaTime)
 	{
 		// INPUT HANDLING
+		if (!m_Window.IsHeadless())
 		{
 			auto window = m_Window.GetWindow();
 
@@ -72,6 +111,47 @@ namespace cat
 			if (IsKeyPressedOnce(window, GLFW_KEY_M))
 				m_pVolumetricPass->ToggleUseMultiScattering();
 
+			// VOLUMETRIC MODE, froxels -> half -> quarter resolution ray march
+			if (IsKeyPressedOnce(window, GLFW_KEY_V))
+			{
+				auto settings = m_pVolumetricPass->GetSettings();
+				if (settings.mode == VolumetricPass::Mode::Froxels)
+				{
+					settings.mode = VolumetricPass::Mode::RayMarch;
+					settings.resolutionDivisor = 2;
+				}
+				else if (settings.resolutionDivisor == 2)
+					settings.resolutionDivisor = 4;
+				else
+					settings.mode = VolumetricPass::Mode::Froxels;
+				SetVolumetricSettings(settings);
+
+				if (settings.mode == VolumetricPass::Mode::Froxels)
+					std::cout << "Volumetrics: froxels" << std::endl;
+				else
+					std::cout << "Volumetrics: ray march at 1/" << settings.resolutionDivisor << " resolution, " << settings.marchSteps << " steps" << std::endl;
+			}
+
+			// VOLUMETRIC EMPTY SPACE SKIPPING TOGGLE
+			if (IsKeyPressedOnce(window, GLFW_KEY_N))
+			{
+				auto settings = m_pVolumetricPass->GetSettings();
+				std::cout << "Volumetric march steps per texel: " << m_pVolumetricPass->GetMarchStats().GetStepsPerTexel() << std::endl;
+				settings.useEmptySpaceSkipping = !settings.useEmptySpaceSkipping;
+				SetVolumetricSettings(settings);
+				std::cout << "Empty space skipping: " << (settings.useEmptySpaceSkipping ? "on" : "off") << std::endl;
+			}
+
+			// VOLUMETRIC RAY MARCH STEPS
+			const bool isFewerSteps = IsKeyPressedOnce(window, GLFW_KEY_Z);
+			const bool isMoreSteps = IsKeyPressedOnce(window, GLFW_KEY_X);
+			if (isFewerSteps || isMoreSteps)
+			{
+				auto settings = m_pVolumetricPass->GetSettings();
+				settings.marchSteps = isMoreSteps ? std::min(settings.marchSteps * 2, 256u) : std::max(settings.marchSteps / 2, 4u);
+				SetVolumetricSettings(settings);
+				std::cout << "Volumetric ray march steps: " << settings.marchSteps << std::endl;
+			}
 
 			// PERFORMANCE RECORDING TOGGLE
 			if (IsKeyPressedOnce(window, GLFW_KEY_P))
@@ -93,15 +173,196 @@ namespace cat
 				std::cout << COLOR_CYAN << "Switched to Scene 1 (Cornell Box)" << COLOR_RESET << std::endl;
 			}
 
+			// RENDER GRAPH DUMP, written after the next frame is recorded
+			if (IsKeyPressedOnce(window, GLFW_KEY_G))
+				m_ExportRenderGraph = true;
+
+			// HI-Z OCCLUSION CULLING TOGGLE
+			if (IsKeyPressedOnce(window, GLFW_KEY_H))
+			{
+				const auto& stats = m_pHiZPass->GetStats();
+				std::cout << "Visible draws: " << stats.earlyVisible << " early + " << stats.lateVisible << " late of " << stats.drawCount << std::endl;
+				m_pHiZPass->ToggleOcclusionCulling();
+			}
+
+			// SHADOW CACHE TOGGLE
+			if (IsKeyPressedOnce(window, GLFW_KEY_K))
+			{
+				const auto& stats = m_pShadowPass->GetCasterStats();
+				std::cout << "Shadow casters: " << stats.drawn << " drawn of " << stats.candidates << " (" << stats.outsideVolume << " outside, "
+					<< stats.noReceiver << " without receiver, " << stats.tooSmall << " too small) in " << m_pShadowPass->GetRedrawnCascadeCount() << " cascades" << std::endl;
+				m_pShadowPass->ToggleCache();
+			}
+
+			// RANDOM POINT LIGHTS
+			if (IsKeyPressedOnce(window, GLFW_KEY_J))
+			{
+				AddRandomPointLights(256);
+				std::cout << "Point lights: " << m_pCurrentScene->GetPointLights().size() << std::endl;
+			}
+			if (IsKeyPressedOnce(window, GLFW_KEY_U))
+			{
+				m_pCurrentScene->ClearPointLights();
+				std::cout << "Point lights: 0" << std::endl;
+			}
+
+			// ASYNC COMPUTE TOGGLE
+			if (IsKeyPressedOnce(window, GLFW_KEY_C))
+			{
+				const auto& times = m_pFrameSubmitter->GetQueueTimes();
+				std::cout << "Queues: " << times.graphicsMs << " ms graphics, " << times.computeMs << " ms async compute, "
+					<< times.overlapMs << " ms overlapped" << std::endl;
+
+				m_UseAsyncCompute = !m_UseAsyncCompute;
+				if (!m_Device.HasAsyncComputeQueue()) std::cout << "Async compute: unavailable, the GPU has no second compute queue" << std::endl;
+				else std::cout << "Async compute: " << (m_UseAsyncCompute ? "on" : "off") << std::endl;
+			}
+
+			// FRAME PACING PROFILE
+			if (IsKeyPressedOnce(window, GLFW_KEY_B))
+			{
+				const auto stats = m_pFramePacer->GetStats();
+				std::cout << "Input latency: " << stats.avgLatencyMs << " ms average, " << stats.maxLatencyMs << " ms max, frame interval: "
+					<< stats.avgIntervalMs << " ms, " << stats.jitterMs << " ms jitter, " << stats.avgSleepMs << " ms paced" << std::endl;
+
+				m_FramePacingProfile = m_FramePacingProfile == FramePacer::Profile::LowLatency ? FramePacer::Profile::MaxThroughput : FramePacer::Profile::LowLatency;
+				std::cout << "Frame pacing profile: " << (m_FramePacingProfile == FramePacer::Profile::LowLatency ? "low latency" : "max throughput") << std::endl;
+				ApplyFramePacing(FramePacer::GetProfileSettings(m_FramePacingProfile, m_Window.GetRefreshRate()));
+			}
+
+			// FRAMES IN FLIGHT, 1 -> 2 -> 3
+			if (IsKeyPressedOnce(window, GLFW_KEY_F))
+			{
+				auto settings = m_pFramePacer->GetSettings();
+				settings.framesInFlight = settings.framesInFlight % cat::MAX_FRAMES_IN_FLIGHT + 1;
+				ApplyFramePacing(settings);
+			}
+
+			// PRESENT MODE, immediate -> mailbox -> fifo
+			if (IsKeyPressedOnce(window, GLFW_KEY_I))
+			{
+				auto settings = m_pFramePacer->GetSettings();
+				switch (settings.presentMode)
+				{
+				case VK_PRESENT_MODE_IMMEDIATE_KHR: settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR; break;
+				case VK_PRESENT_MODE_MAILBOX_KHR: settings.presentMode = VK_PRESENT_MODE_FIFO_KHR; break;
+				default: settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+				}
+				ApplyFramePacing(settings);
+			}
+
 			// DIRECTIONAL LIGHT ROTATE TOGGLE
 			if (IsKeyPressedOnce(window, GLFW_KEY_L))
 				m_pCurrentScene->ToggleRotateDirectionalLight();
+
+			// CAMERA PATH RECORDING
+			if (IsKeyPressedOnce(window, GLFW_KEY_R))
+			{
+				if (m_CameraPathMode == CameraPathMode::Recording)
+				{
+					m_CameraPath.Save(CAMERA_PATH_FILE);
+					m_CameraPathMode = CameraPathMode::None;
+					std::cout << "Camera path: " << m_CameraPath.GetSampleCount() << " samples, " << m_CameraPath.GetDuration() << " s saved to " << CAMERA_PATH_FILE << std::endl;
+				}
+				else
+				{
+					m_CameraPath = {};
+					m_CameraPathTime = 0.f;
+					m_CameraPathMode = CameraPathMode::Recording;
+					std::cout << "Camera path: recording" << std::endl;
+				}
+			}
+
+			// CAMERA PATH REPLAY
+			if (IsKeyPressedOnce(window, GLFW_KEY_T))
+			{
+				if (m_CameraPathMode == CameraPathMode::Replaying)
+					StopCameraReplay();
+				else
+				{
+					try
+					{
+						StartCameraReplay(CameraPath::Load(CAMERA_PATH_FILE));
+						std::cout << "Camera path: replaying " << m_CameraPath.GetDuration() << " s" << std::endl;
+					}
+					catch (const std::exception& e)
+					{
+						std::cout << "Camera path: " << e.what() << std::endl;
+					}
+				}
+			}
+		}
+
+		// a replayed path drives the camera at fixed steps, the scene follows so its animation matches too
+		if (m_CameraPathMode == CameraPathMode::Replaying)
+		{
+			deltaTime = CameraPath::REPLAY_TIME_STEP;
+			m_CameraPathTime = std::min(m_CameraPathTime + deltaTime, m_CameraPath.GetDuration());
+			CameraPath::Apply(m_CameraPath.Evaluate(m_CameraPathTime), m_Camera);
+		}
+		else
+			m_Camera.Update(deltaTime);
+
+		if (m_CameraPathMode == CameraPathMode::Recording)
+		{
+			if (!m_CameraPath.IsEmpty()) m_CameraPathTime += deltaTime;
+			m_CameraPath.AddSample(m_CameraPathTime, m_Camera);
 		}
 
-		m_Camera.Update(deltaTime);
 		m_pCurrentScene->Update(deltaTime);
-		MatrixUbo uboData = { m_Camera.GetView(), m_Camera.GetProjection() };
-		m_pUniformBuffer->Update(m_CurrentFrame, uboData);
+		m_pCurrentScene->UpdateShadowCascades(m_Camera);
+	}
+
+	void Renderer::AddRandomPointLights(int count)
+	{
+		// scattered through the scene bounds, seeded by the light count so every run places the same lights
+		const auto [minBounds, maxBounds] = m_pCurrentScene->GetSceneBounds();
+		const float sceneSize = glm::length(maxBounds - minBounds);
+
+		std::mt19937 generator{ static_cast<uint32_t>(m_pCurrentScene->GetPointLights().size()) };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+		for (int i{ 0 }; i < count; ++i)
+		{
+			Scene::PointLight light{};
+			light.position = glm::vec4(glm::mix(minBounds, maxBounds, glm::vec3(unit(generator), unit(generator), unit(generator))), 1.f);
+			light.color = glm::vec4(unit(generator), unit(generator), unit(generator), 1.f);
+			light.radius = sceneSize * glm::mix(0.02f, 0.06f, unit(generator));
+			light.intensity = light.radius * light.radius * 0.5f;
+			m_pCurrentScene->AddPointLight(light);
+		}
+	}
+
+	void Renderer::StartCameraReplay(const CameraPath& path)
+	{
+		// the first frame shows the first sample
+		m_CameraPath = path;
+		m_CameraPathTime = -CameraPath::REPLAY_TIME_STEP;
+		m_CameraPathMode = CameraPathMode::Replaying;
+	}
+
+	void Renderer::StopCameraReplay()
+	{
+		m_CameraPathMode = CameraPathMode::None;
+		std::cout << "Camera path: replay stopped" << std::endl;
+	}
+
+	bool Renderer::IsCameraReplayFinished() const
+	{
+		return m_CameraPathMode == CameraPathMode::Replaying && m_CameraPathTime >= m_CameraPath.GetDuration();
+	}
+
+	void Renderer::SelectScene(const std::string& name)
+	{
+		const auto it = std::find(SCENE_NAMES.begin(), SCENE_NAMES.end(), name);
+		if (it == SCENE_NAMES.end())
+			throw std::runtime_error("failed to select scene, there is no scene called " + name + "!");
+
+		m_pCurrentScene = m_pScenes[std::distance(SCENE_NAMES.begin(), it)];
+	}
+
+	void Renderer::WaitForNextFrame()
+	{
+		m_pFramePacer->WaitForFrame(m_CurrentFrame);
 	}
 
 	void Renderer::Render() const
@@ -113,10 +374,12 @@ namespace cat
 
 	void Renderer::InitializeVulkan()
 	{
-		m_pSwapChain = new SwapChain(m_Device, m_Window.GetWindow());
-
-		m_pUniformBuffer = new UniformBuffer<MatrixUbo>(m_Device, cat::MAX_FRAMES_IN_FLIGHT);
-
+		const FramePacer::Settings pacing = FramePacer::GetProfileSettings(FRAME_PACING_PROFILE, m_Window.GetRefreshRate());
+		if (m_Window.IsHeadless())
+			m_pSwapChain = new SwapChain(m_Device, VkExtent2D{ static_cast<uint32_t>(m_Window.GetWidth()), static_cast<uint32_t>(m_Window.GetHeight()) });
+		else
+			m_pSwapChain = new SwapChain(m_Device, m_Window.GetWindow(), pacing.presentMode);
+		m_pFramePacer = std::make_unique<FramePacer>(m_Device, *m_pSwapChain, pacing);
 
 		// SCENES
 		//-----------------
@@ -124,12 +387,88 @@ namespace cat
 
 		// PASSES
 		//-----------------
-		m_pDepthPrepass = std::make_unique<DepthPrepass>(m_Device, cat::MAX_FRAMES_IN_FLIGHT);
-		m_pShadowPass = std::make_unique<ShadowPass>(m_Device, cat::MAX_FRAMES_IN_FLIGHT);
-		m_pGeometryPass = std::make_unique<GeometryPass>(m_Device, m_pSwapChain->GetSwapChainExtent(), cat::MAX_FRAMES_IN_FLIGHT);
-		m_pLightingPass = std::make_unique<LightingPass>(m_Device, m_pSwapChain->GetSwapChainExtent(), cat::MAX_FRAMES_IN_FLIGHT, *m_pGeometryPass, m_pHDRImage, *m_pSwapChain, * m_pShadowPass);
-		m_pVolumetricPass = std::make_unique<VolumetricPass>(m_Device, *m_pSwapChain, cat::MAX_FRAMES_IN_FLIGHT, *m_pLightingPass, *m_pShadowPass);
-		m_pBlitPass = std::make_unique<BlitPass>(m_Device, *m_pSwapChain, cat::MAX_FRAMES_IN_FLIGHT, *m_pVolumetricPass);
+		// the pass pipelines are only collected while the passes are created & compiled together afterwards
+		const auto passStart = std::chrono::high_resolution_clock::now();
+		PipelineBatch pipelineBatch{ m_Device };
+
+		m_pTransientImages = std::make_unique<TransientImageAllocator>(m_Device);
+
+		m_pHiZPass = std::make_unique<HiZPass>(m_Device, *m_pFrameConstants, *m_pSwapChain, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pDepthPrepass = std::make_unique<DepthPrepass>(m_Device, *m_pFrameConstants, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pShadowPass = std::make_unique<ShadowPass>(m_Device, *m_pFrameConstants, cat::MAX_FRAMES_IN_FLIGHT, m_pCurrentScene->GetCascadeSettings().resolution);
+		m_pGeometryPass = std::make_unique<GeometryPass>(m_Device, *m_pFrameConstants, *m_pTransientImages, m_pSwapChain->GetSwapChainExtent(), cat::MAX_FRAMES_IN_FLIGHT);
+		m_pLightClusterPass = std::make_unique<LightClusterPass>(m_Device, *m_pFrameConstants, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pLightingPass = std::make_unique<LightingPass>(m_Device, *m_pRingBuffer, *m_pFrameConstants, *m_pTransientImages, m_pSwapChain->GetSwapChainExtent(), cat::MAX_FRAMES_IN_FLIGHT, *m_pGeometryPass, m_pHDRImage, *m_pSwapChain, * m_pShadowPass, *m_pLightClusterPass);
+		m_pVolumetricPass = std::make_unique<VolumetricPass>(m_Device, *m_pRingBuffer, *m_pFrameConstants, *m_pTransientImages, *m_pSwapChain, cat::MAX_FRAMES_IN_FLIGHT, *m_pLightingPass, *m_pShadowPass);
+		m_pBlitPass = std::make_unique<BlitPass>(m_Device, *m_pFrameConstants, *m_pSwapChain, cat::MAX_FRAMES_IN_FLIGHT, *m_pVolumetricPass);
+
+		pipelineBatch.Compile(USE_PARALLEL_PIPELINE_CREATION ? m_pThreadPool.get() : nullptr);
+		const double passMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - passStart).count();
+		std::cout << "Pass setup: " << passMs << " ms, " << pipelineBatch.GetPipelineCount() << " pipelines compiled "
+			<< (USE_PARALLEL_PIPELINE_CREATION ? "on " + std::to_string(m_pThreadPool->GetThreadCount()) + " threads" : std::string("serially")) << std::endl;
+
+		// the passes only requested their render targets, place them & point the descriptors at them
+		m_pTransientImages->Allocate();
+		m_pLightingPass->UpdateDescriptors();
+		m_pVolumetricPass->UpdateDescriptors();
+		m_pBlitPass->UpdateDescriptors();
+
+		// every startup pipeline exists now, keep them for the next launch even if this one does not exit cleanly
+		const auto& pipelineStats = m_Device.GetPipelineCreationStats();
+		std::cout << "Pipelines: " << pipelineStats.pipelineCount << " created in " << pipelineStats.totalMs << " ms of driver time ("
+			<< (pipelineStats.isCacheWarm ? "warm" : "cold") << " cache)" << std::endl;
+		m_Device.SavePipelineCache();
+
+		// the measured passes, the helper passes of the render graph count towards the pass they serve
+		for (const char* passName : { "DepthPrepass", "HiZPass", "ShadowPass", "GeometryPass", "LightingPass", "VolumetricPass", "BlitPass" })
+		{
+			m_PerformanceTimer.RegisterPass(passName);
+		}
+		m_PerformanceTimer.AddPassAlias("DepthPrepassLate", m_PerformanceTimer.FindPass("DepthPrepass"));
+		for (const char* passName : { "HiZCullEarly", "HiZBuild", "HiZCullLate" })
+		{
+			m_PerformanceTimer.AddPassAlias(passName, m_PerformanceTimer.FindPass("HiZPass"));
+		}
+		m_PerformanceTimer.AddPassAlias("ShadowPyramid", m_PerformanceTimer.FindPass("ShadowPass"));
+		m_PerformanceTimer.AddPassAlias("LightCull", m_PerformanceTimer.FindPass("LightingPass"));
+		for (const char* passName : { "FroxelInject", "FroxelIntegrate", "VolumetricMarch" })
+		{
+			m_PerformanceTimer.AddPassAlias(passName, m_PerformanceTimer.FindPass("VolumetricPass"));
+		}
+
+		m_Counters.barrierBatches = m_PerformanceTimer.RegisterCounter("BarrierBatches");
+		m_Counters.barriers = m_PerformanceTimer.RegisterCounter("Barriers");
+		m_Counters.culledDraws = m_PerformanceTimer.RegisterCounter("CulledDraws");
+		m_Counters.shadowCasters = m_PerformanceTimer.RegisterCounter("ShadowCasters");
+		m_Counters.culledCasters = m_PerformanceTimer.RegisterCounter("CulledCasters");
+		m_Counters.marchSteps = m_PerformanceTimer.RegisterCounter("MarchSteps");
+		m_Counters.asyncCompute = m_PerformanceTimer.RegisterCounter("AsyncCompute(ms)");
+		m_Counters.asyncOverlap = m_PerformanceTimer.RegisterCounter("AsyncOverlap(ms)");
+		m_Counters.inputLatency = m_PerformanceTimer.RegisterCounter("InputLatency(ms)");
+		m_Counters.frameInterval = m_PerformanceTimer.RegisterCounter("FrameInterval(ms)");
+		m_Counters.pacerSleep = m_PerformanceTimer.RegisterCounter("PacerSleep(ms)");
+		m_Counters.overflowClusters = m_PerformanceTimer.RegisterCounter("OverflowClusters");
+
+		// CPU recording time, GPU timestamps & pipeline statistics of every pass, by the id its name resolved to when added
+		m_RenderGraph.SetPassCallbacks(
+			[this](const std::string& passName)
+			{
+				const PerformanceTimer::MetricId pass = m_PerformanceTimer.FindPass(passName);
+				if (pass == PerformanceTimer::INVALID_METRIC && m_UnmeasuredPasses.insert(passName).second)
+					std::cout << "Render graph pass " << passName << " is not registered with the performance timer, its times are not recorded" << std::endl;
+				return static_cast<uint32_t>(pass);
+			},
+			[this](uint32_t passId, VkCommandBuffer commandBuffer)
+			{
+				const auto pass = static_cast<PerformanceTimer::MetricId>(passId);
+				m_PerformanceTimer.BeginPass(pass);
+				m_pFrameSubmitter->BeginPassQueries(commandBuffer, pass);
+			},
+			[this](uint32_t passId, VkCommandBuffer commandBuffer)
+			{
+				m_pFrameSubmitter->EndPassQueries(commandBuffer);
+				m_PerformanceTimer.EndPass(static_cast<PerformanceTimer::MetricId>(passId));
+			});
 
 		// Start performance recording
 		m_PerformanceTimer.StartRecording();
@@ -141,7 +480,7 @@ namespace cat
 		//-----------------
 		m_pScenes.resize(1);
 
-		m_pScenes[0] = new Scene(m_Device, m_pUniformBuffer);
+		m_pScenes[0] = new Scene(m_Device);
 		m_pScenes[0]->AddModel("resources/Models/Sponza/Sponza.gltf")
 			->SetRotation(glm::radians(90.f), { 0,1,0 });
 		m_pScenes[0]->AddModel("resources/Models/Lucy/scene.gltf");
@@ -151,13 +490,22 @@ namespace cat
 
 		m_pHDRImage = new HDRImage(m_Device, "resources/HDRIs/Overcast.hdr");
 
-		m_pCommandBuffer = new CommandBuffer(m_Device, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pFrameSubmitter = std::make_unique<FrameSubmitter>(m_Device, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pThreadPool = std::make_unique<ThreadPool>();
+		m_pParallelRecorder = std::make_unique<ParallelRecorder>(m_Device, *m_pThreadPool, cat::MAX_FRAMES_IN_FLIGHT);
+		m_pRingBuffer = std::make_unique<RingBuffer>(m_Device, 256 * 1024, cat::MAX_FRAMES_IN_FLIGHT); // per frame uniform & storage data
+		m_pFrameConstants = std::make_unique<FrameConstants>(m_Device, *m_pRingBuffer, cat::MAX_FRAMES_IN_FLIGHT);
 
 	}
 
 	void Renderer::DrawFrame() const
 	{
-		vkWaitForFences(m_Device.GetDevice(), 1, m_pSwapChain->GetInFlightFences(m_CurrentFrame), VK_TRUE, UINT64_MAX); // wait until previous frame has finished
+		// the frame pacer already waited until the previous frame in this slot has finished
+		if (m_pSwapChain->IsHeadless())
+		{
+			DrawHeadlessFrame();
+			return;
+		}
 
 		// AQUIRING AN IMAGE FROM THE SWAPCHAIN
 		VkResult result = vkAcquireNextImageKHR(m_Device.GetDevice(), m_pSwapChain->GetSwapChain(), UINT64_MAX, m_pSwapChain->GetImageAvailableSemaphores(m_CurrentFrame), VK_NULL_HANDLE, &m_pSwapChain->GetImageIndex());
@@ -178,56 +526,17 @@ namespace cat
 
 		// RECORDING
 		//-----------------
-		{
-			vkResetCommandBuffer(*m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame), 0);
-
-			// Begin recording:
-			VkCommandBufferBeginInfo beginInfo{};   // will reset it, if buffer was alr recorded once
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = 0; //optional - how we will use the cmd buffer
-			beginInfo.pInheritanceInfo = nullptr; //optional - relevant for 2nd buffer = specifies which state to inherit from the calling primary command buffers
-
-			if (vkBeginCommandBuffer(*m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame), &beginInfo) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to begin command buffer!");
-			}
-
-			//RecordCommandBuffer(*m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame), m_pSwapChain->GetImageIndex());
-			RecordPasses();
-
-			m_pSwapChain->GetSwapChainImage(static_cast<int>(m_pSwapChain->GetImageIndex()))->TransitionImageLayout(
-				*m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,{}
-			);
-
-			// End recording:
-			if (vkEndCommandBuffer(*m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame)) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to record command buffer!");
-			}
-		}
-
-		// SUNMITTING THE COMMAND BUFFER
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-		VkSemaphore waitSemaphores[] = { m_pSwapChain->GetImageAvailableSemaphores(m_CurrentFrame) };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
-
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame);
+		m_pFrameSubmitter->BeginFrame(m_CurrentFrame);
+		RecordPasses(); // ends with the swapchain image in present layout
 
+		// SUBMITTING THE BATCHES, the last graphics one signals the fence & the present
 		VkSemaphore signalSemaphore[] = { m_pSwapChain->GetRenderFinishedSemaphores(m_CurrentFrame) };
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphore;
-
-		auto result2 = vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &submitInfo, *m_pSwapChain->GetInFlightFences(m_CurrentFrame));
-		if (result2 != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to submit draw command buffer!" + std::string(string_VkResult(result2)));
-		}
+		m_pFrameSubmitter->Submit(m_RenderGraph.GetBatches(), m_pSwapChain->GetImageAvailableSemaphores(m_CurrentFrame), signalSemaphore[0],
+			*m_pSwapChain->GetInFlightFences(m_CurrentFrame));
+		m_pFramePacer->EndFrame(m_CurrentFrame);
+		m_PerformanceTimer.SetCounter(m_Counters.inputLatency, m_pFramePacer->GetLastLatencyMs());
+		m_PerformanceTimer.SetCounter(m_Counters.frameInterval, m_pFramePacer->GetLastIntervalMs());
+		m_PerformanceTimer.SetCounter(m_Counters.pacerSleep, m_pFramePacer->GetLastSleepMs());
 
 		// PRESENTATION
 		VkPresentInfoKHR presentInfo{};
@@ -256,77 +565,136 @@ namespace cat
 			throw std::runtime_error("failed to acquire swap chain image!" + std::string(string_VkResult(result)));
 		}
 
-		m_CurrentFrame = (m_CurrentFrame + 1) % cat::MAX_FRAMES_IN_FLIGHT;
+		m_CurrentFrame = (m_CurrentFrame + 1) % m_pFramePacer->GetSettings().framesInFlight;
 	}
 	
 	
+	void Renderer::DrawHeadlessFrame() const
+	{
+		// every frame in flight owns its offscreen image, nothing to acquire or present
+		m_pSwapChain->GetImageIndex() = m_CurrentFrame;
+		vkResetFences(m_Device.GetDevice(), 1, m_pSwapChain->GetInFlightFences(m_CurrentFrame));
+
+		m_pFrameSubmitter->BeginFrame(m_CurrentFrame);
+		RecordPasses();
+
+		m_pFrameSubmitter->Submit(m_RenderGraph.GetBatches(), VK_NULL_HANDLE, VK_NULL_HANDLE, *m_pSwapChain->GetInFlightFences(m_CurrentFrame));
+		m_pFramePacer->EndFrame(m_CurrentFrame);
+		m_PerformanceTimer.SetCounter(m_Counters.inputLatency, m_pFramePacer->GetLastLatencyMs());
+		m_PerformanceTimer.SetCounter(m_Counters.frameInterval, m_pFramePacer->GetLastIntervalMs());
+		m_PerformanceTimer.SetCounter(m_Counters.pacerSleep, m_pFramePacer->GetLastSleepMs());
+
+		m_CurrentFrame = (m_CurrentFrame + 1) % m_pFramePacer->GetSettings().framesInFlight;
+	}
+
 	void Renderer::RecordPasses() const
 	{
-		auto& commandBuffer = *m_pCommandBuffer->GetCommandBuffer(m_CurrentFrame);
-
-
-		m_PerformanceTimer.BeginPass("DepthPrepass");
-		m_pDepthPrepass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			*m_pSwapChain->GetDepthImage(m_CurrentFrame),
-			m_Camera,
-			*m_pCurrentScene
-		);
-		m_PerformanceTimer.EndPass("DepthPrepass");
-
-		m_PerformanceTimer.BeginPass("ShadowPass");
-		m_pShadowPass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			*m_pCurrentScene
-		);
-		m_PerformanceTimer.EndPass("ShadowPass");
-
-		m_PerformanceTimer.BeginPass("GeometryPass");
-		m_pGeometryPass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			*m_pSwapChain->GetDepthImage(m_CurrentFrame),
-			m_Camera,
-			*m_pCurrentScene
-		);
-		m_PerformanceTimer.EndPass("GeometryPass");
-
-		m_PerformanceTimer.BeginPass("LightingPass");
-		m_pLightingPass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			m_Camera,
-			*m_pCurrentScene
-		);
-		m_PerformanceTimer.EndPass("LightingPass");
-
-		m_PerformanceTimer.BeginPass("VolumetricPass");
-		m_pVolumetricPass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			m_Camera,
-			*m_pCurrentScene
-		);
-		m_PerformanceTimer.EndPass("VolumetricPass");
-
-		m_PerformanceTimer.BeginPass("BlitPass");
-		m_pBlitPass->Record(
-			commandBuffer,
-			m_CurrentFrame,
-			m_Camera
-		);
-		m_PerformanceTimer.EndPass("BlitPass");
+		Image& depthImage = *m_pSwapChain->GetDepthImage(m_CurrentFrame);
+		Image& swapchainImage = *m_pSwapChain->GetSwapChainImage(m_pSwapChain->GetImageIndex());
+
+		// the scene passes record their draws on the worker threads while the primary buffer is being recorded,
+		// each pass then waits for its own secondaries and executes them in order
+		m_pParallelRecorder->BeginFrame(m_CurrentFrame);
+		m_pRingBuffer->BeginFrame(m_CurrentFrame);
+
+		// camera & light data is uploaded once and shared by every pass through set 0
+		Camera camera = m_Camera;
+		m_pFrameConstants->Update(m_CurrentFrame, camera, *m_pCurrentScene, m_pSwapChain->GetSwapChainExtent());
+
+		// only the lights that changed are copied, a grown light buffer has to be rebound
+		if (m_pLightClusterPass->UpdateLights(m_CurrentFrame, *m_pCurrentScene))
+			m_pLightingPass->UpdateDescriptors();
+		// so are the bounds of the opaque draws, grown cull & indirect buffers replace the ones the graph knows
+		if (m_pHiZPass->UpdateDraws(m_CurrentFrame, *m_pCurrentScene))
+			m_RenderGraph.ClearResourceStates();
+
+		// passes declare what they read & write, the graph culls & places the barriers
+		m_RenderGraph.Reset();
+		m_pLightClusterPass->AddToGraph(m_RenderGraph, m_CurrentFrame); // first, so the compute queue starts on it with the frame
+		m_pHiZPass->AddCullToGraph(m_RenderGraph, m_CurrentFrame);
+		m_pDepthPrepass->AddToGraph(m_RenderGraph, *m_pParallelRecorder, m_CurrentFrame, depthImage, *m_pCurrentScene, *m_pHiZPass); // early, Hi-Z build & late
+		m_pShadowPass->AddToGraph(m_RenderGraph, *m_pParallelRecorder, m_CurrentFrame, *m_pCurrentScene);
+		m_pGeometryPass->AddToGraph(m_RenderGraph, *m_pParallelRecorder, m_CurrentFrame, depthImage, *m_pCurrentScene, *m_pHiZPass);
+		m_pLightingPass->AddToGraph(m_RenderGraph, m_CurrentFrame, *m_pCurrentScene);
+		m_pVolumetricPass->AddToGraph(m_RenderGraph, m_CurrentFrame);
+		m_pBlitPass->AddToGraph(m_RenderGraph, m_CurrentFrame, swapchainImage);
+		m_RenderGraph.SetOutput(swapchainImage, m_pSwapChain->IsHeadless() ? RenderGraph::COLOR_ATTACHMENT_WRITE : RenderGraph::PRESENT);
+
+		const bool useAsyncCompute = m_UseAsyncCompute && m_Device.HasAsyncComputeQueue();
+		m_RenderGraph.Execute([this](RenderGraph::QueueType queue, std::vector<RenderGraph::Wait> waits)
+			{
+				return m_pFrameSubmitter->BeginBatch(queue, std::move(waits));
+			}, useAsyncCompute);
+
+		m_PerformanceTimer.SetCounter(m_Counters.barrierBatches, m_RenderGraph.GetBarrierBatchCount());
+		m_PerformanceTimer.SetCounter(m_Counters.barriers, m_RenderGraph.GetBarrierCount());
+		const auto& cullStats = m_pHiZPass->GetStats();
+		m_PerformanceTimer.SetCounter(m_Counters.culledDraws, cullStats.drawCount - cullStats.earlyVisible - cullStats.lateVisible);
+		const auto& casterStats = m_pShadowPass->GetCasterStats();
+		m_PerformanceTimer.SetCounter(m_Counters.shadowCasters, casterStats.drawn);
+		m_PerformanceTimer.SetCounter(m_Counters.culledCasters, casterStats.candidates - casterStats.drawn);
+		m_PerformanceTimer.SetCounter(m_Counters.marchSteps, m_pVolumetricPass->GetMarchStats().GetStepsPerTexel());
+		m_PerformanceTimer.SetCounter(m_Counters.overflowClusters, m_pLightClusterPass->GetOverflowClusters());
+		const auto& queueTimes = m_pFrameSubmitter->GetQueueTimes();
+		m_PerformanceTimer.SetCounter(m_Counters.asyncCompute, queueTimes.computeMs);
+		m_PerformanceTimer.SetCounter(m_Counters.asyncOverlap, queueTimes.overlapMs);
+		if (m_CameraPathMode != CameraPathMode::None)
+			m_PerformanceTimer.SetCameraPathTime(m_CameraPathTime);
+		for (const auto& passResult : m_pFrameSubmitter->GetPassResults())
+		{
+			m_PerformanceTimer.AddPassGpuResults(passResult.pass, passResult.gpuMs, passResult.statistics);
+		}
 
+		if (m_ExportRenderGraph)
+		{
+			m_RenderGraph.ExportDot("render_graph.dot");
+			m_ExportRenderGraph = false;
+		}
 	}
 
 	void Renderer::ResizePasses() const
 	{
+		// the swapchain recreation already waited for the device, nothing uses the old targets anymore
+		m_pTransientImages->Clear();
+		m_RenderGraph.ClearResourceStates();
+
+		m_pHiZPass->Resize(m_pSwapChain->GetSwapChainExtent());
 		m_pGeometryPass->Resize(m_pSwapChain->GetSwapChainExtent());
-		m_pLightingPass->Resize(m_pSwapChain->GetSwapChainExtent(), *m_pGeometryPass);
+		m_pLightingPass->Resize(m_pSwapChain->GetSwapChainExtent());
 		m_pVolumetricPass->Resize(m_pSwapChain->GetSwapChainExtent());
 		m_pBlitPass->Resize(m_pSwapChain->GetSwapChainExtent());
+
+		m_pTransientImages->Allocate();
+		m_pLightingPass->UpdateDescriptors();
+		m_pVolumetricPass->UpdateDescriptors();
+		m_pBlitPass->UpdateDescriptors();
+	}
+
+	void Renderer::SetVolumetricSettings(const VolumetricPass::Settings& settings)
+	{
+		if (m_pVolumetricPass->SetSettings(settings))
+			m_RenderGraph.ClearResourceStates();
+	}
+
+	void Renderer::ApplyFramePacing(const FramePacer::Settings& settings)
+	{
+		// nothing is in flight anymore, the frames restart at slot 0 with every fence signaled
+		vkDeviceWaitIdle(m_Device.GetDevice());
+
+		if (settings.presentMode != m_pFramePacer->GetSettings().presentMode && !m_pSwapChain->IsHeadless())
+		{
+			m_pSwapChain->SetPresentMode(settings.presentMode);
+			m_pSwapChain->RecreateSwapChain();
+			ResizePasses();
+		}
+
+		m_pFramePacer->SetSettings(settings);
+		m_CurrentFrame = 0;
+
+		std::cout << "Frame pacing: " << m_pFramePacer->GetSettings().framesInFlight << " frames in flight, "
+			<< string_VkPresentModeKHR(m_pSwapChain->GetPresentMode()) << ", ";
+		if (settings.targetFrameMs > 0.0) std::cout << "paced to " << settings.targetFrameMs << " ms" << std::endl;
+		else std::cout << "unpaced" << std::endl;
 	}
 
 }
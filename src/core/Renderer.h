@@ -1,20 +1,32 @@
 #pragma once
 
 #include "../vulkan/utils/PerformanceTimer.h"
+#include "FramePacer.h"
 
 #include "../vulkan/scene/Camera.h"
+#include "../vulkan/scene/CameraPath.h"
 #include "../vulkan/Descriptors.h"
 #include "../vulkan/Pipeline.h"
+#include "../vulkan/RenderGraph.h"
+#include "../vulkan/FrameSubmitter.h"
+#include "../vulkan/TransientImageAllocator.h"
 #include "../vulkan/buffers/CommandBuffer.h"
+#include "../vulkan/buffers/ParallelRecorder.h"
+#include "../vulkan/buffers/RingBuffer.h"
+#include "../vulkan/buffers/FrameConstants.h"
 #include "../vulkan/scene/Scene.h"
 
+#include "../vulkan/passes/HiZPass.h"
 #include "../vulkan/passes/DepthPrepass.h"
 #include "../vulkan/passes/ShadowPass.h"
 #include "../vulkan/passes/GeometryPass.h"
+#include "../vulkan/passes/LightClusterPass.h"
 #include "../vulkan/passes/LightingPass.h"
 #include "../vulkan/passes/VolumetricPass.h"
 #include "../vulkan/passes/BlitPass.h"
 
+#include <unordered_set>
+
 namespace cat
 {
 	class Window;
@@ -22,8 +34,18 @@ namespace cat
 	class Renderer final
 	{
 	public:
+		// the pass pipelines are compiled on the worker threads, false compiles them one after another to compare the startup
+		static constexpr bool USE_PARALLEL_PIPELINE_CREATION = true;
+		// frames in flight, present mode & pacing at startup, B switches to the other profile at runtime
+		static constexpr FramePacer::Profile FRAME_PACING_PROFILE = FramePacer::Profile::MaxThroughput;
+		// indexed like the scenes CreateScenes loads
+		static constexpr std::array<const char*, 1> SCENE_NAMES{ "sponza" };
+		// R records the camera path into it, T replays it
+		static constexpr const char* CAMERA_PATH_FILE = "camera_path.csv";
+
 		// CTOR & DTOR
 		//--------------------
+		// a headless window renders into offscreen images, nothing is presented & there is no input
 		Renderer(Window& window);
 		~Renderer();
 		void OutputKeybinds();
@@ -35,10 +57,31 @@ namespace cat
 
 		// Methods
 		//--------------------
+		// waits for the next frame slot & paces the loop, the input is sampled right after it returns
+		void WaitForNextFrame();
 		void Update(float deltaTime);
 		void Render()const;
+		void AddRandomPointLights(int count);
+		// the camera & scene then advance CameraPath::REPLAY_TIME_STEP per frame, whatever the deltaTime
+		void StartCameraReplay(const CameraPath& path);
+		void StopCameraReplay();
+		bool IsCameraReplayFinished() const;
+		// the device has to be idle, the frames restart at slot 0
+		void ApplyFramePacing(const FramePacer::Settings& settings);
 
 		// Getters & Setters
+		PerformanceTimer& GetPerformanceTimer() const { return m_PerformanceTimer; }
+		// written when the renderer is destroyed, empty writes nothing
+		void SetPerformanceCsvPath(const std::string& path) { m_PerformanceCsvPath = path; }
+		// one of SCENE_NAMES
+		void SelectScene(const std::string& name);
+		void SetUseAsyncCompute(bool useAsyncCompute) { m_UseAsyncCompute = useAsyncCompute; }
+		// the render graph forgets the ray march images when they are recreated
+		void SetVolumetricSettings(const VolumetricPass::Settings& settings);
+
+		HiZPass& GetHiZPass() const { return *m_pHiZPass; }
+		ShadowPass& GetShadowPass() const { return *m_pShadowPass; }
+		VolumetricPass& GetVolumetricPass() const { return *m_pVolumetricPass; }
 
 
 	private:
@@ -48,6 +91,7 @@ namespace cat
 		void CreateScenes();
 
 		void DrawFrame()const;
+		void DrawHeadlessFrame()const;
 		void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
 		void RecordPasses() const;
 		void ResizePasses() const;
@@ -57,23 +101,51 @@ namespace cat
 		// Private Members
 		//--------------------
 		mutable PerformanceTimer m_PerformanceTimer;
+		std::string m_PerformanceCsvPath{ "performance.csv" };
+		// registered with m_PerformanceTimer in InitializeVulkan
+		struct MetricCounters
+		{
+			PerformanceTimer::MetricId barrierBatches, barriers, culledDraws, shadowCasters, culledCasters, marchSteps,
+				asyncCompute, asyncOverlap, inputLatency, frameInterval, pacerSleep, overflowClusters;
+		} m_Counters{};
+		std::unordered_set<std::string> m_UnmeasuredPasses{};	// render graph passes that were warned about
 
 		Window& m_Window;
 		Camera m_Camera;
+		enum class CameraPathMode { None, Recording, Replaying };
+		CameraPathMode m_CameraPathMode = CameraPathMode::None;
+		CameraPath m_CameraPath{};
+		float m_CameraPathTime = 0.f;
 		Device m_Device;
 		SwapChain* m_pSwapChain;
 		Pipeline* m_pGraphicsPipeline;
 		Scene* m_pCurrentScene;
 		std::vector<Scene*> m_pScenes;
-		UniformBuffer<MatrixUbo>* m_pUniformBuffer;
-		CommandBuffer* m_pCommandBuffer;
+		std::unique_ptr<FrameSubmitter> m_pFrameSubmitter;
+		std::unique_ptr<FramePacer> m_pFramePacer;
+		FramePacer::Profile m_FramePacingProfile = FRAME_PACING_PROFILE;
+		std::unique_ptr<ThreadPool> m_pThreadPool;
+		std::unique_ptr<ParallelRecorder> m_pParallelRecorder;
+		std::unique_ptr<RingBuffer> m_pRingBuffer;
+		std::unique_ptr<FrameConstants> m_pFrameConstants;
+
+		mutable uint16_t m_CurrentFrame = 0; // cycles through the frames in flight of the frame pacer
+
+		// rebuilt every frame in RecordPasses
+		mutable RenderGraph m_RenderGraph;
+		mutable bool m_ExportRenderGraph = false;
+		// the passes marked async compute go to the compute queue, only when the device has one
+		bool m_UseAsyncCompute = true;
 
-		mutable uint16_t m_CurrentFrame = 0;
+		// render targets of the passes, declared before them so it outlives them
+		std::unique_ptr<TransientImageAllocator> m_pTransientImages;
 
 		// passes
+		std::unique_ptr<HiZPass> m_pHiZPass;
 		std::unique_ptr<DepthPrepass> m_pDepthPrepass;
 		std::unique_ptr<ShadowPass> m_pShadowPass;
 		std::unique_ptr<GeometryPass> m_pGeometryPass;
+		std::unique_ptr<LightClusterPass> m_pLightClusterPass;
 		std::unique_ptr<LightingPass> m_pLightingPass;
 		std::unique_ptr<VolumetricPass> m_pVolumetricPass;
 		std::unique_ptr<BlitPass> m_pBlitPass;
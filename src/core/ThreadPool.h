@@ -0,0 +1,122 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cat
+{
+	class ThreadPool final
+	{
+	public:
+		// CTOR & DTOR
+		//--------------------
+		explicit ThreadPool(uint32_t threadCount = DefaultThreadCount())
+		{
+			for (uint32_t index{ 0 }; index < threadCount; ++index)
+			{
+				m_Workers.emplace_back([this, index] { WorkerLoop(index); });
+			}
+		}
+		~ThreadPool()
+		{
+			{
+				std::lock_guard lock(m_Mutex);
+				m_IsStopping = true;
+			}
+			m_Condition.notify_all();
+
+			for (auto& worker : m_Workers)
+			{
+				worker.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+
+		// Methods
+		//--------------------
+		template<typename Func>
+		auto Submit(Func&& func) -> std::future<std::invoke_result_t<Func>>
+		{
+			using Result = std::invoke_result_t<Func>;
+
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+			std::future<Result> future = task->get_future();
+
+			// without workers the caller does the work itself
+			if (m_Workers.empty())
+			{
+				(*task)();
+				return future;
+			}
+
+			{
+				std::lock_guard lock(m_Mutex);
+				m_Tasks.emplace([task] { (*task)(); });
+			}
+			m_Condition.notify_one();
+
+			return future;
+		}
+
+		// Getters & Setters
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+		// index of the calling worker, threads outside of this pool all share index GetThreadCount()
+		uint32_t GetWorkerIndex() const { return s_pCurrentPool == this ? s_WorkerIndex : GetThreadCount(); }
+
+		static uint32_t DefaultThreadCount()
+		{
+			const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			return hardwareThreads > 1 ? hardwareThreads - 1 : 1; // leave one core for the main thread
+		}
+
+	private:
+		// Private Methods
+		//--------------------
+		void WorkerLoop(uint32_t index)
+		{
+			s_pCurrentPool = this;
+			s_WorkerIndex = index;
+
+			while (true)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock lock(m_Mutex);
+					m_Condition.wait(lock, [this] { return m_IsStopping || !m_Tasks.empty(); });
+
+					if (m_IsStopping && m_Tasks.empty())
+						return;
+
+					task = std::move(m_Tasks.front());
+					m_Tasks.pop();
+				}
+				task();
+			}
+		}
+
+		// Private Members
+		//--------------------
+		std::vector<std::thread> m_Workers;
+		std::queue<std::function<void()>> m_Tasks;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_IsStopping = false;
+
+		static inline thread_local const ThreadPool* s_pCurrentPool = nullptr;
+		static inline thread_local uint32_t s_WorkerIndex = 0;
+	};
+}
@@ -20,8 +20,15 @@ namespace cat
         InitializeWindow(width, height, title);
     }
     
+    Window::Window(int width, int height)
+    	:m_Width{ width }, m_Height(height)
+    {
+    }
+    
     Window::~Window()
     {
+        if (IsHeadless())
+            return;
         glfwDestroyWindow(m_pWindow);
     	glfwTerminate();
     }
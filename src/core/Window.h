@@ -1,10 +1,14 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 #include <string>
 
@@ -17,6 +21,8 @@ public:
 	// CTOR & DTOR
 	//--------------------
 	Window(int width, int height, const char* title);
+	// headless, glfw is never initialized & GetWindow returns nullptr
+	Window(int width, int height);
 	~Window();
 
 	Window(const Window&) = delete;
@@ -30,17 +36,27 @@ public:
 
 	// Getters & Setters
 	GLFWwindow* GetWindow()const { return m_pWindow; }
+	bool IsHeadless() const { return m_pWindow == nullptr; }
 
 	int GetWidth() const { return m_Width; }	
 	int GetHeight() const { return m_Height; }
 	float GetAspectRatio() const{ return static_cast<float>(m_Width) / static_cast<float>(m_Height); }
+	// of the primary monitor, 0 when unknown
+	int GetRefreshRate() const
+	{
+		if (IsHeadless())
+			return 0;
+		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+		return mode ? mode->refreshRate : 0;
+	}
 
 	void SetFrameBufferResized(bool value) { m_FrameBufferResized = value; }
 	bool GetFrameBufferResized() const { return m_FrameBufferResized; }
 
 private:
 	static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
-	GLFWwindow* m_pWindow;
+	GLFWwindow* m_pWindow = nullptr;
 
 	// Window properties
 	int m_Width;
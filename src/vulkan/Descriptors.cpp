@@ -191,9 +191,11 @@ namespace cat
         return this;
     }
 
-    void DescriptorSet::Bind(VkCommandBuffer commandBuffer, const VkPipelineLayout& pipelineLayout, uint16_t idx, unsigned int firstSet) const
+    void DescriptorSet::Bind(VkCommandBuffer commandBuffer, const VkPipelineLayout& pipelineLayout, uint16_t idx, unsigned int firstSet, std::initializer_list<uint32_t> dynamicOffsets,
+        VkPipelineBindPoint bindPoint) const
     {
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, firstSet, 1, &m_DescriptorSets[idx], 0, nullptr);
+        vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, firstSet, 1, &m_DescriptorSets[idx],
+            static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.begin());
     }
 
     DescriptorSet* DescriptorSet::UpdateAll()
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <initializer_list>
 #include <unordered_map>
 
 #include "Device.h"
@@ -77,7 +78,9 @@ namespace cat
 		DescriptorSet* AddImageWrite(uint32_t binding, const VkDescriptorImageInfo& imageInfo);
 		DescriptorSet* AddImageWrite(uint32_t binding, const VkDescriptorImageInfo& imageInfo, uint32_t idx);
 
-		void Bind(VkCommandBuffer commandBuffer, const VkPipelineLayout& pipelineLayout, uint16_t idx, unsigned int firstSet = 0) const;
+		// dynamicOffsets holds one offset per dynamic descriptor of the set, in binding order
+		void Bind(VkCommandBuffer commandBuffer, const VkPipelineLayout& pipelineLayout, uint16_t idx, unsigned int firstSet = 0, std::initializer_list<uint32_t> dynamicOffsets = {},
+			VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
 
 		VkDescriptorSet* GetDescriptorSet(uint16_t idx) { return &m_DescriptorSets[idx]; }
 		uint32_t GetDescriptorSetCount() const { return static_cast<uint32_t>(m_DescriptorSets.size()); }
@@ -7,6 +7,9 @@
 #include "utils/DebugLabel.h"
 
 // std
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <set>
@@ -30,15 +33,19 @@ namespace cat
 	{
 		CreateInstance();
 		SetupDebugMessenger();
-		CreateSurface();
+		if (!IsHeadless()) CreateSurface();
 		PickPhysicalDevice();
 		CreateLogicalDevice();
 		CreateCommandPool();
         AllocVmaAllocator();
+		CreatePipelineCache();
 	}
 
 	Device::~Device()
 	{
+		SavePipelineCache();
+		vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+
 		vmaDestroyAllocator(m_Allocator);
 
         vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
@@ -50,7 +57,7 @@ namespace cat
             DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        if (m_Surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
 
 		vkDestroyInstance(m_Instance, nullptr);
 	}
@@ -64,7 +71,7 @@ namespace cat
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.usage = usageFlags;
         bufferInfo.size = size;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        SetSharingMode(bufferInfo);
 
         VmaAllocationCreateInfo allocationInfo{};
         allocationInfo.usage = memoryUsage;
@@ -198,11 +205,7 @@ namespace cat
 
     void Device::CreateSurface()
     {
-        VkWin32SurfaceCreateInfoKHR createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-        createInfo.hwnd = glfwGetWin32Window(m_Window);
-        createInfo.hinstance = GetModuleHandle(nullptr);
-
+        // glfw picks the platform's surface extension
         if (glfwCreateWindowSurface(m_Instance, m_Window, nullptr, &m_Surface) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create window surface!");
@@ -249,18 +252,20 @@ namespace cat
         // 1. Specifying the queues to be created
         //------------------------------------
         QueueFamilyIndices indices = FindQueueFamilies(m_PhysicalDevice);
+        FindAsyncComputeQueue(indices.graphicsFamily.value());
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        if (m_ComputeQueueFamily.has_value()) uniqueQueueFamilies.insert(m_ComputeQueueFamily.value());
 
-        float queuePriority = 1.0f;
+        const float queuePriorities[] = { 1.0f, 1.0f };
         for (uint32_t queueFamily : uniqueQueueFamilies)
         {
             VkDeviceQueueCreateInfo queueCreateInfo{};
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queueCreateInfo.queueFamilyIndex = queueFamily;
-            queueCreateInfo.queueCount = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
+            queueCreateInfo.queueCount = m_ComputeQueueFamily == queueFamily ? m_ComputeQueueIndex + 1 : 1;
+            queueCreateInfo.pQueuePriorities = queuePriorities;
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
@@ -269,6 +274,13 @@ namespace cat
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+        // optional, the per pass statistics are skipped without them
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+        m_HasPipelineStatistics = supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+        deviceFeatures.pipelineStatisticsQuery = m_HasPipelineStatistics;
+        deviceFeatures.inheritedQueries = m_HasPipelineStatistics;
+
 
 
         // 3. Creating the logical device
@@ -280,14 +292,23 @@ namespace cat
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-        createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+        const std::vector<const char*> deviceExtensions = GetDeviceExtensions();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
         VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
 			.dynamicRendering = VK_TRUE
         };
 
+        // timeline semaphores order the graphics & async compute batches, the frame timestamps are reset on the host
+        VkPhysicalDeviceVulkan12Features vulkan12Features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+            .hostQueryReset = VK_TRUE,
+            .timelineSemaphore = VK_TRUE
+        };
+
+        dynamicRenderingFeatures.pNext = &vulkan12Features;
 		createInfo.pNext = &dynamicRenderingFeatures;
 
 
@@ -310,6 +331,10 @@ namespace cat
         DebugLabel::Init(m_Device);
         vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
         vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_PresentQueue);
+        if (m_ComputeQueueFamily.has_value())
+        {
+            vkGetDeviceQueue(m_Device, m_ComputeQueueFamily.value(), m_ComputeQueueIndex, &m_ComputeQueue);
+        }
 
         vkCmdBeginRenderingKHR = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdBeginRenderingKHR");
         vkCmdEndRenderingKHR = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdEndRenderingKHR");
@@ -321,6 +346,35 @@ namespace cat
 
     }
 
+    void Device::FindAsyncComputeQueue(uint32_t graphicsFamily)
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        // a compute family without graphics maps to the dedicated compute engines on most GPUs
+        for (uint32_t i{ 0 }; i < queueFamilyCount; ++i)
+        {
+            const VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                m_ComputeQueueFamily = i;
+                m_ComputeQueueIndex = 0;
+                m_SharedQueueFamilies = { graphicsFamily, i };
+                return;
+            }
+        }
+
+        // otherwise a second queue of the graphics family, the driver may still overlap the two
+        if (queueFamilies[graphicsFamily].queueCount > 1)
+        {
+            m_ComputeQueueFamily = graphicsFamily;
+            m_ComputeQueueIndex = 1;
+        }
+    }
+
     void Device::CreateCommandPool()
     {
         QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_PhysicalDevice);
@@ -434,13 +488,17 @@ namespace cat
         EndSingleTimeCommands(commandBuffer);
     }
 
-    std::vector<const char*> Device::GetRequiredExtensions() // Extension for Message Callback
+    std::vector<const char*> Device::GetRequiredExtensions() const // Extension for Message Callback
     {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // the surface extensions, glfw is not even initialized headless
+        std::vector<const char*> extensions{};
+        if (!IsHeadless())
+        {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         // Add this for dynamic rendering support!
         extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
@@ -477,8 +535,8 @@ namespace cat
 
         bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported)
+        bool swapChainAdequate = IsHeadless();
+        if (extensionsSupported && !IsHeadless())
         {
             SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -512,8 +570,9 @@ namespace cat
                 indices.graphicsFamily = i;
             }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+            // nothing is presented headless
+            VkBool32 presentSupport = IsHeadless() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            if (!IsHeadless()) vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
             if (presentSupport)
             {
                 indices.presentFamily = i;
@@ -531,7 +590,18 @@ namespace cat
         return indices;
     }
 
-    bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+    std::vector<const char*> Device::GetDeviceExtensions() const
+    {
+        std::vector<const char*> extensions = DEVICE_EXTENSIONS;
+        if (IsHeadless())
+        {
+            extensions.erase(std::remove_if(extensions.begin(), extensions.end(),
+                [](const char* extension) { return std::strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; }), extensions.end());
+        }
+        return extensions;
+    }
+
+    bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice device) const
     {
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -539,7 +609,8 @@ namespace cat
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end());
+        const std::vector<const char*> deviceExtensions = GetDeviceExtensions();
+        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
         for (const auto& extension : availableExtensions)
         {
@@ -629,4 +700,67 @@ namespace cat
         }
     }
 
+    void Device::CreatePipelineCache()
+    {
+        std::vector<char> data;
+        std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+        if (file.is_open())
+        {
+            data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+
+        // a cache of another driver or GPU is ignored, the driver would reject it anyway
+        if (!data.empty() && !IsPipelineCacheCompatible(data))
+        {
+            std::cout << "Pipeline cache: " << PIPELINE_CACHE_PATH << " was written by another device or driver, starting cold" << std::endl;
+            data.clear();
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(m_Device, &cacheInfo, nullptr, &m_PipelineCache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+        m_PipelineStats.isCacheWarm = !data.empty();
+    }
+
+    bool Device::IsPipelineCacheCompatible(const std::vector<char>& data) const
+    {
+        VkPipelineCacheHeaderVersionOne header{};
+        if (data.size() < sizeof(header))
+            return false;
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        return header.headerSize >= sizeof(header)
+            && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && header.vendorID == m_PhysicalDeviceProperties.vendorID
+            && header.deviceID == m_PhysicalDeviceProperties.deviceID
+            && std::memcmp(header.pipelineCacheUUID, m_PhysicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    void Device::SavePipelineCache() const
+    {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+            return;
+
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &size, data.data()) != VK_SUCCESS)
+            return;
+
+        std::ofstream file(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Pipeline cache: failed to write " << PIPELINE_CACHE_PATH << std::endl;
+            return;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+    }
+
 }
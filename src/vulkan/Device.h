@@ -1,11 +1,16 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
+#include <string>
 #include <vector>
 #include <optional>
 #include <vulkan/vulkan.h>
@@ -33,7 +38,7 @@ const std::vector<const char*> VALIDATION_LAYERS =
 };
 
 
-// Device Extensions
+// Device Extensions, a headless device leaves out the swapchain
 const std::vector<const char*> DEVICE_EXTENSIONS =
 {
 	VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
@@ -100,8 +105,29 @@ struct SwapChainSupportDetails
 	class Device final
 	{
 	public:
+		// the pipeline cache is loaded on creation & saved on destruction, next to the executable's working directory
+		static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+		// counted per pass on the graphics queue by the frame submitter, secondary command buffers inherit the query
+		static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+		// pipelines created since the device was, see Pipeline
+		struct PipelineCreationStats
+		{
+			uint32_t pipelineCount = 0;
+			double totalMs = 0.0;
+			bool isCacheWarm = false;	// the cache was loaded from disk
+		};
+
 		// CTOR & DTOR
 		//--------------------
+		// without a window the device is headless, it has no surface & renders offscreen only
 		Device(GLFWwindow* window);
 		~Device();
 
@@ -124,6 +150,20 @@ struct SwapChainSupportDetails
 		void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout& oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
 		void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+
+		// concurrent between the graphics & the async compute family when they differ,
+		// the render graph then hands resources between the queues without ownership transfers
+		template<typename CreateInfo>
+		void SetSharingMode(CreateInfo& createInfo) const
+		{
+			createInfo.sharingMode = m_SharedQueueFamilies.empty() ? VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT;
+			createInfo.queueFamilyIndexCount = static_cast<uint32_t>(m_SharedQueueFamilies.size());
+			createInfo.pQueueFamilyIndices = m_SharedQueueFamilies.data();
+		}
+
+		// writes the pipeline cache to PIPELINE_CACHE_PATH, also done on destruction
+		void SavePipelineCache() const;
+		void AddPipelineCreationTime(double ms) { ++m_PipelineStats.pipelineCount; m_PipelineStats.totalMs += ms; }
 	
 
 		// Getters & Setters
@@ -131,14 +171,23 @@ struct SwapChainSupportDetails
 		VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
 		VkInstance GetInstance() const { return m_Instance; }
 		VkSurfaceKHR GetSurface() const { return m_Surface; }
+		bool IsHeadless() const { return m_Window == nullptr; }
 		VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
 		VkQueue GetPresentQueue() const { return m_PresentQueue; }
+		// VK_NULL_HANDLE when the GPU has neither a compute family without graphics nor a second graphics queue
+		VkQueue GetComputeQueue() const { return m_ComputeQueue; }
+		bool HasAsyncComputeQueue() const { return m_ComputeQueue != VK_NULL_HANDLE; }
+		uint32_t GetComputeQueueFamily() const { return m_ComputeQueueFamily.value(); }
+		// pipeline statistics queries that stay active across the secondary command buffers
+		bool HasPipelineStatistics() const { return m_HasPipelineStatistics; }
 		VkCommandPool GetCommandPool() const { return m_CommandPool; } 
 		SwapChainSupportDetails GetSwapChainSupport()const { return QuerySwapChainSupport(m_PhysicalDevice); }
 		QueueFamilyIndices GetPhysicalQueueFamilies()const { return FindQueueFamilies(m_PhysicalDevice); }
 		VmaAllocator GetAllocator() const { return m_Allocator; }
 		VkFormatProperties GetFormatProperties(VkFormat format) const;
 		VkPhysicalDeviceProperties GetPhysicalDeviceProperties() const { return m_PhysicalDeviceProperties; }
+		VkPipelineCache GetPipelineCache() const { return m_PipelineCache; }
+		const PipelineCreationStats& GetPipelineCreationStats() const { return m_PipelineStats; }
 
 	private:
 		// Private Methods
@@ -150,18 +199,23 @@ struct SwapChainSupportDetails
 		void CreateSurface();
 		void PickPhysicalDevice();
 		void CreateLogicalDevice();
+		void FindAsyncComputeQueue(uint32_t graphicsFamily);
 		void CreateCommandPool();
 		void AllocVmaAllocator();
+		void CreatePipelineCache();
 
 		// Helpers
 		static bool CheckValidationLayerSupport();
-		static std::vector<const char*> GetRequiredExtensions();
+		std::vector<const char*> GetRequiredExtensions() const;
+		std::vector<const char*> GetDeviceExtensions() const;
 		static void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 		static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
 		bool IsDeviceSuitable(VkPhysicalDevice device) const;
 		QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device) const;
-		static bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+		bool CheckDeviceExtensionSupport(VkPhysicalDevice device) const;
 		SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device) const;
+		// false when the data was written by another driver or GPU
+		bool IsPipelineCacheCompatible(const std::vector<char>& data) const;
 
 		// Private Members
 		//--------------------
@@ -171,12 +225,20 @@ struct SwapChainSupportDetails
 		VkDevice m_Device;
 		VkQueue m_GraphicsQueue;
 		VkQueue m_PresentQueue;
-		VkSurfaceKHR m_Surface;
+		VkQueue m_ComputeQueue = VK_NULL_HANDLE;
+		std::optional<uint32_t> m_ComputeQueueFamily;
+		uint32_t m_ComputeQueueIndex = 0;
+		std::vector<uint32_t> m_SharedQueueFamilies{};	// empty while both queues share a family
+		bool m_HasPipelineStatistics = false;
+		VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
 		VkCommandPool m_CommandPool;
 		VkPhysicalDeviceProperties m_PhysicalDeviceProperties{};
 
 		VmaAllocator m_Allocator{};
 
+		VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+		PipelineCreationStats m_PipelineStats{};
+
 		GLFWwindow* m_Window;
 	};
 }
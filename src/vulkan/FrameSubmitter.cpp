@@ -0,0 +1,408 @@
+#include "FrameSubmitter.h"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vulkan/vk_enum_string_helper.h>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	FrameSubmitter::FrameSubmitter(Device& device, uint32_t framesInFlight)
+		: m_Device(device), m_Frames(framesInFlight)
+	{
+		// TIMELINES
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		for (VkSemaphore& timeline : m_Timelines)
+		{
+			if (vkCreateSemaphore(m_Device.GetDevice(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create timeline semaphore!");
+			}
+		}
+
+		// the overlap needs comparable timestamps on both queues
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_Device.GetPhysicalDevice(), &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_Device.GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+		const uint32_t graphicsFamily = m_Device.GetPhysicalQueueFamilies().graphicsFamily.value();
+		m_HasTimestamps = queueFamilies[graphicsFamily].timestampValidBits > 0 &&
+			(!m_Device.HasAsyncComputeQueue() || queueFamilies[m_Device.GetComputeQueueFamily()].timestampValidBits > 0);
+		m_TimestampPeriod = m_Device.GetPhysicalDeviceProperties().limits.timestampPeriod;
+		m_HasPipelineStatistics = m_Device.HasPipelineStatistics();
+
+		// PER FRAME
+		for (FrameResources& frame : m_Frames)
+		{
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole every frame
+
+			poolInfo.queueFamilyIndex = graphicsFamily;
+			if (vkCreateCommandPool(m_Device.GetDevice(), &poolInfo, nullptr, &frame.commandPools[ToIndex(RenderGraph::QueueType::Graphics)]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create frame command pool!");
+			}
+
+			if (m_Device.HasAsyncComputeQueue())
+			{
+				poolInfo.queueFamilyIndex = m_Device.GetComputeQueueFamily();
+				if (vkCreateCommandPool(m_Device.GetDevice(), &poolInfo, nullptr, &frame.commandPools[ToIndex(RenderGraph::QueueType::Compute)]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create frame command pool!");
+				}
+			}
+
+			if (m_HasTimestamps)
+			{
+				VkQueryPoolCreateInfo queryPoolInfo{};
+				queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+				queryPoolInfo.queryCount = MAX_TIMED_BATCHES * 2;
+
+				if (vkCreateQueryPool(m_Device.GetDevice(), &queryPoolInfo, nullptr, &frame.queryPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create timestamp query pool!");
+				}
+				vkResetQueryPool(m_Device.GetDevice(), frame.queryPool, 0, queryPoolInfo.queryCount);
+
+				queryPoolInfo.queryCount = MAX_QUERIED_PASSES * 2;
+				if (vkCreateQueryPool(m_Device.GetDevice(), &queryPoolInfo, nullptr, &frame.passQueryPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create timestamp query pool!");
+				}
+				vkResetQueryPool(m_Device.GetDevice(), frame.passQueryPool, 0, queryPoolInfo.queryCount);
+			}
+
+			if (m_HasPipelineStatistics)
+			{
+				VkQueryPoolCreateInfo queryPoolInfo{};
+				queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+				queryPoolInfo.queryCount = MAX_QUERIED_PASSES;
+
+				// a compute only family can not count graphics statistics
+				for (size_t queue{ 0 }; queue < frame.statisticsQueryPools.size(); ++queue)
+				{
+					if (frame.commandPools[queue] == VK_NULL_HANDLE) continue;
+
+					queryPoolInfo.pipelineStatistics = queue == ToIndex(RenderGraph::QueueType::Graphics)
+						? Device::PIPELINE_STATISTICS : VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+					if (vkCreateQueryPool(m_Device.GetDevice(), &queryPoolInfo, nullptr, &frame.statisticsQueryPools[queue]) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create pipeline statistics query pool!");
+					}
+					vkResetQueryPool(m_Device.GetDevice(), frame.statisticsQueryPools[queue], 0, queryPoolInfo.queryCount);
+				}
+			}
+		}
+	}
+
+	FrameSubmitter::~FrameSubmitter()
+	{
+		for (FrameResources& frame : m_Frames)
+		{
+			for (VkCommandPool commandPool : frame.commandPools)
+			{
+				if (commandPool != VK_NULL_HANDLE) vkDestroyCommandPool(m_Device.GetDevice(), commandPool, nullptr);
+			}
+			if (frame.queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_Device.GetDevice(), frame.queryPool, nullptr);
+			if (frame.passQueryPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_Device.GetDevice(), frame.passQueryPool, nullptr);
+			for (VkQueryPool queryPool : frame.statisticsQueryPools)
+			{
+				if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_Device.GetDevice(), queryPool, nullptr);
+			}
+		}
+
+		for (VkSemaphore timeline : m_Timelines)
+		{
+			vkDestroySemaphore(m_Device.GetDevice(), timeline, nullptr);
+		}
+	}
+
+
+	// Methods
+	//--------------------
+	void FrameSubmitter::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		ReadQueueTimes(frameIndex);
+		ReadPassResults(frameIndex);
+
+		FrameResources& frame = m_Frames[frameIndex];
+		for (size_t queue{ 0 }; queue < frame.commandPools.size(); ++queue)
+		{
+			if (frame.commandPools[queue] != VK_NULL_HANDLE) vkResetCommandPool(m_Device.GetDevice(), frame.commandPools[queue], 0);
+			frame.usedCommandBuffers[queue] = 0;
+		}
+		frame.timedBatches.clear();
+		frame.queriedPasses.clear();
+	}
+
+	RenderGraph::Batch FrameSubmitter::BeginBatch(RenderGraph::QueueType queue, std::vector<RenderGraph::Wait> waits)
+	{
+		FrameResources& frame = m_Frames[m_FrameIndex];
+		const size_t queueIndex = ToIndex(queue);
+
+		if (frame.commandPools[queueIndex] == VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("failed to begin batch, the device has no async compute queue!");
+		}
+
+		auto& commandBuffers = frame.commandBuffers[queueIndex];
+		if (frame.usedCommandBuffers[queueIndex] == commandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.commandPools[queueIndex];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer{};
+			if (vkAllocateCommandBuffers(m_Device.GetDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+			commandBuffers.push_back(commandBuffer);
+		}
+
+		VkCommandBuffer commandBuffer = commandBuffers[frame.usedCommandBuffers[queueIndex]++];
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to begin command buffer!");
+		}
+
+		// the start is taken at the earliest waiting stage, so the time spent waiting on the other queue does not count as busy
+		if (m_HasTimestamps && frame.timedBatches.size() < MAX_TIMED_BATCHES)
+		{
+			VkPipelineStageFlags waitStageMask = 0;
+			for (const auto& wait : waits) waitStageMask |= wait.stageMask;
+			const auto startStage = static_cast<VkPipelineStageFlagBits>(waitStageMask == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : waitStageMask & ~(waitStageMask - 1));
+
+			const uint32_t query = static_cast<uint32_t>(frame.timedBatches.size()) * 2;
+			vkCmdWriteTimestamp(commandBuffer, startStage, frame.queryPool, query);
+			frame.timedBatches.push_back(queue);
+		}
+
+		return { queue, commandBuffer, ++m_TimelineValues[queueIndex], std::move(waits) };
+	}
+
+	void FrameSubmitter::Submit(const std::vector<RenderGraph::Batch>& batches, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence)
+	{
+		const FrameResources& frame = m_Frames[m_FrameIndex];
+
+		const auto isGraphics = [](const RenderGraph::Batch& batch) { return batch.queue == RenderGraph::QueueType::Graphics; };
+		const auto firstGraphics = std::find_if(batches.begin(), batches.end(), isGraphics);
+		const auto lastGraphics = std::find_if(batches.rbegin(), batches.rend(), isGraphics);
+		if (firstGraphics == batches.end())
+		{
+			throw std::runtime_error("failed to submit frame, it has no graphics batch!");
+		}
+
+		for (size_t batchIndex{ 0 }; batchIndex < batches.size(); ++batchIndex)
+		{
+			const RenderGraph::Batch& batch = batches[batchIndex];
+			const bool isFirst = &batch == &*firstGraphics;
+			const bool isLast = &batch == &*lastGraphics;
+
+			if (batchIndex < frame.timedBatches.size())
+			{
+				vkCmdWriteTimestamp(batch.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, static_cast<uint32_t>(batchIndex) * 2 + 1);
+			}
+
+			if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record command buffer!");
+			}
+
+			// binary semaphores take no value, theirs are ignored
+			std::vector<VkSemaphore> waitSemaphores{};
+			std::vector<uint64_t> waitValues{};
+			std::vector<VkPipelineStageFlags> waitStages{};
+			for (const auto& wait : batch.waits)
+			{
+				waitSemaphores.push_back(m_Timelines[ToIndex(wait.queue)]);
+				waitValues.push_back(wait.value);
+				waitStages.push_back(wait.stageMask);
+			}
+			if (isFirst && waitSemaphore != VK_NULL_HANDLE)
+			{
+				waitSemaphores.push_back(waitSemaphore);
+				waitValues.push_back(0);
+				waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			}
+
+			std::vector<VkSemaphore> signalSemaphores{ m_Timelines[ToIndex(batch.queue)] };
+			std::vector<uint64_t> signalValues{ batch.signalValue };
+			if (isLast && signalSemaphore != VK_NULL_HANDLE)
+			{
+				signalSemaphores.push_back(signalSemaphore);
+				signalValues.push_back(0);
+			}
+
+			VkTimelineSemaphoreSubmitInfo timelineInfo{};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+			timelineInfo.pWaitSemaphoreValues = waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+			timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.pNext = &timelineInfo;
+			submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+			submitInfo.pWaitSemaphores = waitSemaphores.data();
+			submitInfo.pWaitDstStageMask = waitStages.data();
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch.commandBuffer;
+			submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+			submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+			const VkQueue queue = isGraphics(batch) ? m_Device.GetGraphicsQueue() : m_Device.GetComputeQueue();
+			const VkResult result = vkQueueSubmit(queue, 1, &submitInfo, isLast ? fence : VK_NULL_HANDLE);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit draw command buffer!" + std::string(string_VkResult(result)));
+			}
+		}
+	}
+
+	void FrameSubmitter::BeginPassQueries(VkCommandBuffer commandBuffer, PerformanceTimer::MetricId metric)
+	{
+		FrameResources& frame = m_Frames[m_FrameIndex];
+		m_IsQueryingPass = (m_HasTimestamps || m_HasPipelineStatistics) && frame.queriedPasses.size() < MAX_QUERIED_PASSES;
+		if (!m_IsQueryingPass) return;
+
+		// the batches of the compute queue come from its own pool
+		const auto& computeBuffers = frame.commandBuffers[ToIndex(RenderGraph::QueueType::Compute)];
+		const RenderGraph::QueueType queue = std::find(computeBuffers.begin(), computeBuffers.end(), commandBuffer) != computeBuffers.end()
+			? RenderGraph::QueueType::Compute : RenderGraph::QueueType::Graphics;
+
+		const uint32_t pass = static_cast<uint32_t>(frame.queriedPasses.size());
+		if (m_HasTimestamps) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.passQueryPool, pass * 2);
+		if (m_HasPipelineStatistics) vkCmdBeginQuery(commandBuffer, frame.statisticsQueryPools[ToIndex(queue)], pass, 0);
+		frame.queriedPasses.push_back({ metric, queue });
+	}
+
+	void FrameSubmitter::EndPassQueries(VkCommandBuffer commandBuffer)
+	{
+		if (!m_IsQueryingPass) return;
+		m_IsQueryingPass = false;
+
+		FrameResources& frame = m_Frames[m_FrameIndex];
+		const uint32_t pass = static_cast<uint32_t>(frame.queriedPasses.size()) - 1;
+		if (m_HasPipelineStatistics) vkCmdEndQuery(commandBuffer, frame.statisticsQueryPools[ToIndex(frame.queriedPasses.back().queue)], pass);
+		if (m_HasTimestamps) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.passQueryPool, pass * 2 + 1);
+	}
+
+
+	// Private Methods
+	//--------------------
+	void FrameSubmitter::ReadQueueTimes(uint32_t frameIndex)
+	{
+		FrameResources& frame = m_Frames[frameIndex];
+		const uint32_t queryCount = static_cast<uint32_t>(frame.timedBatches.size()) * 2;
+		if (queryCount == 0) return;
+
+		std::vector<uint64_t> ticks(queryCount);
+		const VkResult result = vkGetQueryPoolResults(m_Device.GetDevice(), frame.queryPool, 0, queryCount,
+			ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		vkResetQueryPool(m_Device.GetDevice(), frame.queryPool, 0, queryCount);
+
+		if (result != VK_SUCCESS) return;
+
+		// batches of one queue run one after another, the overlap is the intersection with every batch of the other queue
+		QueueTimes times{};
+		for (size_t i{ 0 }; i < frame.timedBatches.size(); ++i)
+		{
+			const uint64_t start = ticks[i * 2];
+			const uint64_t end = std::max(ticks[i * 2 + 1], start);
+			const double ms = static_cast<double>(end - start) * m_TimestampPeriod / 1'000'000.0;
+
+			if (frame.timedBatches[i] == RenderGraph::QueueType::Graphics)
+			{
+				times.graphicsMs += ms;
+				continue;
+			}
+			times.computeMs += ms;
+
+			for (size_t j{ 0 }; j < frame.timedBatches.size(); ++j)
+			{
+				if (frame.timedBatches[j] != RenderGraph::QueueType::Graphics) continue;
+
+				const uint64_t overlapStart = std::max(start, ticks[j * 2]);
+				const uint64_t overlapEnd = std::min(end, ticks[j * 2 + 1]);
+				if (overlapEnd > overlapStart) times.overlapMs += static_cast<double>(overlapEnd - overlapStart) * m_TimestampPeriod / 1'000'000.0;
+			}
+		}
+		m_QueueTimes = times;
+	}
+	void FrameSubmitter::ReadPassResults(uint32_t frameIndex)
+	{
+		static_assert(sizeof(PipelineStatistics) == 6 * sizeof(uint64_t), "PipelineStatistics has to match the query results");
+		m_PassResults.clear();
+
+		FrameResources& frame = m_Frames[frameIndex];
+		const uint32_t passCount = static_cast<uint32_t>(frame.queriedPasses.size());
+		if (passCount == 0) return;
+
+		m_PassResults.resize(passCount);
+		for (uint32_t pass{ 0 }; pass < passCount; ++pass)
+		{
+			m_PassResults[pass].pass = frame.queriedPasses[pass].pass;
+		}
+
+		// the fence signaled, the results are there without waiting
+		if (m_HasTimestamps)
+		{
+			std::vector<uint64_t> ticks(passCount * 2);
+			const VkResult result = vkGetQueryPoolResults(m_Device.GetDevice(), frame.passQueryPool, 0, passCount * 2,
+				ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+			vkResetQueryPool(m_Device.GetDevice(), frame.passQueryPool, 0, passCount * 2);
+
+			for (uint32_t pass{ 0 }; result == VK_SUCCESS && pass < passCount; ++pass)
+			{
+				const uint64_t start = ticks[pass * 2];
+				const uint64_t end = std::max(ticks[pass * 2 + 1], start);
+				m_PassResults[pass].gpuMs = static_cast<double>(end - start) * m_TimestampPeriod / 1'000'000.0;
+			}
+		}
+
+		// a pass only has a query in the pool of its queue, they are read one by one
+		if (m_HasPipelineStatistics)
+		{
+			for (uint32_t pass{ 0 }; pass < passCount; ++pass)
+			{
+				const VkQueryPool queryPool = frame.statisticsQueryPools[ToIndex(frame.queriedPasses[pass].queue)];
+				PipelineStatistics& statistics = m_PassResults[pass].statistics;
+
+				const bool isGraphics = frame.queriedPasses[pass].queue == RenderGraph::QueueType::Graphics;
+				uint64_t* pData = isGraphics ? &statistics.inputVertices : &statistics.computeInvocations;
+				const size_t dataSize = isGraphics ? sizeof(PipelineStatistics) : sizeof(uint64_t);
+
+				if (vkGetQueryPoolResults(m_Device.GetDevice(), queryPool, pass, 1, dataSize, pData, dataSize, VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+				{
+					statistics = {};
+				}
+				vkResetQueryPool(m_Device.GetDevice(), queryPool, pass, 1);
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "RenderGraph.h"
+#include "utils/PerformanceTimer.h"
+
+// std
+#include <array>
+#include <string>
+#include <vector>
+
+namespace cat
+{
+	// Records & submits the batches the render graph splits a frame into, on the graphics & the async compute queue.
+	//	- every queue owns a timeline semaphore, a batch signals the value handed out here & waits on the other queue's values,
+	//	- every frame in flight owns a command pool per queue, its command buffers are reused once the frame's fence signaled,
+	//	- every batch is bracketed by timestamps, the busy time of both queues & their overlap are read back with the fence,
+	//	- so is every pass the render graph records, its GPU time & pipeline statistics are read back the same way.
+	class FrameSubmitter final
+	{
+	public:
+		static constexpr uint32_t MAX_TIMED_BATCHES = 16;	// per frame, later batches run without timestamps
+		static constexpr uint32_t MAX_QUERIED_PASSES = 64;	// per frame, later passes run without timestamps & statistics
+
+		// GPU time of the last frame that was read back
+		struct QueueTimes
+		{
+			double graphicsMs = 0.0;	// graphics batches busy
+			double computeMs = 0.0;		// async compute batches busy
+			double overlapMs = 0.0;		// both busy at once
+		};
+
+		// a pass of the last frame that was read back, in recording order
+		struct PassResult
+		{
+			PerformanceTimer::MetricId pass = PerformanceTimer::INVALID_METRIC;
+			double gpuMs = 0.0;
+			PipelineStatistics statistics{};	// only compute invocations on the async compute queue
+		};
+
+		// CTOR & DTOR
+		//------------------------------
+		FrameSubmitter(Device& device, uint32_t framesInFlight);
+		~FrameSubmitter();
+
+		FrameSubmitter(const FrameSubmitter&) = delete;
+		FrameSubmitter& operator=(const FrameSubmitter&) = delete;
+		FrameSubmitter(FrameSubmitter&&) = delete;
+		FrameSubmitter& operator=(FrameSubmitter&&) = delete;
+
+
+		// METHODS
+		//------------------------------
+		// call once the frame's fence signaled, reads the timestamps of the last frame in this slot & resets its command pools
+		void BeginFrame(uint32_t frameIndex);
+		// see RenderGraph::BeginBatchFunction
+		RenderGraph::Batch BeginBatch(RenderGraph::QueueType queue, std::vector<RenderGraph::Wait> waits);
+		// ends & submits the batches in order. The first graphics batch also waits for waitSemaphore,
+		// the last one signals signalSemaphore & the fence, either semaphore may be VK_NULL_HANDLE
+		void Submit(const std::vector<RenderGraph::Batch>& batches, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence);
+		// bracket the commands of a pass with the timestamps & statistics query, see RenderGraph::SetPassCallbacks
+		void BeginPassQueries(VkCommandBuffer commandBuffer, PerformanceTimer::MetricId pass);
+		void EndPassQueries(VkCommandBuffer commandBuffer);
+
+		// Getters & Setters
+		const QueueTimes& GetQueueTimes() const { return m_QueueTimes; }
+		const std::vector<PassResult>& GetPassResults() const { return m_PassResults; }
+
+	private:
+		// Private methods
+		//------------------------------
+		void ReadQueueTimes(uint32_t frameIndex);
+		void ReadPassResults(uint32_t frameIndex);
+
+		static size_t ToIndex(RenderGraph::QueueType queue) { return static_cast<size_t>(queue); }
+
+		// Private members
+		//------------------------------
+		struct QueriedPass
+		{
+			PerformanceTimer::MetricId pass;
+			RenderGraph::QueueType queue;
+		};
+
+		struct FrameResources
+		{
+			std::array<VkCommandPool, 2> commandPools{};					// per queue, none for compute without an async queue
+			std::array<std::vector<VkCommandBuffer>, 2> commandBuffers{};	// allocated on demand
+			std::array<uint32_t, 2> usedCommandBuffers{};
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::vector<RenderGraph::QueueType> timedBatches{};			// queue of every timestamped batch, in order
+			VkQueryPool passQueryPool = VK_NULL_HANDLE;					// timestamps, 2 per pass
+			std::array<VkQueryPool, 2> statisticsQueryPools{};			// per queue, compute only counts its invocations
+			std::vector<QueriedPass> queriedPasses{};					// in order, the query index is the position
+		};
+
+		Device& m_Device;
+		std::vector<FrameResources> m_Frames;
+		uint32_t m_FrameIndex = 0;
+
+		std::array<VkSemaphore, 2> m_Timelines{};
+		std::array<uint64_t, 2> m_TimelineValues{};	// last value handed out per queue
+
+		bool m_HasTimestamps = false;
+		double m_TimestampPeriod = 1.0;	// ns per tick
+		QueueTimes m_QueueTimes{};
+		bool m_HasPipelineStatistics = false;
+		std::vector<PassResult> m_PassResults{};
+		bool m_IsQueryingPass = false;	// the pass being recorded began its queries
+	};
+}
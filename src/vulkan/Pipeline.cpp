@@ -1,12 +1,44 @@
 #include "Pipeline.h"
 
+#include "../core/ThreadPool.h"
+
+// std
+#include <chrono>
+#include <future>
+
 namespace cat
 {
 	Pipeline::Pipeline(Device& device, const std::string& vertPath, const std::string& fragPath, const PipelineInfo& pipelineInfo)
 		:   m_PipelineLayout(pipelineInfo.pipelineLayout), m_VertPath(vertPath),
 		m_FragPath(fragPath), m_Device(device)
 	{
-		CreateGraphicsPipeline(pipelineInfo);
+		if (PipelineBatch* pBatch = PipelineBatch::GetOpenBatch())
+		{
+			DeferToBatch(*pBatch, pipelineInfo);
+			return;
+		}
+
+		const VkShaderModule vertShaderModule = m_VertPath.empty() ? VK_NULL_HANDLE : CreateShaderModule(ReadFile(m_VertPath));
+		const VkShaderModule fragShaderModule = m_FragPath.empty() ? VK_NULL_HANDLE : CreateShaderModule(ReadFile(m_FragPath));
+		m_Device.AddPipelineCreationTime(CreateGraphicsPipeline(pipelineInfo, vertShaderModule, fragShaderModule));
+
+		vkDestroyShaderModule(m_Device.GetDevice(), fragShaderModule, nullptr);
+		vkDestroyShaderModule(m_Device.GetDevice(), vertShaderModule, nullptr);
+	}
+
+	Pipeline::Pipeline(Device& device, const std::string& compPath, const PipelineInfo& pipelineInfo)
+		: m_PipelineLayout(pipelineInfo.pipelineLayout), m_BindPoint(VK_PIPELINE_BIND_POINT_COMPUTE), m_CompPath(compPath), m_Device(device)
+	{
+		if (PipelineBatch* pBatch = PipelineBatch::GetOpenBatch())
+		{
+			DeferToBatch(*pBatch, pipelineInfo);
+			return;
+		}
+
+		const VkShaderModule compShaderModule = CreateShaderModule(ReadFile(m_CompPath));
+		m_Device.AddPipelineCreationTime(CreateComputePipeline(pipelineInfo, compShaderModule));
+
+		vkDestroyShaderModule(m_Device.GetDevice(), compShaderModule, nullptr);
 	}
 
     Pipeline::~Pipeline()
@@ -16,42 +48,47 @@ namespace cat
     }
 
 
-    void Pipeline::CreateGraphicsPipeline(const PipelineInfo& pipelineInfo)
+    void Pipeline::DeferToBatch(PipelineBatch& batch, const PipelineInfo& pipelineInfo)
+    {
+        m_pDeferredInfo = std::make_unique<PipelineInfo>(pipelineInfo);
+        m_pDeferredInfo->dynamicState.pDynamicStates = m_pDeferredInfo->dynamicStates.data();
+        m_pDeferredInfo->colorBlending.pAttachments = m_pDeferredInfo->colorBlendAttachments.data();
+
+        batch.Add(this);
+    }
+
+    double Pipeline::CreateGraphicsPipeline(const PipelineInfo& pipelineInfo, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule)
     {
         // Shader stage creation
         //-------------------
 		std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+        std::vector<VkSpecializationMapEntry> specializationEntries;
+        const VkSpecializationInfo specializationInfo = GetSpecializationInfo(pipelineInfo, specializationEntries);
+        const VkSpecializationInfo* pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
 
         //VERTEX
-        VkShaderModule vertShaderModule {VK_NULL_HANDLE};
-        if (!m_VertPath.empty())
+        if (vertShaderModule != VK_NULL_HANDLE)
         {
-            auto vertShaderCode = ReadFile(m_VertPath);
-            vertShaderModule = CreateShaderModule(vertShaderCode);
-
             VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
             vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;    //obligatory
             vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;    // tells vulkan in which pipeline stage the shader is going to be used
 
             vertShaderStageInfo.module = vertShaderModule;
             vertShaderStageInfo.pName = "main";   // the function to invoke = entry point (multip frag shaders can be combined into a single shader module and use diff entry point to differentiate between the behaviours)
-            // pSpecializationInfo   ->>>>   It allows you to specify values for shader constants.(autom nullptr -> no constants)
+            vertShaderStageInfo.pSpecializationInfo = pSpecializationInfo;   // values for the shader's specialization constants, nullptr -> the defaults
 
 			shaderStages.push_back(vertShaderStageInfo);
         }
 
         //FRAGMENT
-        VkShaderModule fragShaderModule{ VK_NULL_HANDLE };
-        if (!m_FragPath.empty())
+        if (fragShaderModule != VK_NULL_HANDLE)
 		{
-			auto fragShaderCode = ReadFile(m_FragPath);
-        	fragShaderModule = CreateShaderModule(fragShaderCode);
-
         	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         	fragShaderStageInfo.module = fragShaderModule;
         	fragShaderStageInfo.pName = "main";
+        	fragShaderStageInfo.pSpecializationInfo = pSpecializationInfo;
 
 			shaderStages.push_back(fragShaderStageInfo);
 		}
@@ -104,16 +141,39 @@ namespace cat
         graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE; //optional
         graphicsPipelineInfo.basePipelineIndex = -1; //optional
 
-        if (vkCreateGraphicsPipelines(m_Device.GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (vkCreateGraphicsPipelines(m_Device.GetDevice(), m_Device.GetPipelineCache(), 1, &graphicsPipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
 
-
-        // Module deletion
-        //-------------------
-			vkDestroyShaderModule(m_Device.GetDevice(), fragShaderModule, nullptr);
-			vkDestroyShaderModule(m_Device.GetDevice(), vertShaderModule, nullptr);
+    double Pipeline::CreateComputePipeline(const PipelineInfo& pipelineInfo, VkShaderModule compShaderModule)
+    {
+        VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+        compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        compShaderStageInfo.module = compShaderModule;
+        compShaderStageInfo.pName = "main";
+
+        std::vector<VkSpecializationMapEntry> specializationEntries;
+        const VkSpecializationInfo specializationInfo = GetSpecializationInfo(pipelineInfo, specializationEntries);
+        compShaderStageInfo.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+
+        VkComputePipelineCreateInfo computePipelineInfo{};
+        computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineInfo.stage = compShaderStageInfo;
+        computePipelineInfo.layout = pipelineInfo.pipelineLayout;
+        computePipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        computePipelineInfo.basePipelineIndex = -1;
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (vkCreateComputePipelines(m_Device.GetDevice(), m_Device.GetPipelineCache(), 1, &computePipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
     }
 
     VkShaderModule Pipeline::CreateShaderModule(const std::vector<char>& code) const
@@ -132,6 +192,22 @@ namespace cat
         return shaderModule;
     }
 
+    VkSpecializationInfo Pipeline::GetSpecializationInfo(const PipelineInfo& pipelineInfo, std::vector<VkSpecializationMapEntry>& entries)
+    {
+        entries.clear();
+        for (uint32_t id{ 0 }; id < pipelineInfo.specializationConstants.size(); ++id)
+        {
+            entries.push_back({ .constantID = id, .offset = id * static_cast<uint32_t>(sizeof(uint32_t)), .size = sizeof(uint32_t) });
+        }
+
+        VkSpecializationInfo info{};
+        info.mapEntryCount = static_cast<uint32_t>(entries.size());
+        info.pMapEntries = entries.data();
+        info.dataSize = pipelineInfo.specializationConstants.size() * sizeof(uint32_t);
+        info.pData = pipelineInfo.specializationConstants.data();
+        return info;
+    }
+
 	std::vector<char> Pipeline::ReadFile(const std::string& filename)
     {
         std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -151,4 +227,93 @@ namespace cat
 
         return buffer;
     }
+
+
+	PipelineBatch::PipelineBatch(Device& device)
+		: m_Device(device)
+	{
+		if (s_pOpenBatch != nullptr)
+		{
+			throw std::runtime_error("failed to open pipeline batch, another batch is still open!");
+		}
+		s_pOpenBatch = this;
+	}
+
+	PipelineBatch::~PipelineBatch()
+	{
+		if (s_pOpenBatch == this)
+			s_pOpenBatch = nullptr;
+
+		for (const auto& [path, shaderModule] : m_ShaderModules)
+		{
+			vkDestroyShaderModule(m_Device.GetDevice(), shaderModule, nullptr);
+		}
+	}
+
+	void PipelineBatch::Compile(ThreadPool* pThreadPool)
+	{
+		// nothing new joins the batch from here on
+		s_pOpenBatch = nullptr;
+
+		// the modules are created up front, the workers only read the map
+		for (const Pipeline* pPipeline : m_pPipelines)
+		{
+			GetShaderModule(*pPipeline, pPipeline->m_VertPath);
+			GetShaderModule(*pPipeline, pPipeline->m_FragPath);
+			GetShaderModule(*pPipeline, pPipeline->m_CompPath);
+		}
+
+		std::vector<double> times(m_pPipelines.size(), 0.0);
+		if (pThreadPool == nullptr)
+		{
+			for (size_t i{ 0 }; i < m_pPipelines.size(); ++i)
+				times[i] = CompilePipeline(*m_pPipelines[i]);
+		}
+		else
+		{
+			std::vector<std::future<double>> futures;
+			futures.reserve(m_pPipelines.size());
+			for (Pipeline* pPipeline : m_pPipelines)
+			{
+				futures.push_back(pThreadPool->Submit([this, pPipeline] { return CompilePipeline(*pPipeline); }));
+			}
+
+			// get rethrows the first failure once every pipeline is done
+			for (auto& future : futures)
+				future.wait();
+			for (size_t i{ 0 }; i < futures.size(); ++i)
+				times[i] = futures[i].get();
+		}
+
+		for (const double ms : times)
+			m_Device.AddPipelineCreationTime(ms);
+	}
+
+	VkShaderModule PipelineBatch::GetShaderModule(const Pipeline& pipeline, const std::string& path)
+	{
+		if (path.empty())
+			return VK_NULL_HANDLE;
+
+		auto it = m_ShaderModules.find(path);
+		if (it == m_ShaderModules.end())
+		{
+			it = m_ShaderModules.emplace(path, pipeline.CreateShaderModule(Pipeline::ReadFile(path))).first;
+		}
+		return it->second;
+	}
+
+	double PipelineBatch::CompilePipeline(Pipeline& pipeline) const
+	{
+		const auto findModule = [this](const std::string& path)
+			{
+				return path.empty() ? VK_NULL_HANDLE : m_ShaderModules.at(path);
+			};
+
+		const double ms = pipeline.m_BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE
+			? pipeline.CreateComputePipeline(*pipeline.m_pDeferredInfo, findModule(pipeline.m_CompPath))
+			: pipeline.CreateGraphicsPipeline(*pipeline.m_pDeferredInfo, findModule(pipeline.m_VertPath), findModule(pipeline.m_FragPath));
+
+		pipeline.m_pDeferredInfo.reset();
+		return ms;
+	}
 }
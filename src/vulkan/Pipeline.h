@@ -1,19 +1,30 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "scene/Mesh.h"
 
 namespace cat
 {
+	class PipelineBatch;
+	class ThreadPool;
+
 	class Pipeline final
 	{
 	public:
@@ -50,6 +61,10 @@ namespace cat
 			// PUSH CONSTANTS
 			VkPushConstantRange pushConstantRanges{};
 
+			// SPECIALIZATION CONSTANTS
+			// 32 bit values for every stage, the index is the constant_id. Bools are VkBool32
+			std::vector<uint32_t> specializationConstants{};
+
 
 			// PIPELINE LAYOUT
 			VkPipelineLayout pipelineLayout;
@@ -163,7 +178,10 @@ namespace cat
 
 		// CTOR & DTOR
 		//--------------------
+		// while a PipelineBatch is open the pipeline is only created by PipelineBatch::Compile
 		Pipeline(Device& device, const std::string& vertPath, const std::string& fragPath, const PipelineInfo& pipelineInfo);
+		// compute pipeline, only the layout & the specialization constants of pipelineInfo are used
+		Pipeline(Device& device, const std::string& compPath, const PipelineInfo& pipelineInfo);
 		~Pipeline();
 
 		Pipeline(const Pipeline&) = delete;
@@ -176,30 +194,41 @@ namespace cat
 		//--------------------
 		void Bind(VkCommandBuffer commandBuffer) const
 		{
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+			vkCmdBindPipeline(commandBuffer, m_BindPoint, m_GraphicsPipeline);
 		}
 
 		// Getters & Setters
 		VkPipeline GetGraphicsPipeline() const { return m_GraphicsPipeline; }
 		VkPipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
+		VkPipelineBindPoint GetBindPoint() const { return m_BindPoint; }
 
 
 	private:
 		// Private Methods
 		//--------------------
-		void CreateGraphicsPipeline(const PipelineInfo& pipelineInfo);
+		// both return the milliseconds the driver took
+		double CreateGraphicsPipeline(const PipelineInfo& pipelineInfo, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule);
+		double CreateComputePipeline(const PipelineInfo& pipelineInfo, VkShaderModule compShaderModule);
+		// the batch keeps a copy of the info, the copy's internal pointers are moved to its own arrays
+		void DeferToBatch(PipelineBatch& batch, const PipelineInfo& pipelineInfo);
 		VkShaderModule CreateShaderModule(const std::vector<char>& code) const;
+		// empty when there are no constants, entries has to outlive the returned info
+		static VkSpecializationInfo GetSpecializationInfo(const PipelineInfo& pipelineInfo, std::vector<VkSpecializationMapEntry>& entries);
 		static std::vector<char> ReadFile(const std::string& filename);
 
+		friend class PipelineBatch;
 
 
 		// Private Members
 		//--------------------
-		VkPipeline m_GraphicsPipeline;
+		VkPipeline m_GraphicsPipeline = VK_NULL_HANDLE;
 		VkPipelineLayout m_PipelineLayout;
+		VkPipelineBindPoint m_BindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
 		const std::string m_VertPath;
 		const std::string m_FragPath;
+		const std::string m_CompPath;
+		std::unique_ptr<PipelineInfo> m_pDeferredInfo;	// until the batch compiled the pipeline
 
 		Device& m_Device;
 		SwapChain* m_pSwapChain;
@@ -207,4 +236,86 @@ namespace cat
 		VkDescriptorSetLayout m_DescriptorSetLayout;
 	};
 
+
+	// Collects the pipelines created while it is open & compiles them concurrently in Compile, sharing the
+	// device's pipeline cache. Every SPIR-V file is read & turned into a shader module once for the whole batch.
+	// Only one batch can be open at a time, the pipelines of the batch must not be used before Compile returned.
+	class PipelineBatch final
+	{
+	public:
+		// CTOR & DTOR
+		//--------------------
+		explicit PipelineBatch(Device& device);
+		~PipelineBatch();
+
+		PipelineBatch(const PipelineBatch&) = delete;
+		PipelineBatch& operator=(const PipelineBatch&) = delete;
+		PipelineBatch(PipelineBatch&&) = delete;
+		PipelineBatch& operator=(PipelineBatch&&) = delete;
+
+		// Methods
+		//--------------------
+		// creates every collected pipeline & closes the batch, pThreadPool = nullptr compiles on the calling thread
+		void Compile(ThreadPool* pThreadPool);
+
+		// Getters & Setters
+		static PipelineBatch* GetOpenBatch() { return s_pOpenBatch; }
+		size_t GetPipelineCount() const { return m_pPipelines.size(); }
+
+	private:
+		friend class Pipeline;
+
+		// Private Methods
+		//--------------------
+		void Add(Pipeline* pPipeline) { m_pPipelines.push_back(pPipeline); }
+		// loaded on first use, destroyed with the batch
+		VkShaderModule GetShaderModule(const Pipeline& pipeline, const std::string& path);
+		// creates one collected pipeline, returns the milliseconds the driver took
+		double CompilePipeline(Pipeline& pipeline) const;
+
+		// Private Members
+		//--------------------
+		Device& m_Device;
+		std::vector<Pipeline*> m_pPipelines;
+		std::unordered_map<std::string, VkShaderModule> m_ShaderModules;
+
+		static inline PipelineBatch* s_pOpenBatch = nullptr;
+	};
+
+
+	// Pipelines of the same shaders that only differ in their specialization constants.
+	// Every variant is created once on first use & kept, the factory builds the pipeline for a set of constants.
+	class PipelineVariants final
+	{
+	public:
+		using Constants = std::vector<uint32_t>;
+		using Factory = std::function<std::unique_ptr<Pipeline>(const Constants& constants)>;
+
+		// CTOR & DTOR
+		//--------------------
+		explicit PipelineVariants(Factory factory) : m_Factory(std::move(factory)) {}
+		~PipelineVariants() = default;
+
+		PipelineVariants(const PipelineVariants&) = delete;
+		PipelineVariants& operator=(const PipelineVariants&) = delete;
+		PipelineVariants(PipelineVariants&&) = delete;
+		PipelineVariants& operator=(PipelineVariants&&) = delete;
+
+		// Methods
+		//--------------------
+		Pipeline& Get(const Constants& constants)
+		{
+			auto& pVariant = m_pVariants[constants];
+			if (!pVariant)
+				pVariant = m_Factory(constants);
+			return *pVariant;
+		}
+
+		// Getters & Setters
+		size_t GetVariantCount() const { return m_pVariants.size(); }
+
+	private:
+		Factory m_Factory;
+		std::map<Constants, std::unique_ptr<Pipeline>> m_pVariants;
+	};
 }
@@ -0,0 +1,525 @@
+#include "RenderGraph.h"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace cat
+{
+	// Pass
+	//--------------------
+	RenderGraph::Pass::Pass(std::string name, uint32_t id, RecordFunction record)
+		: m_Name(std::move(name)), m_Id(id), m_Record(std::move(record))
+	{
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::Read(Image& image, const ImageAccess& access)
+	{
+		m_ImageUsages.push_back({ &image, access, false, false });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::Write(Image& image, const ImageAccess& access, bool discard)
+	{
+		m_ImageUsages.push_back({ &image, access, true, discard });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::ReadBuffer(VkBuffer buffer, VkPipelineStageFlags stageMask, VkAccessFlags accessMask)
+	{
+		m_BufferUsages.push_back({ buffer, stageMask, accessMask, false });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::WriteBuffer(VkBuffer buffer, VkPipelineStageFlags stageMask, VkAccessFlags accessMask)
+	{
+		m_BufferUsages.push_back({ buffer, stageMask, accessMask, true });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::Prepare(PrepareFunction prepare)
+	{
+		m_Prepare = std::move(prepare);
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::SetSideEffect()
+	{
+		m_HasSideEffect = true;
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::SetAsyncCompute()
+	{
+		m_IsAsyncCompute = true;
+		return *this;
+	}
+
+
+	// Methods
+	//--------------------
+	void RenderGraph::Reset()
+	{
+		m_pPasses.clear();
+		m_pOutput = nullptr;
+		m_OutputAccess = PRESENT;
+	}
+
+	void RenderGraph::ClearResourceStates()
+	{
+		m_BufferStates.clear();
+		m_QueueStates.clear();
+	}
+
+	RenderGraph::Pass& RenderGraph::AddPass(const std::string& name, RecordFunction record)
+	{
+		const uint32_t id = m_GetPassId ? m_GetPassId(name) : 0;
+		m_pPasses.emplace_back(std::make_unique<Pass>(name, id, std::move(record)));
+		return *m_pPasses.back();
+	}
+
+	void RenderGraph::SetOutput(Image& image, const ImageAccess& finalAccess)
+	{
+		m_pOutput = &image;
+		m_OutputAccess = finalAccess;
+	}
+
+	const std::vector<RenderGraph::Batch>& RenderGraph::Execute(const BeginBatchFunction& beginBatch, bool useAsyncCompute)
+	{
+		if (!m_pOutput)
+		{
+			throw std::runtime_error("failed to execute render graph, no output set!");
+		}
+
+		m_BarrierBatchCount = 0;
+		m_BarrierCount = 0;
+		m_Batches.clear();
+		m_OpenBatches = { -1, -1 };
+
+		Cull();
+		Schedule(useAsyncCompute);
+
+		// kick off the work of every live pass first, so it overlaps with the recording of the earlier ones
+		for (const auto& pPass : m_pPasses)
+		{
+			if (!pPass->m_IsCulled && pPass->m_Prepare) pPass->m_Prepare();
+		}
+
+		for (const auto& pPass : m_pPasses)
+		{
+			if (pPass->m_IsCulled) continue;
+
+			Batch& batch = SyncQueue(*pPass, beginBatch);
+			UpdateQueueStates(*pPass, batch);
+
+			if (m_OnPassBegin) m_OnPassBegin(pPass->m_Id, batch.commandBuffer);
+
+			RecordBarriers(batch.commandBuffer, pPass->m_ImageUsages, pPass->m_BufferUsages);
+			pPass->m_Record(batch.commandBuffer);
+
+			if (m_OnPassEnd) m_OnPassEnd(pPass->m_Id, batch.commandBuffer);
+
+			if (pPass->m_EndsBatch) m_OpenBatches[static_cast<size_t>(pPass->m_Queue)] = -1;
+		}
+
+		// the frame's fence is signaled by the last graphics batch, it has to wait for the rest of the compute work
+		uint64_t computeValue = 0;
+		for (const Batch& batch : m_Batches)
+		{
+			if (batch.queue == QueueType::Compute) computeValue = batch.signalValue;
+		}
+		WaitFor(QueueType::Graphics, computeValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, beginBatch);
+
+		// final transition of the output, e.g. to present
+		Pass outputPass{ "Output", {} };
+		outputPass.Read(*m_pOutput, m_OutputAccess);
+
+		Batch& batch = SyncQueue(outputPass, beginBatch);
+		UpdateQueueStates(outputPass, batch);
+		RecordBarriers(batch.commandBuffer, outputPass.m_ImageUsages, {});
+
+		return m_Batches;
+	}
+
+	void RenderGraph::ExportDot(const std::string& filename) const
+	{
+		std::ofstream file(filename);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open DOT file: " << filename << std::endl;
+			return;
+		}
+
+		file << "digraph RenderGraph {\n";
+		file << "\trankdir=LR;\n";
+		file << "\tnode [fontname=\"Helvetica\"];\n";
+
+		std::unordered_set<const void*> declaredResources{};
+
+		const auto declareImage = [&](const Image* pImage)
+			{
+				if (!declaredResources.insert(pImage).second) return;
+				const std::string name = pImage->GetName().empty() ? "image" : pImage->GetName();
+				file << "\t\"img_" << pImage << "\" [shape=ellipse, label=\"" << name << "\\n"
+					<< pImage->GetExtent().width << "x" << pImage->GetExtent().height << "\"];\n";
+			};
+		const auto declareBuffer = [&](VkBuffer buffer)
+			{
+				if (!declaredResources.insert(buffer).second) return;
+				file << "\t\"buf_" << buffer << "\" [shape=box, style=rounded, label=\"buffer\"];\n";
+			};
+
+		for (size_t passIndex{ 0 }; passIndex < m_pPasses.size(); ++passIndex)
+		{
+			const Pass& pass = *m_pPasses[passIndex];
+			file << "\t\"pass_" << passIndex << "\" [shape=box, style=\"" << (pass.m_IsCulled ? "dashed" : "filled")
+				<< "\", fillcolor=\"" << (pass.m_Queue == QueueType::Compute ? "#f0c8a0" : "#a0c8f0") << "\", label=\"" << pass.m_Name << "\"];\n";
+
+			for (const auto& usage : pass.m_ImageUsages)
+			{
+				declareImage(usage.pImage);
+				if (usage.isWrite) file << "\t\"pass_" << passIndex << "\" -> \"img_" << usage.pImage << "\"" << (usage.discard ? " [style=bold]" : "") << ";\n";
+				else file << "\t\"img_" << usage.pImage << "\" -> \"pass_" << passIndex << "\";\n";
+			}
+
+			for (const auto& usage : pass.m_BufferUsages)
+			{
+				declareBuffer(usage.buffer);
+				if (usage.isWrite) file << "\t\"pass_" << passIndex << "\" -> \"buf_" << usage.buffer << "\";\n";
+				else file << "\t\"buf_" << usage.buffer << "\" -> \"pass_" << passIndex << "\";\n";
+			}
+		}
+
+		if (m_pOutput)
+		{
+			declareImage(m_pOutput);
+			file << "\toutput [shape=doublecircle, label=\"output\"];\n";
+			file << "\t\"img_" << m_pOutput << "\" -> output;\n";
+		}
+
+		file << "}\n";
+		file.close();
+
+		std::cout << "Render graph written to: " << filename << std::endl;
+	}
+
+
+	// Private Methods
+	//--------------------
+	void RenderGraph::Cull()
+	{
+		// walk back from the output, a pass is live when something downstream needs one of its writes
+		std::unordered_set<const void*> neededResources{ m_pOutput };
+		m_CulledPassCount = 0;
+
+		for (auto it = m_pPasses.rbegin(); it != m_pPasses.rend(); ++it)
+		{
+			Pass& pass = **it;
+
+			bool isLive = pass.m_HasSideEffect;
+			for (const auto& usage : pass.m_ImageUsages)
+				isLive |= usage.isWrite && neededResources.contains(usage.pImage);
+			for (const auto& usage : pass.m_BufferUsages)
+				isLive |= usage.isWrite && neededResources.contains(usage.buffer);
+
+			pass.m_IsCulled = !isLive;
+			if (!isLive)
+			{
+				++m_CulledPassCount;
+				continue;
+			}
+
+			// a discarding write fully produces the image, earlier writers are not needed for it anymore
+			for (const auto& usage : pass.m_ImageUsages)
+				if (usage.isWrite && usage.discard) neededResources.erase(usage.pImage);
+
+			for (const auto& usage : pass.m_ImageUsages)
+				if (!usage.isWrite || !usage.discard) neededResources.insert(usage.pImage);
+			for (const auto& usage : pass.m_BufferUsages)
+				neededResources.insert(usage.buffer);
+		}
+	}
+
+	void RenderGraph::Schedule(bool useAsyncCompute)
+	{
+		for (const auto& pPass : m_pPasses)
+		{
+			pPass->m_Queue = useAsyncCompute && pPass->m_IsAsyncCompute ? QueueType::Compute : QueueType::Graphics;
+			pPass->m_EndsBatch = false;
+		}
+
+		if (!useAsyncCompute) return;
+
+		// the batch of the last writer a pass of the other queue depends on ends right after it, so its signal comes as early as possible
+		std::unordered_map<const void*, Pass*> lastWriters{};
+		for (const auto& pPass : m_pPasses)
+		{
+			if (pPass->m_IsCulled) continue;
+
+			const auto endWriterBatch = [&](const void* pResource)
+				{
+					const auto it = lastWriters.find(pResource);
+					if (it != lastWriters.end() && it->second->m_Queue != pPass->m_Queue) it->second->m_EndsBatch = true;
+				};
+
+			for (const auto& usage : pPass->m_ImageUsages) endWriterBatch(usage.pImage);
+			for (const auto& usage : pPass->m_BufferUsages) endWriterBatch(usage.buffer);
+
+			for (const auto& usage : pPass->m_ImageUsages)
+				if (usage.isWrite) lastWriters[usage.pImage] = pPass.get();
+			for (const auto& usage : pPass->m_BufferUsages)
+				if (usage.isWrite) lastWriters[usage.buffer] = pPass.get();
+		}
+	}
+
+	RenderGraph::Batch& RenderGraph::SyncQueue(const Pass& pass, const BeginBatchFunction& beginBatch)
+	{
+		const QueueType queue = pass.m_Queue;
+		const QueueType other = GetOtherQueue(queue);
+
+		uint64_t waitValue = 0;
+		VkPipelineStageFlags waitStageMask = 0;
+
+		// any access waits for the last write of the other queue, a write or layout transition also for its reads since then
+		const auto addHazard = [&](const void* pResource, bool isWrite, VkPipelineStageFlags stageMask)
+			{
+				const auto it = m_QueueStates.find(pResource);
+				if (it == m_QueueStates.end()) return;
+
+				const QueueState& state = it->second;
+				uint64_t value = state.writeQueue == other ? state.writeValue : 0;
+				if (isWrite) value = std::max(value, state.readValues[static_cast<size_t>(other)]);
+				if (value == 0) return;
+
+				waitValue = std::max(waitValue, value);
+				waitStageMask |= stageMask;
+			};
+
+		for (const auto& usage : pass.m_ImageUsages)
+		{
+			addHazard(usage.pImage, IsQueueWrite(usage), usage.access.stageMask);
+
+			// the memory may still be in use by an alias on the other queue
+			if (usage.discard)
+			{
+				for (const Image* pAlias : usage.pImage->GetAliases())
+					addHazard(pAlias, true, usage.access.stageMask);
+			}
+		}
+		for (const auto& usage : pass.m_BufferUsages)
+			addHazard(usage.buffer, usage.isWrite, usage.stageMask);
+
+		Batch& batch = WaitFor(queue, waitValue, waitStageMask, beginBatch);
+
+		// resources coming from the other queue still carry its stages in their sync state, which the barriers of this queue cannot name
+		for (const auto& usage : pass.m_ImageUsages)
+		{
+			VkPipelineStageFlags stageMask = usage.access.stageMask;
+			VkAccessFlags accessMask = usage.access.accessMask;
+			if (GetCrossQueueScope(usage.pImage, queue, stageMask, accessMask)) usage.pImage->SetSyncState({ stageMask, accessMask });
+
+			if (!usage.discard) continue;
+			for (Image* pAlias : usage.pImage->GetAliases())
+			{
+				stageMask = usage.access.stageMask;
+				accessMask = VK_ACCESS_NONE;
+				if (GetCrossQueueScope(pAlias, queue, stageMask, accessMask)) pAlias->SetSyncState({ stageMask, accessMask });
+			}
+		}
+		for (const auto& usage : pass.m_BufferUsages)
+		{
+			VkPipelineStageFlags stageMask = usage.stageMask;
+			VkAccessFlags accessMask = usage.accessMask;
+			if (GetCrossQueueScope(usage.buffer, queue, stageMask, accessMask)) m_BufferStates[usage.buffer] = { stageMask, accessMask };
+		}
+
+		return batch;
+	}
+
+	RenderGraph::Batch& RenderGraph::WaitFor(QueueType queue, uint64_t value, VkPipelineStageFlags stageMask, const BeginBatchFunction& beginBatch)
+	{
+		const QueueType other = GetOtherQueue(queue);
+		int& openBatch = m_OpenBatches[static_cast<size_t>(queue)];
+		int& otherOpenBatch = m_OpenBatches[static_cast<size_t>(other)];
+
+		if (value != 0)
+		{
+			// the other queue signals at the end of a batch, later work of it goes into the next one
+			if (otherOpenBatch >= 0 && m_Batches[otherOpenBatch].signalValue <= value) otherOpenBatch = -1;
+
+			// a wait covers the whole batch, one that already recorded commands ends unless it waits long enough already
+			if (openBatch >= 0)
+			{
+				auto& waits = m_Batches[openBatch].waits;
+				const auto it = std::find_if(waits.begin(), waits.end(), [other](const Wait& wait) { return wait.queue == other; });
+				if (it != waits.end() && it->value >= value)
+				{
+					it->stageMask |= stageMask;
+					value = 0;
+				}
+				else
+				{
+					openBatch = -1;
+				}
+			}
+		}
+
+		if (openBatch < 0)
+		{
+			std::vector<Wait> waits{};
+			if (value != 0) waits.push_back({ other, value, stageMask });
+
+			m_Batches.push_back(beginBatch(queue, std::move(waits)));
+			openBatch = static_cast<int>(m_Batches.size()) - 1;
+		}
+
+		return m_Batches[openBatch];
+	}
+
+	void RenderGraph::UpdateQueueStates(const Pass& pass, const Batch& batch)
+	{
+		const auto update = [&](const void* pResource, bool isWrite)
+			{
+				QueueState& state = m_QueueStates[pResource];
+				state.lastQueue = batch.queue;
+				if (isWrite) state = { batch.queue, batch.queue, batch.signalValue, {} };
+				else state.readValues[static_cast<size_t>(batch.queue)] = batch.signalValue;
+			};
+
+		for (const auto& usage : pass.m_ImageUsages) update(usage.pImage, IsQueueWrite(usage));
+		for (const auto& usage : pass.m_BufferUsages) update(usage.buffer, usage.isWrite);
+	}
+
+	bool RenderGraph::GetCrossQueueScope(const void* pResource, QueueType queue, VkPipelineStageFlags& stageMask, VkAccessFlags& accessMask) const
+	{
+		const auto it = m_QueueStates.find(pResource);
+		if (it == m_QueueStates.end() || it->second.lastQueue == queue) return false;
+
+		const QueueState& state = it->second;
+		if (state.writeQueue == queue && state.writeValue != 0)
+		{
+			// written by this queue & only read by the other one since, nothing waited on that write in between
+			stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			accessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		}
+		else
+		{
+			// the semaphore wait made the other queue's writes visible to the waiting stages, the barrier chains onto it
+			accessMask &= ~WRITE_ACCESS_MASK;
+		}
+		return true;
+	}
+
+	void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<ImageUsage>& imageUsages, const std::vector<BufferUsage>& bufferUsages)
+	{
+		std::vector<VkImageMemoryBarrier> imageBarriers{};
+		std::vector<VkBufferMemoryBarrier> bufferBarriers{};
+		VkPipelineStageFlags srcStageMask{ 0 };
+		VkPipelineStageFlags dstStageMask{ 0 };
+
+		for (const auto& usage : imageUsages)
+		{
+			Image& image = *usage.pImage;
+			const Image::SyncState& state = image.GetSyncState();
+			const bool wasWritten = IsWriteAccess(state.accessMask);
+
+			// read after read in the same layout, nothing to do when an earlier barrier already made the data visible to this stage.
+			// Otherwise an execution-only barrier chains onto that one, the write was already made available by it
+			const bool isReadAfterRead = !usage.isWrite && !wasWritten && image.GetLayout() == usage.access.layout;
+			if (isReadAfterRead && IsCovered(state.stageMask, state.accessMask, usage.access.stageMask, usage.access.accessMask))
+				continue;
+
+			VkPipelineStageFlags waitStageMask = state.stageMask;
+			VkAccessFlags waitAccessMask = wasWritten ? state.accessMask : VK_ACCESS_NONE; // reads never need to be made available
+
+			// aliasing barrier, the memory may still be in use by the image that held it before
+			if (usage.discard)
+			{
+				for (const Image* pAlias : image.GetAliases())
+				{
+					waitStageMask |= pAlias->GetSyncState().stageMask;
+					if (IsWriteAccess(pAlias->GetSyncState().accessMask)) waitAccessMask |= pAlias->GetSyncState().accessMask;
+				}
+			}
+
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = usage.discard ? VK_IMAGE_LAYOUT_UNDEFINED : image.GetLayout();
+			barrier.newLayout = usage.access.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image.GetImage();
+			barrier.subresourceRange = image.GetSubresourceRange();
+			barrier.srcAccessMask = waitAccessMask;
+			barrier.dstAccessMask = usage.access.accessMask;
+			imageBarriers.push_back(barrier);
+
+			srcStageMask |= waitStageMask;
+			dstStageMask |= usage.access.stageMask;
+
+			image.SetLayout(usage.access.layout);
+			if (isReadAfterRead) image.SetSyncState({ state.stageMask | usage.access.stageMask, state.accessMask | usage.access.accessMask });
+			else image.SetSyncState({ usage.access.stageMask, usage.access.accessMask });
+		}
+
+		for (const auto& usage : bufferUsages)
+		{
+			BufferState& state = m_BufferStates[usage.buffer];
+			const bool wasWritten = IsWriteAccess(state.accessMask);
+
+			const bool isReadAfterRead = !usage.isWrite && !wasWritten;
+			if (isReadAfterRead && IsCovered(state.stageMask, state.accessMask, usage.stageMask, usage.accessMask))
+				continue;
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = wasWritten ? state.accessMask : VK_ACCESS_NONE;
+			barrier.dstAccessMask = usage.accessMask;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = usage.buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(barrier);
+
+			srcStageMask |= state.stageMask;
+			dstStageMask |= usage.stageMask;
+
+			if (isReadAfterRead) state = { state.stageMask | usage.stageMask, state.accessMask | usage.accessMask };
+			else state = { usage.stageMask, usage.accessMask };
+		}
+
+		if (imageBarriers.empty() && bufferBarriers.empty()) return;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			srcStageMask,
+			dstStageMask,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+		);
+
+		++m_BarrierBatchCount;
+		m_BarrierCount += static_cast<uint32_t>(imageBarriers.size() + bufferBarriers.size());
+	}
+
+	bool RenderGraph::IsCovered(VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkPipelineStageFlags usageStageMask, VkAccessFlags usageAccessMask)
+	{
+		return (usageStageMask & ~stageMask) == 0 && (usageAccessMask & ~accessMask) == 0;
+	}
+
+	bool RenderGraph::IsWriteAccess(VkAccessFlags accessMask)
+	{
+		return (accessMask & WRITE_ACCESS_MASK) != 0;
+	}
+
+	bool RenderGraph::IsQueueWrite(const ImageUsage& usage)
+	{
+		return usage.isWrite || usage.discard || usage.pImage->GetLayout() != usage.access.layout;
+	}
+}
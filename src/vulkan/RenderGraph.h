@@ -0,0 +1,276 @@
+#pragma once
+
+#include "scene/Image.h"
+
+// std
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cat
+{
+	// Frame graph of the render passes.
+	// Every pass declares the images (and optionally buffers) it reads and writes, the graph then
+	//	- culls the passes whose results never reach the output,
+	//	- records one batched vkCmdPipelineBarrier in front of every pass that needs synchronization,
+	//	- skips read-after-read barriers when the layout does not change and an earlier barrier already covered the stage.
+	// The graph is rebuilt every frame, the last layout & sync scope of an image live on the image itself
+	// so the dependencies carry over between frames.
+	// Passes marked async compute go to the compute queue when the graph executes with one. The live passes are then split
+	// into batches per queue, every batch signals the next value of its queue's timeline & waits on the values of the other
+	// queue it depends on. A producer's batch ends right after it when a later pass of the other queue needs its results.
+	class RenderGraph final
+	{
+	public:
+		enum class QueueType : uint8_t
+		{
+			Graphics,
+			Compute
+		};
+
+		struct Wait
+		{
+			QueueType queue;
+			uint64_t value;						// timeline value of that queue
+			VkPipelineStageFlags stageMask;		// stages of this batch that wait
+		};
+
+		// commands of one queue between two synchronization points, submitted in the order of the vector
+		struct Batch
+		{
+			QueueType queue;
+			VkCommandBuffer commandBuffer;		// recording, ended by the submitter
+			uint64_t signalValue;				// on the timeline of its queue
+			std::vector<Wait> waits{};			// stage masks may still grow while passes are recorded
+		};
+
+		struct ImageAccess
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags stageMask;
+			VkAccessFlags accessMask;
+		};
+
+		// common accesses
+		static constexpr ImageAccess COLOR_ATTACHMENT_WRITE{
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		};
+		static constexpr ImageAccess DEPTH_ATTACHMENT_WRITE{
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		};
+		static constexpr ImageAccess DEPTH_ATTACHMENT_READ{
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+		};
+		static constexpr ImageAccess FRAGMENT_SAMPLED{
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		};
+		static constexpr ImageAccess COMPUTE_SAMPLED{
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		};
+		static constexpr ImageAccess COMPUTE_STORAGE_READ{
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		};
+		static constexpr ImageAccess COMPUTE_STORAGE_WRITE{
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+		};
+		static constexpr ImageAccess PRESENT{
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			VK_ACCESS_NONE
+		};
+
+		struct ImageUsage
+		{
+			Image* pImage;
+			ImageAccess access;
+			bool isWrite;
+			bool discard;	// previous contents are not needed, transitions from UNDEFINED
+		};
+
+		struct BufferUsage
+		{
+			VkBuffer buffer;
+			VkPipelineStageFlags stageMask;
+			VkAccessFlags accessMask;
+			bool isWrite;
+		};
+
+		using RecordFunction = std::function<void(VkCommandBuffer)>;
+		using PrepareFunction = std::function<void()>;
+		// the id of a pass the callbacks get, resolved from its name once when the pass is added
+		using PassIdFunction = std::function<uint32_t(const std::string&)>;
+		// called around every recorded pass with its id & the command buffer it goes to
+		using PassCallback = std::function<void(uint32_t, VkCommandBuffer)>;
+		// begins the command buffer of a new batch that starts with these waits & assigns the timeline value it signals
+		using BeginBatchFunction = std::function<Batch(QueueType, std::vector<Wait>)>;
+
+		class Pass final
+		{
+		public:
+			Pass(std::string name, uint32_t id, RecordFunction record);
+
+			Pass& Read(Image& image, const ImageAccess& access);
+			Pass& Write(Image& image, const ImageAccess& access, bool discard = false);
+			Pass& ReadBuffer(VkBuffer buffer, VkPipelineStageFlags stageMask, VkAccessFlags accessMask);
+			Pass& WriteBuffer(VkBuffer buffer, VkPipelineStageFlags stageMask, VkAccessFlags accessMask);
+
+			// called for every live pass before the first one records, e.g. to kick off the parallel draw recording
+			Pass& Prepare(PrepareFunction prepare);
+			// never culled, even if nothing reads its results
+			Pass& SetSideEffect();
+			// compute only work that may run on the async compute queue, it stays in order on the graphics queue otherwise
+			Pass& SetAsyncCompute();
+
+			// Getters & Setters
+			const std::string& GetName() const { return m_Name; }
+			uint32_t GetId() const { return m_Id; }
+			bool IsCulled() const { return m_IsCulled; }
+
+		private:
+			friend class RenderGraph;
+
+			std::string m_Name;
+			uint32_t m_Id;
+			RecordFunction m_Record;
+			PrepareFunction m_Prepare;
+
+			std::vector<ImageUsage> m_ImageUsages{};
+			std::vector<BufferUsage> m_BufferUsages{};
+
+			bool m_HasSideEffect = false;
+			bool m_IsAsyncCompute = false;
+			bool m_IsCulled = false;
+
+			// set by the scheduling of the last Execute
+			QueueType m_Queue = QueueType::Graphics;
+			bool m_EndsBatch = false;		// a later pass of the other queue needs its results
+		};
+
+		// CTOR & DTOR
+		//--------------------
+		RenderGraph() = default;
+		~RenderGraph() = default;
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+		RenderGraph(RenderGraph&&) = delete;
+		RenderGraph& operator=(RenderGraph&&) = delete;
+
+		// Methods
+		//--------------------
+		// drops the passes of the previous frame, the per image state is kept
+		void Reset();
+		// forgets the queue & sync states kept by image address & buffer handle. Call with the device idle whenever
+		// images or buffers the graph used were destroyed, a new one at the same address must not inherit their waits
+		void ClearResourceStates();
+
+		// passes execute in the order they are added
+		Pass& AddPass(const std::string& name, RecordFunction record);
+
+		// the image the frame is built for, it is transitioned to finalAccess after the last pass
+		void SetOutput(Image& image, const ImageAccess& finalAccess);
+
+		// culls, prepares the live passes and records them with their barriers into the batches of the queues.
+		// Without async compute every pass goes to the graphics queue, the batches only wait on compute work of earlier frames
+		const std::vector<Batch>& Execute(const BeginBatchFunction& beginBatch, bool useAsyncCompute);
+
+		// writes the graph of the last Execute in graphviz format, culled passes are drawn dashed
+		void ExportDot(const std::string& filename) const;
+
+		// Getters & Setters
+		// passes added before getPassId was set get id 0
+		void SetPassCallbacks(PassIdFunction getPassId, PassCallback onBegin, PassCallback onEnd)
+		{
+			m_GetPassId = std::move(getPassId);
+			m_OnPassBegin = std::move(onBegin);
+			m_OnPassEnd = std::move(onEnd);
+		}
+
+		// statistics of the last Execute
+		uint32_t GetBarrierBatchCount() const { return m_BarrierBatchCount; }	// vkCmdPipelineBarrier calls
+		uint32_t GetBarrierCount() const { return m_BarrierCount; }				// image & buffer barriers in those calls
+		uint32_t GetCulledPassCount() const { return m_CulledPassCount; }
+		const std::vector<Batch>& GetBatches() const { return m_Batches; }
+
+	private:
+		// Private Methods
+		//--------------------
+		void Cull();
+		void Schedule(bool useAsyncCompute);
+		// waits of the pass on the other queue, returns the batch it records into
+		Batch& SyncQueue(const Pass& pass, const BeginBatchFunction& beginBatch);
+		// the open batch of the queue, a new one when it has to wait for a later value of the other queue. value 0 = no wait
+		Batch& WaitFor(QueueType queue, uint64_t value, VkPipelineStageFlags stageMask, const BeginBatchFunction& beginBatch);
+		void UpdateQueueStates(const Pass& pass, const Batch& batch);
+		// the sync scope a resource last used by the other queue starts with on this one, false when it did not change queues
+		bool GetCrossQueueScope(const void* pResource, QueueType queue, VkPipelineStageFlags& stageMask, VkAccessFlags& accessMask) const;
+		void RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<ImageUsage>& imageUsages, const std::vector<BufferUsage>& bufferUsages);
+
+		static bool IsWriteAccess(VkAccessFlags accessMask);
+		// writes & layout transitions, the other queue has to be done with the image before either
+		static bool IsQueueWrite(const ImageUsage& usage);
+		static QueueType GetOtherQueue(QueueType queue) { return queue == QueueType::Graphics ? QueueType::Compute : QueueType::Graphics; }
+		// true when an earlier barrier already synchronized the stages & accesses of a new read
+		static bool IsCovered(VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkPipelineStageFlags usageStageMask, VkAccessFlags usageAccessMask);
+
+		// Private Members
+		//--------------------
+		static constexpr VkAccessFlags WRITE_ACCESS_MASK =
+			VK_ACCESS_SHADER_WRITE_BIT |
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_TRANSFER_WRITE_BIT |
+			VK_ACCESS_HOST_WRITE_BIT |
+			VK_ACCESS_MEMORY_WRITE_BIT;
+
+		struct BufferState
+		{
+			VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags accessMask = VK_ACCESS_NONE;
+		};
+
+		// batches that last touched an image or buffer, kept across frames like the sync states. Layout transitions count as writes
+		struct QueueState
+		{
+			QueueType lastQueue = QueueType::Graphics;
+			QueueType writeQueue = QueueType::Graphics;
+			uint64_t writeValue = 0;					// 0 = never written by the graph
+			std::array<uint64_t, 2> readValues{};		// last read per queue since that write
+		};
+
+		std::vector<std::unique_ptr<Pass>> m_pPasses{};
+		std::unordered_map<VkBuffer, BufferState> m_BufferStates{};
+		std::unordered_map<const void*, QueueState> m_QueueStates{};
+
+		std::vector<Batch> m_Batches{};
+		std::array<int, 2> m_OpenBatches{ -1, -1 };	// per queue, index into m_Batches
+
+		Image* m_pOutput = nullptr;
+		ImageAccess m_OutputAccess = PRESENT;
+
+		PassIdFunction m_GetPassId;
+		PassCallback m_OnPassBegin;
+		PassCallback m_OnPassEnd;
+
+		uint32_t m_BarrierBatchCount = 0;
+		uint32_t m_BarrierCount = 0;
+		uint32_t m_CulledPassCount = 0;
+	};
+}
@@ -7,8 +7,8 @@ namespace cat
 {
 	// CTOR & DTOR
 	//--------------------
-	SwapChain::SwapChain(Device& device, GLFWwindow* window)
-		: m_Device{ device }, m_Window{ window }
+	SwapChain::SwapChain(Device& device, GLFWwindow* window, VkPresentModeKHR presentMode)
+		: m_PreferredPresentMode{ presentMode }, m_Device{ device }, m_Window{ window }
 	{
 		CreateSwapChain();
 		//CreateRenderPass();
@@ -17,6 +17,14 @@ namespace cat
         CreateSyncObjects();
 	}
 
+	SwapChain::SwapChain(Device& device, VkExtent2D extent)
+		: m_PreferredPresentMode{ VK_PRESENT_MODE_FIFO_KHR }, m_SwapChainExtent{ extent }, m_Device{ device }, m_Window{ nullptr }
+	{
+		CreateOffscreenImages();
+		CreateDepthResources();
+		CreateSyncObjects();
+	}
+
 	SwapChain::~SwapChain()
 	{
         CleanupSwapChain();
@@ -34,6 +42,10 @@ namespace cat
 
     void SwapChain::RecreateSwapChain()
     {
+        // offscreen images never go out of date
+        if (IsHeadless())
+            return;
+
         // HANDLE MINIMIZATION
         int width = 0, height = 0;
         while (width == 0 || height == 0)
@@ -100,6 +112,7 @@ namespace cat
         vkGetSwapchainImagesKHR(m_Device.GetDevice(), m_SwapChain, &imageCount, swapChainImages.data());
 
         m_ImageCount = imageCount;
+        m_PresentMode = presentMode;
         m_SwapChainExtent = extent;
         m_pSwapChainImages.clear();
         m_pSwapChainImages.resize(m_ImageCount);
@@ -114,6 +127,7 @@ namespace cat
                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                 VMA_MEMORY_USAGE_GPU_ONLY,
                 swapChainImages[i]);
+            myImg->SetName("Swapchain image <" + std::to_string(i));
             m_pSwapChainImages[i] = std::move(myImg);
         }
 
@@ -121,6 +135,27 @@ namespace cat
     }
 
 
+    void SwapChain::CreateOffscreenImages()
+    {
+        m_ImageCount = MAX_FRAMES_IN_FLIGHT;
+        m_SwapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        m_pSwapChainImages.clear();
+        m_pSwapChainImages.resize(m_ImageCount);
+
+        for (uint32_t i = 0; i < m_ImageCount; i++)
+        {
+            auto myImg = std::make_unique<Image>(
+                m_Device,
+                m_SwapChainExtent.width,
+                m_SwapChainExtent.height,
+                m_SwapChainImageFormat,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VMA_MEMORY_USAGE_GPU_ONLY);
+            myImg->SetName("Offscreen image <" + std::to_string(i));
+            m_pSwapChainImages[i] = std::move(myImg);
+        }
+    }
+
     void SwapChain::CleanupSwapChain()
     {
 		m_pSwapChainImages.clear();
@@ -132,7 +167,8 @@ namespace cat
 		}
         m_pDepthImages.clear();
 
-        vkDestroySwapchainKHR(m_Device.GetDevice(), m_SwapChain, nullptr);
+        if (m_SwapChain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(m_Device.GetDevice(), m_SwapChain, nullptr);
     }
 
     VkImageView SwapChain::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) const
@@ -162,7 +198,9 @@ namespace cat
         m_pDepthImages.clear();
         m_swapChainDepthFormat = FindDepthFormat();
 
-        for (size_t i = 0; i < m_ImageCount; i++) 
+        // indexed by the frame in flight
+        const size_t depthImageCount = std::max<size_t>(m_ImageCount, MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < depthImageCount; i++) 
         {
             auto depthImage = new Image(
                 m_Device,
@@ -171,6 +209,7 @@ namespace cat
                 m_swapChainDepthFormat,
                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VMA_MEMORY_USAGE_GPU_ONLY);
+            depthImage->SetName("Depth image <" + std::to_string(i));
             m_pDepthImages.push_back(std::move(depthImage));
         }
         
@@ -216,12 +255,12 @@ namespace cat
         return availableFormats[0];
     }
 
-    VkPresentModeKHR SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+    VkPresentModeKHR SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const
     {
-        //Now, let's look through the list to see if VK_PRESENT_MODE_MAILBOX_KHR is available:
+        //Now, let's look through the list to see if the preferred mode is available, FIFO always is:
         for (const auto& availablePresentMode : availablePresentModes)
         {
-            if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+            if (availablePresentMode == m_PreferredPresentMode)
             {
                 return availablePresentMode;
             }
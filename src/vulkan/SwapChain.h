@@ -1,11 +1,15 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
-#include <memory>
 #include <GLFW/glfw3native.h>
+#endif
+#include <memory>
 
 #include "Device.h"
 #include "../core/Window.h"
@@ -16,14 +20,18 @@
 
 namespace cat
 {
-	static const int MAX_FRAMES_IN_FLIGHT = 2;
+	// upper bound of the frames in flight, per frame resources exist for all of them & the renderer picks how many it cycles through
+	static const int MAX_FRAMES_IN_FLIGHT = 3;
 
 	class SwapChain
 	{
 	public:
 		// CTOR & DTOR
 		//--------------------
-		SwapChain(Device& device, GLFWwindow* window);
+		// presentMode is the preferred one, FIFO is used when the surface does not support it
+		SwapChain(Device& device, GLFWwindow* window, VkPresentModeKHR presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR);
+		// headless, a ring of MAX_FRAMES_IN_FLIGHT offscreen images stands in for the swapchain & nothing is presented
+		SwapChain(Device& device, VkExtent2D extent);
 		~SwapChain();
 
 		SwapChain(const SwapChain&) = delete;
@@ -44,6 +52,7 @@ namespace cat
 
 		// Getters & Setters
 		VkSwapchainKHR GetSwapChain() const { return m_SwapChain; }
+		bool IsHeadless() const { return m_Window == nullptr; }
 
 		uint32_t GetImageCount()const { return m_ImageCount; }
 		uint32_t& GetImageIndex() { return m_ImageIndex; }
@@ -69,12 +78,17 @@ namespace cat
 		VkSemaphore GetRenderFinishedSemaphores(uint16_t idx) const { return m_RenderFinishedSemaphores[idx]; }
 		VkFormat FindDepthFormat() const;
 
+		// takes effect with the next RecreateSwapChain
+		void SetPresentMode(VkPresentModeKHR presentMode) { m_PreferredPresentMode = presentMode; }
+		VkPresentModeKHR GetPresentMode() const { return m_PresentMode; }
+
 	private:
 		// Private Methods
 		//--------------------
 
 		// Creators
 		void CreateSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+		void CreateOffscreenImages();
 		void CleanupSwapChain();
 		void CreateDepthResources();
 		void CreateSyncObjects();
@@ -82,7 +96,7 @@ namespace cat
 		// Helpers
 		static VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 		VkSurfaceFormatKHR GetSwapSurfaceFormat() const { return { m_SwapChainImageFormat, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR }; }
-		static VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
 		VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
 		VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling,
 		                             VkFormatFeatureFlags features) const;
@@ -90,13 +104,15 @@ namespace cat
 
 		// Private Members
 		//--------------------
-		bool m_FramebufferResized;
-		VkSwapchainKHR m_SwapChain;
+		bool m_FramebufferResized{};
+		VkSwapchainKHR m_SwapChain{ VK_NULL_HANDLE };
 		uint32_t m_ImageCount ;
 		uint32_t m_ImageIndex{};
 
 		std::vector<std::unique_ptr<Image>> m_pSwapChainImages;
 		VkFormat m_SwapChainImageFormat;
+		VkPresentModeKHR m_PreferredPresentMode;
+		VkPresentModeKHR m_PresentMode{ VK_PRESENT_MODE_FIFO_KHR };
 		VkExtent2D m_SwapChainExtent;
 		std::vector < VkSemaphore> m_ImageAvailableSemaphores;
 		std::vector < VkSemaphore> m_RenderFinishedSemaphores;
@@ -107,6 +123,6 @@ namespace cat
 
 
 		Device& m_Device;
-		GLFWwindow* m_Window;
+		GLFWwindow* m_Window;	// nullptr when headless
 	};
 }
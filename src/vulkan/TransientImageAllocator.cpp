@@ -0,0 +1,259 @@
+#include "TransientImageAllocator.h"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	TransientImageAllocator::TransientImageAllocator(Device& device)
+		: m_Device(device)
+	{
+	}
+
+	TransientImageAllocator::~TransientImageAllocator()
+	{
+		Clear();
+	}
+
+
+	// Methods
+	//--------------------
+	TransientImageAllocator::ImageHandle TransientImageAllocator::Request(const ImageDesc& desc)
+	{
+		if (m_IsAllocated)
+		{
+			throw std::runtime_error("failed to request transient image, the allocator has to be cleared first!");
+		}
+
+		m_Tenants.push_back(Tenant{ .desc = desc });
+		return static_cast<ImageHandle>(m_Tenants.size() - 1);
+	}
+
+	void TransientImageAllocator::Allocate()
+	{
+		if (m_IsAllocated)
+		{
+			throw std::runtime_error("failed to allocate transient images, they are already allocated!");
+		}
+
+		// IMAGES
+		for (auto& tenant : m_Tenants)
+		{
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = { tenant.desc.extent.width, tenant.desc.extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = tenant.desc.format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = tenant.desc.usage;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			m_Device.SetSharingMode(imageInfo);
+
+			if (vkCreateImage(m_Device.GetDevice(), &imageInfo, nullptr, &tenant.image) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create transient image!");
+			}
+			vkGetImageMemoryRequirements(m_Device.GetDevice(), tenant.image, &tenant.requirements);
+		}
+
+		// PLACEMENT, largest first so the small targets fill the gaps
+		std::vector<uint32_t> order(m_Tenants.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+			{
+				return m_Tenants[a].requirements.size > m_Tenants[b].requirements.size;
+			});
+
+		for (const uint32_t tenantIndex : order)
+			PlaceTenant(tenantIndex);
+
+		// MEMORY
+		for (auto& block : m_Blocks)
+		{
+			VkMemoryRequirements requirements{};
+			requirements.size = block.size;
+			requirements.alignment = block.alignment;
+			requirements.memoryTypeBits = block.memoryTypeBits;
+
+			VmaAllocationCreateInfo allocInfo{};
+			allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+			if (vmaAllocateMemory(m_Device.GetAllocator(), &requirements, &allocInfo, &block.allocation, nullptr) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate transient image memory!");
+			}
+		}
+
+		// BINDING
+		for (auto& tenant : m_Tenants)
+		{
+			if (vmaBindImageMemory2(m_Device.GetAllocator(), m_Blocks[tenant.blockIndex].allocation, tenant.offset, tenant.image, nullptr) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to bind transient image memory!");
+			}
+
+			tenant.pImage = std::make_unique<Image>(m_Device, tenant.image, tenant.desc.extent.width, tenant.desc.extent.height, tenant.desc.format);
+			tenant.pImage->SetName(tenant.desc.name);
+		}
+
+		// ALIASES, tenants of a block whose memory ranges intersect
+		for (const auto& block : m_Blocks)
+		{
+			for (size_t i{ 0 }; i < block.tenants.size(); ++i)
+			{
+				for (size_t j{ i + 1 }; j < block.tenants.size(); ++j)
+				{
+					Tenant& a = m_Tenants[block.tenants[i]];
+					Tenant& b = m_Tenants[block.tenants[j]];
+					if (a.offset < b.offset + b.requirements.size && b.offset < a.offset + a.requirements.size)
+					{
+						a.pImage->AddAlias(b.pImage.get());
+						b.pImage->AddAlias(a.pImage.get());
+					}
+				}
+			}
+		}
+
+		m_IsAllocated = true;
+		PrintMemoryReport();
+	}
+
+	void TransientImageAllocator::Clear()
+	{
+		for (auto& tenant : m_Tenants)
+		{
+			// the wrapper owns the handle once it exists
+			if (tenant.pImage) tenant.pImage.reset();
+			else if (tenant.image != VK_NULL_HANDLE) vkDestroyImage(m_Device.GetDevice(), tenant.image, nullptr);
+		}
+
+		for (const auto& block : m_Blocks)
+		{
+			if (block.allocation != VK_NULL_HANDLE) vmaFreeMemory(m_Device.GetAllocator(), block.allocation);
+		}
+
+		m_Tenants.clear();
+		m_Blocks.clear();
+		m_IsAllocated = false;
+	}
+
+	void TransientImageAllocator::PrintMemoryReport() const
+	{
+		constexpr double toMB = 1.0 / (1024.0 * 1024.0);
+		const VkExtent2D extent = m_Tenants.empty() ? VkExtent2D{ 0, 0 } : m_Tenants.front().desc.extent;
+
+		std::cout << "Transient render targets at " << extent.width << "x" << extent.height << ": "
+			<< m_Tenants.size() << " images in " << m_Blocks.size() << " blocks, "
+			<< std::fixed << std::setprecision(1)
+			<< GetRequestedSize() * toMB << " MB requested, "
+			<< GetAllocatedSize() * toMB << " MB allocated" << std::endl;
+	}
+
+	VkDeviceSize TransientImageAllocator::GetRequestedSize() const
+	{
+		VkDeviceSize size{ 0 };
+		for (const auto& tenant : m_Tenants)
+			size += tenant.requirements.size;
+		return size;
+	}
+
+	VkDeviceSize TransientImageAllocator::GetAllocatedSize() const
+	{
+		VkDeviceSize size{ 0 };
+		for (const auto& block : m_Blocks)
+			size += block.size;
+		return size;
+	}
+
+
+	// Private Methods
+	//--------------------
+	void TransientImageAllocator::PlaceTenant(uint32_t tenantIndex)
+	{
+		Tenant& tenant = m_Tenants[tenantIndex];
+		const VkDeviceSize alignment = tenant.requirements.alignment;
+		const auto alignUp = [alignment](VkDeviceSize value) { return (value + alignment - 1) / alignment * alignment; };
+
+		uint32_t bestBlock = UINT32_MAX;
+		VkDeviceSize bestOffset = 0;
+		VkDeviceSize bestGrowth = tenant.requirements.size; // sharing has to beat a block of its own
+
+		for (uint32_t blockIndex{ 0 }; blockIndex < m_Blocks.size(); ++blockIndex)
+		{
+			const Block& block = m_Blocks[blockIndex];
+			if (block.frameIndex != tenant.desc.frameIndex) continue;
+			if ((block.memoryTypeBits & tenant.requirements.memoryTypeBits) == 0) continue;
+
+			// the tenant either starts at the front or right behind someone it can not share memory with
+			std::vector<VkDeviceSize> candidates{ 0 };
+			for (const uint32_t otherIndex : block.tenants)
+			{
+				const Tenant& other = m_Tenants[otherIndex];
+				if (LifetimesOverlap(tenant.desc, other.desc))
+					candidates.push_back(alignUp(other.offset + other.requirements.size));
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			for (const VkDeviceSize offset : candidates)
+			{
+				if (!IsRangeFree(blockIndex, tenantIndex, offset)) continue;
+
+				const VkDeviceSize end = offset + tenant.requirements.size;
+				const VkDeviceSize growth = end > block.size ? end - block.size : 0;
+				if (growth < bestGrowth)
+				{
+					bestBlock = blockIndex;
+					bestOffset = offset;
+					bestGrowth = growth;
+				}
+				break;
+			}
+		}
+
+		if (bestBlock == UINT32_MAX)
+		{
+			m_Blocks.push_back(Block{ .frameIndex = tenant.desc.frameIndex });
+			bestBlock = static_cast<uint32_t>(m_Blocks.size() - 1);
+			bestOffset = 0;
+		}
+
+		Block& block = m_Blocks[bestBlock];
+		block.tenants.push_back(tenantIndex);
+		block.size = std::max(block.size, bestOffset + tenant.requirements.size);
+		block.alignment = std::max(block.alignment, alignment);
+		block.memoryTypeBits &= tenant.requirements.memoryTypeBits;
+
+		tenant.blockIndex = bestBlock;
+		tenant.offset = bestOffset;
+	}
+
+	bool TransientImageAllocator::IsRangeFree(uint32_t blockIndex, uint32_t tenantIndex, VkDeviceSize offset) const
+	{
+		const Tenant& tenant = m_Tenants[tenantIndex];
+		const VkDeviceSize end = offset + tenant.requirements.size;
+
+		for (const uint32_t otherIndex : m_Blocks[blockIndex].tenants)
+		{
+			const Tenant& other = m_Tenants[otherIndex];
+			const bool memoryOverlaps = offset < other.offset + other.requirements.size && other.offset < end;
+			if (memoryOverlaps && LifetimesOverlap(tenant.desc, other.desc)) return false;
+		}
+		return true;
+	}
+
+	bool TransientImageAllocator::LifetimesOverlap(const ImageDesc& a, const ImageDesc& b)
+	{
+		// frames in flight can run at the same time, so only images of the same frame ever share memory
+		if (a.frameIndex != b.frameIndex) return true;
+		return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+	}
+}
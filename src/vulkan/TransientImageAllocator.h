@@ -0,0 +1,115 @@
+#pragma once
+
+#include "scene/Image.h"
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cat
+{
+	// position of every pass in the frame, the order Renderer::RecordPasses adds them to the render graph
+	enum class PassOrder : uint32_t
+	{
+		DepthPrepass,
+		ShadowPass,
+		GeometryPass,
+		LightingPass,
+		VolumetricPass,
+		BlitPass
+	};
+
+	// Places render targets that are only alive for part of a frame in shared VMA memory.
+	// Images of the same frame in flight whose pass lifetimes do not overlap may share (parts of) a block,
+	// they are registered as aliases of each other so the render graph can emit the aliasing barrier
+	// on the first, discarding write of the new tenant.
+	//
+	// Requests are collected first, Allocate then places all of them at once. Nothing is usable before that.
+	class TransientImageAllocator final
+	{
+	public:
+		using ImageHandle = uint32_t;
+
+		struct ImageDesc
+		{
+			std::string name;
+			VkExtent2D extent;
+			VkFormat format;
+			VkImageUsageFlags usage;
+			uint32_t frameIndex;
+
+			// first & last pass that touch the image, inclusive
+			PassOrder firstPass;
+			PassOrder lastPass;
+		};
+
+		// CTOR & DTOR
+		//--------------------
+		explicit TransientImageAllocator(Device& device);
+		~TransientImageAllocator();
+
+		TransientImageAllocator(const TransientImageAllocator&) = delete;
+		TransientImageAllocator& operator=(const TransientImageAllocator&) = delete;
+		TransientImageAllocator(TransientImageAllocator&&) = delete;
+		TransientImageAllocator& operator=(TransientImageAllocator&&) = delete;
+
+		// Methods
+		//--------------------
+		ImageHandle Request(const ImageDesc& desc);
+
+		// creates every requested image, places it in a block & binds it
+		void Allocate();
+
+		// destroys all images & blocks, the handles become invalid. The GPU must be done with them
+		void Clear();
+
+		void PrintMemoryReport() const;
+
+		// Getters & Setters
+		Image& GetImage(ImageHandle handle) const { return *m_Tenants[handle].pImage; }
+
+		// sum of the sizes as if every image had its own memory
+		VkDeviceSize GetRequestedSize() const;
+		VkDeviceSize GetAllocatedSize() const;
+
+	private:
+		// Private Methods
+		//--------------------
+		void PlaceTenant(uint32_t tenantIndex);
+		bool IsRangeFree(uint32_t blockIndex, uint32_t tenantIndex, VkDeviceSize offset) const;
+
+		static bool LifetimesOverlap(const ImageDesc& a, const ImageDesc& b);
+
+		// Private Members
+		//--------------------
+		struct Tenant
+		{
+			ImageDesc desc;
+			VkImage image = VK_NULL_HANDLE;
+			VkMemoryRequirements requirements{};
+
+			uint32_t blockIndex = 0;
+			VkDeviceSize offset = 0;
+
+			std::unique_ptr<Image> pImage{};
+		};
+
+		struct Block
+		{
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memoryTypeBits = ~0u;
+			uint32_t frameIndex = 0;
+
+			std::vector<uint32_t> tenants{};
+		};
+
+		Device& m_Device;
+
+		std::vector<Tenant> m_Tenants{};
+		std::vector<Block> m_Blocks{};
+		bool m_IsAllocated = false;
+	};
+}
@@ -0,0 +1,71 @@
+#include "FrameConstants.h"
+
+#include <cmath>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	FrameConstants::FrameConstants(Device& device, RingBuffer& ringBuffer, uint32_t framesInFlight)
+		: m_Device(device), m_RingBuffer(ringBuffer), m_FramesInFlight(framesInFlight)
+	{
+		m_pDescriptorPool = std::make_unique<DescriptorPool>(m_Device);
+		m_pDescriptorPool
+			->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_FramesInFlight)
+			->Create(m_FramesInFlight);
+
+		m_pDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+		m_pDescriptorSetLayout
+			->AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL)
+			->Create();
+
+		m_pDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
+		m_pDescriptorSet
+			->AddBufferWrite(0, m_RingBuffer.GetDescriptorBufferInfos(sizeof(FrameConstantsUbo), m_FramesInFlight))
+			->UpdateAll();
+	}
+
+
+	// Methods
+	//--------------------
+	void FrameConstants::Update(uint32_t frameIndex, Camera& camera, const Scene& scene, VkExtent2D extent)
+	{
+		const Scene::DirectionalLight& light = scene.GetDirectionalLight();
+
+		m_Data.view = camera.GetView();
+		m_Data.proj = camera.GetProjection();
+		m_Data.invView = glm::inverse(m_Data.view);
+		m_Data.invProj = glm::inverse(m_Data.proj);
+		m_Data.prevViewProj = m_HasHistory ? m_Data.viewProj : m_Data.proj * m_Data.view;
+		m_HasHistory = true;
+		m_Data.viewProj = m_Data.proj * m_Data.view;
+		m_Data.invViewProj = glm::inverse(m_Data.viewProj);
+		m_Data.cascadeViewProj = light.cascadeViewProj;
+		m_Data.cascadeSplits = glm::vec4(light.cascadeSplits[0], light.cascadeSplits[1], light.cascadeSplits[2], light.cascadeSplits[3]);
+
+		m_Data.cameraPosition = glm::vec4(camera.GetOrigin(), 1.f);
+
+		const float width = static_cast<float>(extent.width);
+		const float height = static_cast<float>(extent.height);
+		m_Data.viewport = { width, height, 1.f / width, 1.f / height };
+
+		m_Data.lightDirection = light.direction;
+		m_Data.lightIntensity = light.intensity;
+		m_Data.lightColor = light.color;
+
+		// EV100 = log2(N^2 / t * 100 / S), exposure normalizes the max luminance the sensor can take
+		const float aperture = camera.GetAperture();
+		const float ev100 = std::log2((aperture * aperture) / (camera.GetShutterSpeed() * (camera.GetIso() / 100.f)));
+		m_Data.exposure = 1.f / std::max(1.2f * std::exp2(ev100), 0.00001f);
+
+		m_Data.pointLightCount = static_cast<uint32_t>(scene.GetPointLights().size());
+
+		m_FrameIndex = frameIndex;
+		m_Offset = m_RingBuffer.Push(m_Data);
+	}
+
+	void FrameConstants::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkPipelineBindPoint bindPoint) const
+	{
+		m_pDescriptorSet->Bind(commandBuffer, pipelineLayout, m_FrameIndex, SET_INDEX, { m_Offset }, bindPoint);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "RingBuffer.h"
+#include "../Descriptors.h"
+#include "../scene/Camera.h"
+#include "../scene/Scene.h"
+
+namespace cat
+{
+	// Camera, light and viewport data that every pass needs, uploaded once per frame.
+	// Every pipeline layout starts with GetDescriptorSetLayout() so the block is always bound at set 0,
+	// see shaders/frame_constants.glsl for the shader side.
+	class FrameConstants final
+	{
+	public:
+		static constexpr uint32_t SET_INDEX = 0;
+
+		struct alignas(16) FrameConstantsUbo
+		{
+			glm::mat4 view;
+			glm::mat4 proj;
+			glm::mat4 invView;
+			glm::mat4 invProj;
+			glm::mat4 viewProj;
+			glm::mat4 invViewProj;
+			glm::mat4 prevViewProj;		// of the previous Update, for reprojection
+			std::array<glm::mat4, Scene::DirectionalLight::CASCADE_COUNT> cascadeViewProj;
+			glm::vec4 cascadeSplits;	// view space far distance of every cascade
+
+			glm::vec4 cameraPosition;
+			glm::vec4 viewport;			// width, height, 1 / width, 1 / height
+
+			glm::vec3 lightDirection;
+			float lightIntensity;
+			glm::vec3 lightColor;
+			float exposure;				// from the physical camera settings
+
+			uint32_t pointLightCount;
+			float padding[3]{};
+		};
+
+		// CTOR & DTOR
+		//--------------------
+		FrameConstants(Device& device, RingBuffer& ringBuffer, uint32_t framesInFlight = cat::MAX_FRAMES_IN_FLIGHT);
+		~FrameConstants() = default;
+
+		FrameConstants(const FrameConstants&) = delete;
+		FrameConstants& operator=(const FrameConstants&) = delete;
+		FrameConstants(FrameConstants&&) = delete;
+		FrameConstants& operator=(FrameConstants&&) = delete;
+
+		// Methods
+		//--------------------
+		// writes this frame's block, call after the ring buffer has begun the frame and before any pass records
+		void Update(uint32_t frameIndex, Camera& camera, const Scene& scene, VkExtent2D extent);
+		void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+		// Getters & Setters
+		VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_pDescriptorSetLayout->GetDescriptorSetLayout(); }
+		const FrameConstantsUbo& GetData() const { return m_Data; }
+
+	private:
+		// Private Members
+		//--------------------
+		Device& m_Device;
+		RingBuffer& m_RingBuffer;
+		uint32_t m_FramesInFlight;
+
+		std::unique_ptr<DescriptorPool> m_pDescriptorPool;
+		std::unique_ptr<DescriptorSetLayout> m_pDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pDescriptorSet;
+
+		FrameConstantsUbo m_Data{};
+		bool m_HasHistory = false;
+		uint32_t m_FrameIndex = 0;
+		uint32_t m_Offset = 0;
+	};
+}
@@ -0,0 +1,182 @@
+#include "ParallelRecorder.h"
+
+#include <stdexcept>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	ParallelRecorder::ParallelRecorder(Device& device, ThreadPool& threadPool, uint32_t framesInFlight)
+		: m_Device(device), m_ThreadPool(threadPool), m_FramesInFlight(framesInFlight)
+	{
+		CreateCommandPools();
+	}
+
+	ParallelRecorder::~ParallelRecorder()
+	{
+		for (auto& threadPools : m_FramePools)
+		{
+			for (auto& framePool : threadPools)
+			{
+				// freeing the pool frees all of its buffers as well
+				vkDestroyCommandPool(m_Device.GetDevice(), framePool.commandPool, nullptr);
+			}
+		}
+	}
+
+
+	// Methods
+	//--------------------
+	void ParallelRecorder::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+
+		for (auto& threadPools : m_FramePools)
+		{
+			FramePool& framePool = threadPools[frameIndex];
+			vkResetCommandPool(m_Device.GetDevice(), framePool.commandPool, 0);
+			framePool.usedCount = 0;
+		}
+	}
+
+	ParallelRecorder::Batch ParallelRecorder::Record(const RenderingFormats& formats, std::vector<RecordFunction> chunks)
+	{
+		// shared between the chunks so the format array stays alive until the last one has begun
+		auto pFormats = std::make_shared<const RenderingFormats>(formats);
+		const uint32_t frameIndex = m_FrameIndex;
+
+		Batch batch;
+		batch.reserve(chunks.size());
+
+		for (auto& chunk : chunks)
+		{
+			batch.emplace_back(m_ThreadPool.Submit([this, pFormats, frameIndex, chunk = std::move(chunk)]
+				{
+					VkCommandBuffer commandBuffer = AcquireCommandBuffer(m_ThreadPool.GetWorkerIndex(), frameIndex);
+
+					VkCommandBufferInheritanceRenderingInfoKHR renderingInfo{};
+					renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+					renderingInfo.colorAttachmentCount = static_cast<uint32_t>(pFormats->colorFormats.size());
+					renderingInfo.pColorAttachmentFormats = pFormats->colorFormats.data();
+					renderingInfo.depthAttachmentFormat = pFormats->depthFormat;
+					renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+					renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+					VkCommandBufferInheritanceInfo inheritanceInfo{};
+					inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+					inheritanceInfo.pNext = &renderingInfo;
+					inheritanceInfo.renderPass = VK_NULL_HANDLE;
+					inheritanceInfo.pipelineStatistics = m_Device.HasPipelineStatistics() ? Device::PIPELINE_STATISTICS : 0;
+
+					VkCommandBufferBeginInfo beginInfo{};
+					beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+					beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+					beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+					if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to begin secondary command buffer!");
+					}
+
+					chunk(commandBuffer);
+
+					if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to record secondary command buffer!");
+					}
+
+					return commandBuffer;
+				}));
+		}
+
+		return batch;
+	}
+
+	void ParallelRecorder::Execute(VkCommandBuffer commandBuffer, Batch& batch)
+	{
+		if (batch.empty())
+			return;
+
+		std::vector<VkCommandBuffer> secondaryBuffers;
+		secondaryBuffers.reserve(batch.size());
+		for (auto& future : batch)
+		{
+			secondaryBuffers.push_back(future.get()); // rethrows whatever the worker threw
+		}
+		batch.clear();
+
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+	}
+
+	std::vector<ParallelRecorder::Range> ParallelRecorder::Split(size_t count, uint32_t chunkCount, size_t minChunkSize)
+	{
+		std::vector<Range> ranges;
+		if (count == 0)
+			return ranges;
+
+		const size_t maxChunks = std::max<size_t>(count / std::max<size_t>(minChunkSize, 1), 1);
+		const size_t chunks = std::clamp<size_t>(chunkCount, 1, maxChunks);
+		const size_t chunkSize = count / chunks;
+		const size_t remainder = count % chunks;
+
+		size_t first = 0;
+		for (size_t index{ 0 }; index < chunks; ++index)
+		{
+			const size_t size = chunkSize + (index < remainder ? 1 : 0);
+			ranges.push_back({ first, size });
+			first += size;
+		}
+
+		return ranges;
+	}
+
+
+	// Private Methods
+	//--------------------
+	void ParallelRecorder::CreateCommandPools()
+	{
+		const QueueFamilyIndices queueFamilyIndices = m_Device.GetPhysicalQueueFamilies();
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole every frame
+		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+		m_FramePools.resize(m_ThreadPool.GetThreadCount() + 1);
+		for (auto& threadPools : m_FramePools)
+		{
+			threadPools.resize(m_FramesInFlight);
+			for (auto& framePool : threadPools)
+			{
+				if (vkCreateCommandPool(m_Device.GetDevice(), &poolInfo, nullptr, &framePool.commandPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create secondary command pool!");
+				}
+			}
+		}
+	}
+
+	VkCommandBuffer ParallelRecorder::AcquireCommandBuffer(uint32_t threadIndex, uint32_t frameIndex)
+	{
+		FramePool& framePool = m_FramePools[threadIndex][frameIndex];
+
+		// buffers are kept across frames and only reset together with their pool
+		if (framePool.usedCount == framePool.commandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = framePool.commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(m_Device.GetDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+			framePool.commandBuffers.push_back(commandBuffer);
+		}
+
+		return framePool.commandBuffers[framePool.usedCount++];
+	}
+}
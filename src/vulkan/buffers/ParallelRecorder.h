@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../SwapChain.h"
+#include "../../core/ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace cat
+{
+	// Records secondary command buffers on the worker threads of a ThreadPool.
+	// Every worker owns one command pool per frame in flight, so no pool is ever touched by two threads at once.
+	class ParallelRecorder final
+	{
+	public:
+		struct RenderingFormats
+		{
+			std::vector<VkFormat> colorFormats{};
+			VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		};
+
+		struct Range
+		{
+			size_t first;
+			size_t count;
+		};
+
+		using RecordFunction = std::function<void(VkCommandBuffer)>;
+		using Batch = std::vector<std::future<VkCommandBuffer>>;
+
+		// CTOR & DTOR
+		//--------------------
+		ParallelRecorder(Device& device, ThreadPool& threadPool, uint32_t framesInFlight = cat::MAX_FRAMES_IN_FLIGHT);
+		~ParallelRecorder();
+
+		ParallelRecorder(const ParallelRecorder&) = delete;
+		ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+		ParallelRecorder(ParallelRecorder&&) = delete;
+		ParallelRecorder& operator=(ParallelRecorder&&) = delete;
+
+		// Methods
+		//--------------------
+		// resets the pools of this frame, only call once its fence has been waited on
+		void BeginFrame(uint32_t frameIndex);
+
+		// every chunk is recorded into its own secondary buffer that continues a dynamic rendering instance with these formats
+		Batch Record(const RenderingFormats& formats, std::vector<RecordFunction> chunks);
+
+		// waits for the batch and executes its buffers in submission order, must be called inside a rendering instance
+		// that was begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR
+		static void Execute(VkCommandBuffer commandBuffer, Batch& batch);
+
+		// splits [0, count) into at most chunkCount contiguous ranges of at least minChunkSize elements
+		static std::vector<Range> Split(size_t count, uint32_t chunkCount, size_t minChunkSize = 16);
+
+		// Getters & Setters
+		uint32_t GetThreadCount() const { return std::max(m_ThreadPool.GetThreadCount(), 1u); }
+
+	private:
+		// Private Methods
+		//--------------------
+		void CreateCommandPools();
+		VkCommandBuffer AcquireCommandBuffer(uint32_t threadIndex, uint32_t frameIndex);
+
+		// Private Members
+		//--------------------
+		struct FramePool
+		{
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers{};
+			size_t usedCount = 0;
+		};
+
+		Device& m_Device;
+		ThreadPool& m_ThreadPool;
+		uint32_t m_FramesInFlight;
+		uint32_t m_FrameIndex = 0;
+
+		// [thread][frame], the last thread slot belongs to callers outside of the pool
+		std::vector<std::vector<FramePool>> m_FramePools;
+	};
+}
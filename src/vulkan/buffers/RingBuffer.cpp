@@ -0,0 +1,60 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace cat
+{
+	// CTOR & DTOR
+	//--------------------
+	RingBuffer::RingBuffer(Device& device, VkDeviceSize frameCapacity, uint32_t framesInFlight)
+		: m_Device(device)
+	{
+		// every allocation has to be a valid dynamic offset for both uniform and storage descriptors
+		const VkPhysicalDeviceLimits& limits = m_Device.GetPhysicalDeviceProperties().limits;
+		m_Alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+		m_FrameCapacity = (frameCapacity + m_Alignment - 1) & ~(m_Alignment - 1);
+
+		m_pBuffer = std::make_unique<Buffer>(
+			m_Device,
+			Buffer::BufferInfo{ m_FrameCapacity * framesInFlight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU }
+		);
+
+		// stays mapped for its whole lifetime, the memory is host coherent so writes need no flush
+		if (m_pBuffer->Map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map ring buffer!");
+		}
+	}
+
+
+	// Methods
+	//--------------------
+	void RingBuffer::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		m_Head = frameIndex * m_FrameCapacity;
+	}
+
+	uint32_t RingBuffer::Push(const void* pData, VkDeviceSize size, VkDeviceSize reservedSize)
+	{
+		const VkDeviceSize allocationSize = std::max(size, reservedSize);
+		const VkDeviceSize frameEnd = (m_FrameIndex + 1) * m_FrameCapacity;
+
+		if (m_Head + allocationSize > frameEnd)
+		{
+			throw std::runtime_error("ring buffer frame capacity exceeded!");
+		}
+
+		const VkDeviceSize offset = m_Head;
+		if (size > 0)
+		{
+			std::memcpy(static_cast<char*>(m_pBuffer->GetRawData()) + offset, pData, size);
+		}
+
+		m_Head = std::min((offset + allocationSize + m_Alignment - 1) & ~(m_Alignment - 1), frameEnd);
+
+		return static_cast<uint32_t>(offset);
+	}
+}
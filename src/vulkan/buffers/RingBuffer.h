@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Buffer.h"
+#include "../SwapChain.h"
+
+// std
+#include <algorithm>
+#include <vector>
+
+namespace cat
+{
+	// One persistently mapped buffer that is split into a region per frame in flight.
+	// Per-frame data is linearly sub-allocated from the current region and bound with dynamic offsets,
+	// so a frame only costs a memcpy per upload instead of a map/unmap per buffer.
+	class RingBuffer final
+	{
+	public:
+		// CTOR & DTOR
+		//--------------------
+		RingBuffer(Device& device, VkDeviceSize frameCapacity, uint32_t framesInFlight = cat::MAX_FRAMES_IN_FLIGHT);
+		~RingBuffer() = default;
+
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+		RingBuffer(RingBuffer&&) = delete;
+		RingBuffer& operator=(RingBuffer&&) = delete;
+
+		// Methods
+		//--------------------
+		// rewinds the region of this frame, only call once its fence has been waited on
+		void BeginFrame(uint32_t frameIndex);
+
+		// copies size bytes and reserves at least reservedSize, returns the dynamic offset of the allocation
+		uint32_t Push(const void* pData, VkDeviceSize size, VkDeviceSize reservedSize = 0);
+
+		template<typename T>
+		uint32_t Push(const T& data)
+		{
+			return Push(&data, sizeof(T));
+		}
+
+		// copies count elements but reserves room for capacityCount, matching a descriptor range of capacityCount elements
+		template<typename T>
+		uint32_t PushArray(const T* pData, size_t count, size_t capacityCount)
+		{
+			return Push(pData, sizeof(T) * std::min(count, capacityCount), sizeof(T) * capacityCount);
+		}
+
+		// Getters & Setters
+		VkBuffer GetBuffer() const { return m_pBuffer->GetBuffer(); }
+		VkDeviceSize GetFrameCapacity() const { return m_FrameCapacity; }
+		VkDeviceSize GetUsedSize() const { return m_Head - m_FrameIndex * m_FrameCapacity; }
+
+		// the descriptor always starts at 0, the actual location is given by the dynamic offset at bind time
+		VkDescriptorBufferInfo GetDescriptorBufferInfo(VkDeviceSize range) const
+		{
+			return VkDescriptorBufferInfo{
+				.buffer = m_pBuffer->GetBuffer(),
+				.offset = 0,
+				.range = range
+			};
+		}
+		std::vector<VkDescriptorBufferInfo> GetDescriptorBufferInfos(VkDeviceSize range, uint32_t count = cat::MAX_FRAMES_IN_FLIGHT) const
+		{
+			return std::vector<VkDescriptorBufferInfo>(count, GetDescriptorBufferInfo(range));
+		}
+
+	private:
+		// Private Members
+		//--------------------
+		Device& m_Device;
+		std::unique_ptr<Buffer> m_pBuffer;
+
+		VkDeviceSize m_FrameCapacity;
+		VkDeviceSize m_Alignment;
+		uint32_t m_FrameIndex = 0;
+		VkDeviceSize m_Head = 0;
+	};
+}
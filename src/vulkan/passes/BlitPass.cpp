@@ -3,8 +3,8 @@
 #include "LightingPass.h"
 #include "../utils/DebugLabel.h"
 
-cat::BlitPass::BlitPass(Device& device, SwapChain& swapChain, uint32_t framesInFlight, VolumetricPass& prevPass)
-	: m_Device(device), m_FramesInFlight(framesInFlight), m_SwapChain(swapChain) , m_Extent(swapChain.GetSwapChainExtent()), m_PrevPass(prevPass)
+cat::BlitPass::BlitPass(Device& device, const FrameConstants& frameConstants, SwapChain& swapChain, uint32_t framesInFlight, VolumetricPass& prevPass)
+	: m_Device(device), m_FrameConstants(frameConstants), m_FramesInFlight(framesInFlight), m_SwapChain(swapChain) , m_Extent(swapChain.GetSwapChainExtent()), m_PrevPass(prevPass)
 {
 	CreateDescriptors();
 	CreatePipeline();
@@ -23,40 +23,22 @@ cat::BlitPass::~BlitPass()
 	m_pPipeline = nullptr;
 }
 
-void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Camera& camera) const
+void cat::BlitPass::AddToGraph(RenderGraph& graph, uint32_t frameIndex, Image& targetImage) const
 {
-	DebugLabel::Begin(commandBuffer, "Blit Pass", glm::vec4(1.0f, 0.7f, 0.7f, 1));
+	graph.AddPass("BlitPass", [this, frameIndex, &targetImage](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, frameIndex, targetImage);
+		})
+		.Read(m_PrevPass.GetVolumetricImage(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Write(targetImage, RenderGraph::COLOR_ATTACHMENT_WRITE, true);
+}
 
-	Image& swapchainImage = *m_SwapChain.GetSwapChainImage(frameIndex);
+void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Image& targetImage) const
+{
+	DebugLabel::Begin(commandBuffer, "Blit Pass", glm::vec4(1.0f, 0.7f, 0.7f, 1));
 
 	// BEGIN RECORDING
 	{
-		ToneMappingUbo uboData = {
-			.aperture = camera.GetAperture(),
-			.shutterSpeed = camera.GetShutterSpeed(),
-			.iso = camera.GetIso()
-		};
-		m_pUniformBuffer->Update(frameIndex, uboData);
-
-
-		// transitioning images
-		//----------------------
-		swapchainImage.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			{
-				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				VK_ACCESS_NONE,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-			});
-
-		m_PrevPass.GetVolumetricImages()[frameIndex]->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			{
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			});
-
 		// Render Attachments
 		//---------------------
 		VkClearValue clearValue{};
@@ -66,7 +48,7 @@ void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, c
 		std::vector<VkRenderingAttachmentInfoKHR> colorAttachments(1);
 
 		colorAttachments[0].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
-		colorAttachments[0].imageView = swapchainImage.GetImageView();
+		colorAttachments[0].imageView = targetImage.GetImageView();
 		colorAttachments[0].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		colorAttachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		colorAttachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -102,7 +84,8 @@ void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, c
 
 		m_pPipeline->Bind(commandBuffer);
 
-		m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 0);
+		m_FrameConstants.Bind(commandBuffer, m_pPipeline->GetPipelineLayout()); // exposure
+		m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 1);
 
 		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
@@ -111,16 +94,6 @@ void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, c
 	// END RECORDING
 	{
 		vkCmdEndRenderingKHR(commandBuffer);
-
-		// transitioning images
-		//----------------------
-		swapchainImage.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			Image::BarrierInfo{
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_NONE
-			});
 	}
 
 	DebugLabel::End(commandBuffer);
@@ -128,29 +101,18 @@ void cat::BlitPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, c
 
 void cat::BlitPass::CreateDescriptors()
 {
-	m_pUniformBuffer = std::make_unique<UniformBuffer<ToneMappingUbo>>(m_Device, m_FramesInFlight);
-
-
 	m_pDescriptorPool = new DescriptorPool(m_Device);
 	m_pDescriptorPool
 		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight )
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_FramesInFlight)
 		->Create(m_FramesInFlight);
 
 	m_pDescriptorSetLayout = new DescriptorSetLayout(m_Device);
 	m_pDescriptorSetLayout
 		->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-		->AddBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
 		->Create();
 
 	m_pDescriptorSet = new DescriptorSet(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
-	for (int i{}; i < m_pDescriptorSet->GetDescriptorSetCount();i++)
-	{
-		m_pDescriptorSet
-			->AddImageWrite(0, m_PrevPass.GetVolumetricImages()[i]->GetImageInfo(), i) //Lit image
-			->AddBufferWrite(1, m_pUniformBuffer->GetDescriptorBufferInfos(), i)
-			->UpdateByIdx(i);
-	}
+	// written in UpdateDescriptors, once the volumetric images have memory
 }
 
 void cat::BlitPass::CreatePipeline()
@@ -172,7 +134,7 @@ void cat::BlitPass::CreatePipeline()
 	pipelineInfo.vertexBindingDescriptions = {};
 	pipelineInfo.vertexAttributeDescriptions = {};
 
-	pipelineInfo.CreatePipelineLayout(m_Device, { m_pDescriptorSetLayout->GetDescriptorSetLayout() });
+	pipelineInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout(), m_pDescriptorSetLayout->GetDescriptorSetLayout() });
 
 	m_pPipeline = new Pipeline(m_Device, m_VertPath, m_FragPath, pipelineInfo);
 }
@@ -180,11 +142,15 @@ void cat::BlitPass::CreatePipeline()
 void cat::BlitPass::Resize(VkExtent2D size)
 {
 	m_Extent = size;
-	for (size_t i{ 0 }; i < m_FramesInFlight; i++) 
+}
+
+void cat::BlitPass::UpdateDescriptors()
+{
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; i++)
 	{
 		m_pDescriptorSet->ClearDescriptorWrites();
 		m_pDescriptorSet
-			->AddImageWrite(0, m_PrevPass.GetVolumetricImages()[i]->GetImageInfo(), i) //Lit image
+			->AddImageWrite(0, m_PrevPass.GetVolumetricImage(i).GetImageInfo(), i) // volumetric image
 			->UpdateByIdx(i);
 	}
-}
\ No newline at end of file
+}
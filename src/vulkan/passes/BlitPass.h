@@ -12,7 +12,7 @@ namespace cat
 	public:
 		// CTOR & DTOR
 		//----------------
-		BlitPass(Device& device, SwapChain& swapChain, uint32_t framesInFlight, VolumetricPass& prevPass);
+		BlitPass(Device& device, const FrameConstants& frameConstants, SwapChain& swapChain, uint32_t framesInFlight, VolumetricPass& prevPass);
 		~BlitPass();
 
 		BlitPass(const BlitPass&) = delete;
@@ -22,8 +22,12 @@ namespace cat
 
 		// METHODS
 		//-----------------
-		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Camera& camera) const;
+		// tone maps this frame's volumetric image into the acquired swapchain image
+		void AddToGraph(RenderGraph& graph, uint32_t frameIndex, Image& targetImage) const;
+		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Image& targetImage) const;
 		void Resize(VkExtent2D size);
+		// points the sampler at the current volumetric images, call after every transient allocation
+		void UpdateDescriptors();
 
 
 
@@ -37,16 +41,11 @@ namespace cat
 		// PRIVATE MEMBERS
 		//-----------------
 		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
 		const uint32_t m_FramesInFlight;
 		SwapChain& m_SwapChain;
 		VkExtent2D m_Extent;
 
-		struct alignas(16) ToneMappingUbo{
-			float aperture;
-			float shutterSpeed;
-			float iso;
-		};
-		std::unique_ptr<UniformBuffer<ToneMappingUbo>> m_pUniformBuffer;
 
 		std::string m_VertPath = "shaders/triangle.vert.spv";
 		std::string m_FragPath = "shaders/blit.frag.spv";
@@ -2,126 +2,133 @@
 
 #include "../utils/DebugLabel.h"
 
-cat::DepthPrepass::DepthPrepass(Device& device, uint32_t framesInFlight)
-	: m_Device(device), m_FramesInFlight(framesInFlight)
+cat::DepthPrepass::DepthPrepass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight)
+	: m_Device(device), m_FrameConstants(frameConstants), m_FramesInFlight(framesInFlight)
 {
-	CreateUniformBuffers();
-	CreateDescriptors();
 	CreatePipeline();
 }
 
 cat::DepthPrepass::~DepthPrepass()
 {
-	delete m_pDescriptorSet;
-	m_pDescriptorSet = nullptr;
-	delete m_pDescriptorSetLayout;
-	m_pDescriptorSetLayout = nullptr;
-	delete m_pDescriptorPool;
-	m_pDescriptorPool = nullptr;
-
 	delete m_pPipeline;
 }
 
-void cat::DepthPrepass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
-	Image& depthImage, Camera camera, Scene& scene) const
+void cat::DepthPrepass::AddToGraph(RenderGraph& graph, ParallelRecorder& recorder, uint32_t frameIndex, Image& depthImage, const Scene& scene, HiZPass& hiZPass)
 {
-	// BEGIN RECORDING
+	const VkBuffer earlyCommands = hiZPass.GetEarlyCommands(frameIndex);
+	const VkBuffer lateCommands = hiZPass.GetLateCommands(frameIndex);
+
+	graph.AddPass("DepthPrepass", [this, &depthImage](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, depthImage, m_Draws, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		})
+		.ReadBuffer(earlyCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+		.Write(depthImage, RenderGraph::DEPTH_ATTACHMENT_WRITE, true)
+		.Prepare([this, &recorder, frameIndex, &depthImage, &scene, earlyCommands]
+		{
+			m_Draws = RecordDraws(recorder, frameIndex, depthImage, scene, earlyCommands);
+		});
+
+	hiZPass.AddBuildToGraph(graph, frameIndex, depthImage);
+
+	// adds what the early cull wrongly rejected on top of the early depth
+	graph.AddPass("DepthPrepassLate", [this, &depthImage](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, depthImage, m_LateDraws, VK_ATTACHMENT_LOAD_OP_LOAD);
+		})
+		.ReadBuffer(lateCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+		.Write(depthImage, RenderGraph::DEPTH_ATTACHMENT_WRITE)
+		.Prepare([this, &recorder, frameIndex, &depthImage, &scene, lateCommands]
+		{
+			m_LateDraws = RecordDraws(recorder, frameIndex, depthImage, scene, lateCommands);
+		});
+}
+
+cat::ParallelRecorder::Batch cat::DepthPrepass::RecordDraws(ParallelRecorder& recorder, uint32_t frameIndex,
+	const Image& depthImage, const Scene& scene, VkBuffer indirectBuffer) const
+{
+	const VkExtent2D extent = depthImage.GetExtent();
+	const auto& drawItems = scene.GetOpaqueDrawItems();
+
+	std::vector<ParallelRecorder::RecordFunction> chunks;
+	for (const auto& range : ParallelRecorder::Split(drawItems.size(), recorder.GetThreadCount()))
 	{
-		MatrixUbo uboData = { camera.GetView(), camera.GetProjection() };
-		m_pUniformBuffer->Update(frameIndex, uboData);
-
-		depthImage.TransitionImageLayout(commandBuffer,VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			Image::BarrierInfo{
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-	VK_ACCESS_NONE,
-	VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		chunks.emplace_back([this, frameIndex, extent, &scene, &drawItems, range, indirectBuffer](VkCommandBuffer commandBuffer)
+			{
+				RecordDrawChunk(commandBuffer, frameIndex, extent, scene,
+					std::span(drawItems).subspan(range.first, range.count), indirectBuffer, range.first);
 			});
+	}
 
+	return recorder.Record({ {}, VK_FORMAT_D32_SFLOAT }, std::move(chunks));
+}
+
+void cat::DepthPrepass::Record(VkCommandBuffer commandBuffer, Image& depthImage,
+	ParallelRecorder::Batch& draws, VkAttachmentLoadOp loadOp) const
+{
+	// BEGIN RECORDING
+	{
 		// Render Attachments
 		VkRenderingAttachmentInfoKHR depthAttachmentInfo{};
 		depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
 		depthAttachmentInfo.imageView = depthImage.GetImageView();
 		depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachmentInfo.loadOp = loadOp;
 		depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		depthAttachmentInfo.clearValue.depthStencil = { 1.0f, 0 };
 
 		// Render Info
 		VkRenderingInfoKHR renderInfo{};
 		renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
 		renderInfo.renderArea = { {0, 0}, depthImage.GetExtent() };
 		renderInfo.layerCount = 1;
 		renderInfo.colorAttachmentCount = 0;
 		renderInfo.pColorAttachments = nullptr;
 		renderInfo.pDepthAttachment = &depthAttachmentInfo;
-		DebugLabel::Begin(commandBuffer, "Depth Prepass", glm::vec4(0.3f, 0.5f, 1.f, 1));
+		DebugLabel::Begin(commandBuffer, loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR ? "Depth Prepass" : "Depth Prepass Late", glm::vec4(0.3f, 0.5f, 1.f, 1));
 		vkCmdBeginRenderingKHR(commandBuffer, &renderInfo);
 	}
 
 	// Drawing
 	{
-		m_pPipeline->Bind(commandBuffer);
-
-		// viewport
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(depthImage.GetExtent().width);
-		viewport.height = static_cast<float>(depthImage.GetExtent().height);
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-		// scissor
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = depthImage.GetExtent();
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-		m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex);
-
-		// draw the scene
-		scene.DrawOpaque(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, true);
+		ParallelRecorder::Execute(commandBuffer, draws);
 	}
 
 	// END RECORDING
 	{
 		vkCmdEndRenderingKHR(commandBuffer);
 		DebugLabel::End(commandBuffer);
-		depthImage.TransitionImageLayout( commandBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			Image::BarrierInfo{
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
-			});
 	}
 }
 
-
-void cat::DepthPrepass::CreateUniformBuffers()
+void cat::DepthPrepass::RecordDrawChunk(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D extent,
+	const Scene& scene, std::span<const Scene::DrawItem> drawItems, VkBuffer indirectBuffer, size_t firstCommand) const
 {
-	m_pUniformBuffer = std::make_unique<UniformBuffer<MatrixUbo>>(m_Device);
+	// secondary buffers inherit no state, so every chunk binds everything itself
+	m_pPipeline->Bind(commandBuffer);
+
+	// viewport
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	// scissor
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	m_FrameConstants.Bind(commandBuffer, m_pPipeline->GetPipelineLayout());
+
+	// draw the scene, the culled items have an instance count of 0
+	scene.DrawItemsIndirect(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, true, drawItems, indirectBuffer, firstCommand);
 }
 
-void cat::DepthPrepass::CreateDescriptors()
-{
-	m_pDescriptorPool = new DescriptorPool(m_Device);
-	m_pDescriptorPool
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, cat::MAX_FRAMES_IN_FLIGHT)
-		->Create(m_FramesInFlight);
-
-	m_pDescriptorSetLayout = new DescriptorSetLayout(m_Device);
-	m_pDescriptorSetLayout
-		->AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-		->Create();
-
-	m_pDescriptorSet = new DescriptorSet(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight );
-	m_pDescriptorSet
-		->AddBufferWrite(0, m_pUniformBuffer->GetDescriptorBufferInfos())
-		->UpdateAll();
-
-}
 
 void cat::DepthPrepass::CreatePipeline()
 {
@@ -130,7 +137,7 @@ void cat::DepthPrepass::CreatePipeline()
 	pipelineInfo.colorAttachments = { };
 	pipelineInfo.colorBlending.attachmentCount = 0;
 	pipelineInfo.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
-	pipelineInfo.CreatePipelineLayout(m_Device, { m_pDescriptorSetLayout->GetDescriptorSetLayout() });
+	pipelineInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout() });
 
 	m_pPipeline = new Pipeline(
 		m_Device,
@@ -1,5 +1,9 @@
 #pragma once
 #include "../Pipeline.h"
+#include "../RenderGraph.h"
+#include "../buffers/ParallelRecorder.h"
+#include "../buffers/FrameConstants.h"
+#include "HiZPass.h"
 
 #include "../scene/Camera.h"
 #include "../scene/Scene.h"
@@ -11,7 +15,7 @@ namespace cat
 	public:
 		// CTOR & DTOR
 		//------------------------------
-		DepthPrepass(Device& device, uint32_t framesInFlight);
+		DepthPrepass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight);
 		~DepthPrepass();
 
 		DepthPrepass(const DepthPrepass&) = delete;
@@ -22,31 +26,35 @@ namespace cat
 
 		// METHODS
 		//------------------------------
-		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Image& depthImage, Camera camera, Scene& scene) const;
+		// writes the depth image in two passes around the Hi-Z pyramid build: the draws that passed the early cull,
+		// then the ones the late cull found visible. The draws are recorded on the worker threads once the graph knows the pass is live
+		void AddToGraph(RenderGraph& graph, ParallelRecorder& recorder, uint32_t frameIndex, Image& depthImage, const Scene& scene, HiZPass& hiZPass);
+
+		// records the scene draws on the worker threads, has to be called before Record of the same frame
+		ParallelRecorder::Batch RecordDraws(ParallelRecorder& recorder, uint32_t frameIndex, const Image& depthImage, const Scene& scene, VkBuffer indirectBuffer) const;
+		void Record(VkCommandBuffer commandBuffer, Image& depthImage, ParallelRecorder::Batch& draws, VkAttachmentLoadOp loadOp) const;
 
 	private:
 		// Private methods
 		//------------------------------
-		void CreateUniformBuffers();
-		void CreateDescriptors();
 		void CreatePipeline();
 
+		void RecordDrawChunk(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D extent, const Scene& scene, std::span<const Scene::DrawItem> drawItems,
+			VkBuffer indirectBuffer, size_t firstCommand) const;
 
 
 		// Private members
 		//------------------------------
 		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
 		uint32_t m_FramesInFlight;
 
-		std::unique_ptr<UniformBuffer<MatrixUbo>> m_pUniformBuffer;
-		DescriptorPool* m_pDescriptorPool;
-		DescriptorSetLayout* m_pDescriptorSetLayout;
-		DescriptorSet* m_pDescriptorSet;
-
 		std::string m_VertPath = "shaders/depth.vert.spv";
 		std::string m_FragPath = "";
 
 		Pipeline* m_pPipeline;
 
+		ParallelRecorder::Batch m_Draws{};
+		ParallelRecorder::Batch m_LateDraws{};
 	};
 }
@@ -1,15 +1,25 @@
 #pragma once
 #include "../scene/Scene.h"
 #include "../scene/Camera.h"
+#include "../buffers/ParallelRecorder.h"
+#include "../buffers/FrameConstants.h"
+#include "../RenderGraph.h"
+#include "../TransientImageAllocator.h"
+#include "HiZPass.h"
 
 namespace cat
 {
 	class GeometryPass
 	{
 	public:
+		// 10 bytes per pixel, the world position is reconstructed from depth in the lighting pass
+		static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;		// rgb albedo
+		static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16_SFLOAT;		// octahedral world normal, see EncodeOctahedral in gbuffer.glsl
+		static constexpr VkFormat SPECULAR_FORMAT = VK_FORMAT_R8G8_UNORM;		// r = metallic, g = roughness
+
 		// CTOR & DTOR
 		//----------------
-		GeometryPass(Device& device, VkExtent2D extent, uint32_t framesInFlight);
+		GeometryPass(Device& device, const FrameConstants& frameConstants, TransientImageAllocator& transientImages, VkExtent2D extent, uint32_t framesInFlight);
 		~GeometryPass();
 
 		GeometryPass(const GeometryPass&) = delete;
@@ -19,48 +29,55 @@ namespace cat
 
 		//METHODS
 		//-----------------
+		// tests against the prepass depth & writes this frame's G-buffer, the opaque draws use the commands of both Hi-Z cull phases
+		void AddToGraph(RenderGraph& graph, ParallelRecorder& recorder, uint32_t frameIndex, Image& depthImage, const Scene& scene, const HiZPass& hiZPass);
+
+		// records the scene draws on the worker threads, has to be called before Record of the same frame
+		ParallelRecorder::Batch RecordDraws(ParallelRecorder& recorder, uint32_t frameIndex, const Scene& scene, VkBuffer indirectBuffer) const;
 		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
-			Image& depthImage,
-		            Camera camera, Scene& scene) const;
+			Image& depthImage, ParallelRecorder::Batch& draws) const;
+		// requests the G-buffer at the new size, the transient images have to be cleared before & allocated after
 		void Resize(VkExtent2D size);
 
 		// Getters & Setters
-		Image& GetAlbedoBuffer(int idx) const { return *m_pAlbedoBuffers[idx]; }
-		Image& GetNormalBuffer(int idx) const { return *m_pNormalBuffers[idx]; }
-		Image& GetSpecularBuffer(int idx) const { return *m_pSpecularBuffers[idx]; }
-		Image& GetWorldBuffer(int idx) const { return *m_pWorldBuffers[idx]; }
+		Image& GetAlbedoBuffer(int idx) const { return m_TransientImages.GetImage(m_AlbedoBuffers[idx]); }
+		Image& GetNormalBuffer(int idx) const { return m_TransientImages.GetImage(m_NormalBuffers[idx]); }
+		Image& GetSpecularBuffer(int idx) const { return m_TransientImages.GetImage(m_SpecularBuffers[idx]); }
 
 
 	private:
 		// PRIVATE METHODS
 		//-----------------
-		void CreateUniformBuffers();
+		void RequestImages();
 		void CreateDescriptors();
 		void CreatePipeline();
 
+		// draws directly when indirectBuffer is VK_NULL_HANDLE
+		void RecordDrawChunk(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Scene& scene, std::span<const Scene::DrawItem> drawItems,
+			VkBuffer indirectBuffer, size_t firstCommand) const;
+
 		//PRIVATE MEMBERS
 		//-----------------
 		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
+		TransientImageAllocator& m_TransientImages;
 		uint32_t m_FramesInFlight;
 		VkExtent2D m_Extent;
 
-		
-		std::unique_ptr<UniformBuffer<MatrixUbo>> m_pUniformBuffer;
 
-		DescriptorPool* m_pDescriptorPool;
-		DescriptorSetLayout* m_pUboDescriptorSetLayout;
 		DescriptorSetLayout* m_pSamplersDescriptorSetLayout;
-		DescriptorSet* m_pDescriptorSet;
 
 		std::string m_VertPath = "shaders/geometry.vert.spv";
 		std::string m_FragPath = "shaders/geometry.frag.spv";
 
 		Pipeline* m_pPipeline;
 
-		std::vector<std::unique_ptr<Image>> m_pAlbedoBuffers;
-		std::vector<std::unique_ptr<Image>> m_pNormalBuffers;
-		std::vector<std::unique_ptr<Image>> m_pSpecularBuffers;
-		std::vector<std::unique_ptr<Image>> m_pWorldBuffers;
+		// only alive from this pass until lighting, so the memory is shared with later targets
+		std::vector<TransientImageAllocator::ImageHandle> m_AlbedoBuffers;
+		std::vector<TransientImageAllocator::ImageHandle> m_NormalBuffers;
+		std::vector<TransientImageAllocator::ImageHandle> m_SpecularBuffers;
+
+		ParallelRecorder::Batch m_Draws{};
 	};
 
 }
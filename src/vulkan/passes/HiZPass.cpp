@@ -0,0 +1,384 @@
+#include "HiZPass.h"
+
+#include "../utils/DebugLabel.h"
+
+// std
+#include <algorithm>
+#include <iostream>
+
+cat::HiZPass::HiZPass(Device& device, const FrameConstants& frameConstants, SwapChain& swapChain, uint32_t framesInFlight)
+	: m_Device(device), m_FrameConstants(frameConstants), m_SwapChain(swapChain), m_FramesInFlight(framesInFlight)
+{
+	m_DrawCounts.resize(m_FramesInFlight, 0);
+
+	CreatePyramid(m_SwapChain.GetSwapChainExtent());
+	CreateDrawBuffers();
+	CreateCounters();
+	CreateDescriptors();
+	UpdateDescriptors();
+	CreatePipelines();
+}
+
+cat::HiZPass::~HiZPass() = default;
+
+bool cat::HiZPass::UpdateDraws(uint32_t frameIndex, const Scene& scene)
+{
+	// the fence of this frame has been waited on, so last round's counters are final
+	ReadStats(frameIndex);
+
+	const auto& drawItems = scene.GetOpaqueDrawItems();
+	const uint32_t drawCount = static_cast<uint32_t>(drawItems.size());
+
+	bool isRecreated = false;
+	if (drawCount > m_DrawCapacity)
+	{
+		// the other frames in flight still read & draw from their buffers
+		vkDeviceWaitIdle(m_Device.GetDevice());
+
+		while (m_DrawCapacity < drawCount) m_DrawCapacity *= 2;
+		CreateDrawBuffers();
+		UpdateDescriptors();
+		isRecreated = true;
+	}
+
+	m_CullDraws.clear();
+	for (const auto& item : drawItems)
+	{
+		const auto [worldMin, worldMax] = item.GetWorldBounds();
+		m_CullDraws.push_back({ glm::vec4(worldMin, 1.f), glm::vec4(worldMax, 1.f), item.pMesh->GetElementCount() });
+	}
+	if (drawCount > 0)
+	{
+		vmaCopyMemoryToAllocation(m_Device.GetAllocator(), m_CullDraws.data(), m_pDraws[frameIndex]->GetAllocation(), 0, sizeof(CullDraw) * drawCount);
+	}
+	m_DrawCounts[frameIndex] = drawCount;
+
+	return isRecreated;
+}
+
+void cat::HiZPass::AddCullToGraph(RenderGraph& graph, uint32_t frameIndex)
+{
+
+	// last frame's pyramid, seen from last frame's camera
+	CullPushConstants pushConstants{};
+	pushConstants.pyramidViewProj = m_PyramidViewProj;
+	pushConstants.drawCount = m_DrawCounts[frameIndex];
+	pushConstants.phase = 0;
+	pushConstants.useOcclusion = (m_UseOcclusion && m_IsPyramidValid) ? 1u : 0u;
+
+	// the draws are written by the host before the submit, which makes them visible to the GPU
+	graph.AddPass("HiZCullEarly", [this, frameIndex, pushConstants](VkCommandBuffer commandBuffer)
+		{
+			vkCmdFillBuffer(commandBuffer, m_pCounters[frameIndex]->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+			VkMemoryBarrier clearBarrier{};
+			clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+			RecordCull(commandBuffer, frameIndex, pushConstants);
+		})
+		.Read(*m_pPyramid, RenderGraph::COMPUTE_STORAGE_READ)
+		.WriteBuffer(GetEarlyCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(GetLateCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(GetMainCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(m_pCounters[frameIndex]->GetBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+		.SetSideEffect(); // the statistics are read back on the CPU
+}
+
+void cat::HiZPass::AddBuildToGraph(RenderGraph& graph, uint32_t frameIndex, Image& depthImage)
+{
+	graph.AddPass("HiZBuild", [this, frameIndex](VkCommandBuffer commandBuffer)
+		{
+			RecordBuild(commandBuffer, frameIndex);
+		})
+		.Read(depthImage, RenderGraph::COMPUTE_SAMPLED)
+		.Write(*m_pPyramid, RenderGraph::COMPUTE_STORAGE_WRITE, true);
+
+	// the next frame's early cull tests against this pyramid, seen from this frame's camera
+	m_PyramidViewProj = m_FrameConstants.GetData().viewProj;
+	m_IsPyramidValid = true;
+
+	// the pyramid that was just built from this frame's depth
+	CullPushConstants pushConstants{};
+	pushConstants.pyramidViewProj = m_PyramidViewProj;
+	pushConstants.drawCount = m_DrawCounts[frameIndex];
+	pushConstants.phase = 1;
+	pushConstants.useOcclusion = m_UseOcclusion ? 1u : 0u;
+
+	graph.AddPass("HiZCullLate", [this, frameIndex, pushConstants](VkCommandBuffer commandBuffer)
+		{
+			RecordCull(commandBuffer, frameIndex, pushConstants);
+		})
+		.Read(*m_pPyramid, RenderGraph::COMPUTE_STORAGE_READ)
+		.ReadBuffer(GetEarlyCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+		.WriteBuffer(GetLateCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(GetMainCommands(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(m_pCounters[frameIndex]->GetBuffer(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void cat::HiZPass::Resize(VkExtent2D size)
+{
+	CreatePyramid(size);
+	UpdateDescriptors();
+}
+
+void cat::HiZPass::ToggleOcclusionCulling()
+{
+	m_UseOcclusion = !m_UseOcclusion;
+	std::cout << "Occlusion culling: " << (m_UseOcclusion ? "on" : "off (frustum only)") << std::endl;
+}
+
+
+void cat::HiZPass::RecordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, CullPushConstants pushConstants) const
+{
+	DebugLabel::Begin(commandBuffer, pushConstants.phase == 0 ? "HiZ Cull Early" : "HiZ Cull Late", glm::vec4(0.9f, 0.6f, 0.1f, 1));
+
+	m_pCullPipeline->Bind(commandBuffer);
+	m_FrameConstants.Bind(commandBuffer, m_pCullPipeline->GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE);
+	m_pCullDescriptorSet->Bind(commandBuffer, m_pCullPipeline->GetPipelineLayout(), frameIndex, 1, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	const VkExtent2D pyramidSize = m_pPyramid->GetExtent();
+	pushConstants.pyramidSize = { static_cast<float>(pyramidSize.width), static_cast<float>(pyramidSize.height) };
+	vkCmdPushConstants(commandBuffer, m_pCullPipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+
+	vkCmdDispatch(commandBuffer, (pushConstants.drawCount + 63) / 64, 1, 1);
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::HiZPass::RecordBuild(VkCommandBuffer commandBuffer, uint32_t frameIndex) const
+{
+	DebugLabel::Begin(commandBuffer, "HiZ Build", glm::vec4(0.9f, 0.4f, 0.1f, 1));
+
+	m_pBuildPipeline->Bind(commandBuffer);
+
+	VkExtent2D srcSize = m_SwapChain.GetSwapChainExtent();
+	for (uint32_t level{ 0 }; level < m_pPyramid->GetMipLevels(); ++level)
+	{
+		if (level > 0)
+		{
+			// the previous level has to be written before it is reduced
+			VkMemoryBarrier levelBarrier{};
+			levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &levelBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const VkExtent2D dstSize{
+			std::max(m_pPyramid->GetExtent().width >> level, 1u),
+			std::max(m_pPyramid->GetExtent().height >> level, 1u)
+		};
+
+		m_pBuildDescriptorSet->Bind(commandBuffer, m_pBuildPipeline->GetPipelineLayout(), frameIndex * MAX_PYRAMID_LEVELS + level, 0, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+		BuildPushConstants pushConstants{};
+		pushConstants.srcSize = { static_cast<int>(srcSize.width), static_cast<int>(srcSize.height) };
+		pushConstants.dstSize = { static_cast<int>(dstSize.width), static_cast<int>(dstSize.height) };
+		pushConstants.isDepth = level == 0 ? 1u : 0u;
+		vkCmdPushConstants(commandBuffer, m_pBuildPipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPushConstants), &pushConstants);
+
+		vkCmdDispatch(commandBuffer, (dstSize.width + 7) / 8, (dstSize.height + 7) / 8, 1);
+		srcSize = dstSize;
+	}
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::HiZPass::ReadStats(uint32_t frameIndex)
+{
+	Counters counters{};
+	vmaCopyAllocationToMemory(m_Device.GetAllocator(), m_pCounters[frameIndex]->GetAllocation(), 0, &counters, sizeof(Counters));
+
+	m_Stats.drawCount = m_DrawCounts[frameIndex];
+	m_Stats.earlyVisible = counters.earlyVisible;
+	m_Stats.lateVisible = counters.lateVisible;
+}
+
+
+void cat::HiZPass::CreatePyramid(VkExtent2D depthSize)
+{
+	// largest power of two that fits in the depth, so every level halves exactly
+	const auto previousPowerOfTwo = [](uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result * 2 <= value) result *= 2;
+			return result;
+		};
+
+	const uint32_t width = previousPowerOfTwo(std::max(depthSize.width, 1u));
+	const uint32_t height = previousPowerOfTwo(std::max(depthSize.height, 1u));
+
+	uint32_t mipLevels = 1;
+	while ((std::max(width, height) >> mipLevels) > 0) ++mipLevels;
+	mipLevels = std::min(mipLevels, MAX_PYRAMID_LEVELS);
+
+	m_pPyramid = std::make_unique<Image>(m_Device, width, height, mipLevels, PYRAMID_FORMAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO);
+	m_pPyramid->SetName("Hi-Z pyramid");
+
+	// nothing has been built into the new pyramid yet
+	m_IsPyramidValid = false;
+}
+
+void cat::HiZPass::CreateDrawBuffers()
+{
+	m_pDraws.clear();
+	m_pEarlyCommands.clear();
+	m_pLateCommands.clear();
+	m_pMainCommands.clear();
+	m_CullDraws.reserve(m_DrawCapacity);
+
+	const VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * m_DrawCapacity;
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pDraws.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(CullDraw) * m_DrawCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, true }));
+		m_pEarlyCommands.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, false }));
+		m_pLateCommands.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, false }));
+		m_pMainCommands.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, false }));
+	}
+}
+
+void cat::HiZPass::CreateCounters()
+{
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		// read back on the CPU once the frame is done
+		m_pCounters.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(Counters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO, true }));
+		Counters counters{};
+		m_pCounters.back()->WriteToBuffer(&counters);
+	}
+}
+
+void cat::HiZPass::CreateDescriptors()
+{
+	m_pDescriptorPool = std::make_unique<DescriptorPool>(m_Device);
+	m_pDescriptorPool
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_FramesInFlight * 5)
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight * (MAX_PYRAMID_LEVELS + 1))
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_FramesInFlight * MAX_PYRAMID_LEVELS)
+		->Create(m_FramesInFlight * (MAX_PYRAMID_LEVELS + 1));
+
+	// CULL
+	{
+		m_pCullDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+		m_pCullDescriptorSetLayout
+			->AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->Create();
+
+		m_pCullDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pCullDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
+	}
+
+	// BUILD
+	{
+		m_pBuildDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+		m_pBuildDescriptorSetLayout
+			->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+			->Create();
+
+		m_pBuildDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pBuildDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight * MAX_PYRAMID_LEVELS);
+	}
+}
+
+void cat::HiZPass::UpdateDescriptors()
+{
+	std::vector<VkDescriptorBufferInfo> drawInfos, earlyInfos, lateInfos, mainInfos, counterInfos;
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		drawInfos.push_back(m_pDraws[i]->GetDescriptorBufferInfo());
+		earlyInfos.push_back(m_pEarlyCommands[i]->GetDescriptorBufferInfo());
+		lateInfos.push_back(m_pLateCommands[i]->GetDescriptorBufferInfo());
+		mainInfos.push_back(m_pMainCommands[i]->GetDescriptorBufferInfo());
+		counterInfos.push_back(m_pCounters[i]->GetDescriptorBufferInfo());
+	}
+
+	// the pyramid stays in GENERAL, it is written & read by compute only
+	const VkDescriptorImageInfo pyramidInfo{
+		.sampler = m_pPyramid->GetSampler(),
+		.imageView = m_pPyramid->GetImageView(),
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+	};
+
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pCullDescriptorSet->ClearDescriptorWrites();
+		m_pCullDescriptorSet
+			->AddBufferWrite(0, drawInfos, i) // draws
+			->AddImageWrite(1, pyramidInfo, i) // pyramid
+			->AddBufferWrite(2, earlyInfos, i) // early commands
+			->AddBufferWrite(3, lateInfos, i) // late commands
+			->AddBufferWrite(4, mainInfos, i) // main commands
+			->AddBufferWrite(5, counterInfos, i) // counters
+			->UpdateByIdx(i);
+	}
+
+	m_pBuildDescriptorSet->ClearDescriptorWrites();
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		for (uint32_t level{ 0 }; level < m_pPyramid->GetMipLevels(); ++level)
+		{
+			const uint32_t idx = i * MAX_PYRAMID_LEVELS + level;
+
+			// level 0 reduces this frame's depth, every other level the one above it
+			const VkDescriptorImageInfo srcInfo = level == 0
+				? m_SwapChain.GetDepthImage(i)->GetImageInfo()
+				: VkDescriptorImageInfo{ m_pPyramid->GetSampler(), m_pPyramid->GetMipImageView(level - 1), VK_IMAGE_LAYOUT_GENERAL };
+			const VkDescriptorImageInfo dstInfo{ VK_NULL_HANDLE, m_pPyramid->GetMipImageView(level), VK_IMAGE_LAYOUT_GENERAL };
+
+			m_pBuildDescriptorSet
+				->AddImageWrite(0, srcInfo, idx) // source
+				->AddImageWrite(1, dstInfo, idx) // destination level
+				->UpdateByIdx(idx);
+		}
+	}
+}
+
+void cat::HiZPass::CreatePipelines()
+{
+	// CULL
+	{
+		Pipeline::PipelineInfo pipelineInfo{};
+		pipelineInfo.SetDefault();
+		pipelineInfo.pushConstantRanges = VkPushConstantRange{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(CullPushConstants)
+		};
+		pipelineInfo.CreatePipelineLayout(m_Device, {
+			m_FrameConstants.GetDescriptorSetLayout(),
+			m_pCullDescriptorSetLayout->GetDescriptorSetLayout()
+		});
+
+		m_pCullPipeline = std::make_unique<Pipeline>(m_Device, m_CullPath, pipelineInfo);
+	}
+
+	// BUILD
+	{
+		Pipeline::PipelineInfo pipelineInfo{};
+		pipelineInfo.SetDefault();
+		pipelineInfo.pushConstantRanges = VkPushConstantRange{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(BuildPushConstants)
+		};
+		pipelineInfo.CreatePipelineLayout(m_Device, { m_pBuildDescriptorSetLayout->GetDescriptorSetLayout() });
+
+		m_pBuildPipeline = std::make_unique<Pipeline>(m_Device, m_BuildPath, pipelineInfo);
+	}
+}
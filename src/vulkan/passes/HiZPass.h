@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../Pipeline.h"
+#include "../RenderGraph.h"
+#include "../buffers/FrameConstants.h"
+
+#include "../scene/Scene.h"
+
+namespace cat
+{
+	// Hi-Z occlusion culling of the opaque draw items, in two phases around the depth prepass:
+	//	- early: frustum test and a test against last frame's depth pyramid with last frame's view-projection,
+	//	  the survivors are drawn by the depth prepass,
+	//	- build: the min/max pyramid is rebuilt from that depth,
+	//	- late: the second chance for the draws the early test rejected, tested against the new pyramid.
+	//	  The ones that became visible (disocclusion) are added to the depth by a second prepass.
+	// Every opaque draw item owns one indirect command per list, culled draws keep an instance count of 0.
+	// The draw & command buffers double when the scene has more opaque draws than they hold.
+	class HiZPass final
+	{
+	public:
+		static constexpr uint32_t INITIAL_DRAW_CAPACITY = 1024;
+		static constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+		static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32G32_SFLOAT; // r = min, g = max depth
+
+		// visible draws of the last finished frame in this slot, read back from the GPU
+		struct Stats
+		{
+			uint32_t drawCount = 0;
+			uint32_t earlyVisible = 0;
+			uint32_t lateVisible = 0;
+		};
+
+		// CTOR & DTOR
+		//------------------------------
+		HiZPass(Device& device, const FrameConstants& frameConstants, SwapChain& swapChain, uint32_t framesInFlight);
+		~HiZPass();
+
+		HiZPass(const HiZPass&) = delete;
+		HiZPass& operator=(const HiZPass&) = delete;
+		HiZPass(HiZPass&&) = delete;
+		HiZPass& operator=(HiZPass&&) = delete;
+
+
+		// METHODS
+		//------------------------------
+		// copies the bounds of the opaque draws into this frame's buffer, call after the frame's fence & before AddCullToGraph.
+		// returns true when the buffers grew, the render graph has to forget the old ones
+		bool UpdateDraws(uint32_t frameIndex, const Scene& scene);
+		// early cull, has to be added before the depth prepass
+		void AddCullToGraph(RenderGraph& graph, uint32_t frameIndex);
+		// pyramid of the early depth & the late cull, has to be added between the early & late depth prepass
+		void AddBuildToGraph(RenderGraph& graph, uint32_t frameIndex, Image& depthImage);
+
+		// recreates the pyramid for the new depth size, the next early cull only does frustum culling
+		void Resize(VkExtent2D size);
+
+		// Getters & Setters
+		VkBuffer GetEarlyCommands(uint32_t frameIndex) const { return m_pEarlyCommands[frameIndex]->GetBuffer(); }	// depth prepass
+		VkBuffer GetLateCommands(uint32_t frameIndex) const { return m_pLateCommands[frameIndex]->GetBuffer(); }	// late depth prepass
+		VkBuffer GetMainCommands(uint32_t frameIndex) const { return m_pMainCommands[frameIndex]->GetBuffer(); }	// early + late, geometry pass
+		const Stats& GetStats() const { return m_Stats; }
+		void ToggleOcclusionCulling();
+		void SetOcclusionCulling(bool useOcclusion) { m_UseOcclusion = useOcclusion; }
+
+	private:
+		// Private methods
+		//------------------------------
+		void CreatePyramid(VkExtent2D depthSize);
+		void CreateDrawBuffers();
+		void CreateCounters();
+		void CreateDescriptors();
+		void UpdateDescriptors();
+		void CreatePipelines();
+
+		// Private members
+		//------------------------------
+		struct alignas(16) CullDraw
+		{
+			glm::vec4 boundsMin;		// world space
+			glm::vec4 boundsMax;
+			uint32_t elementCount;		// indices, or vertices for a mesh without indices
+			uint32_t padding[3]{};
+		};
+
+		struct CullPushConstants
+		{
+			glm::mat4 pyramidViewProj;	// the view-projection the pyramid was built with
+			glm::vec2 pyramidSize;
+			uint32_t drawCount;
+			uint32_t phase;				// 0 = early, 1 = late
+			uint32_t useOcclusion;		// 0 while the pyramid holds no depth yet or when toggled off
+		};
+
+		struct BuildPushConstants
+		{
+			glm::ivec2 srcSize;
+			glm::ivec2 dstSize;
+			uint32_t isDepth;			// level 0 reads the single channel depth
+		};
+
+		struct Counters
+		{
+			uint32_t earlyVisible;
+			uint32_t lateVisible;
+		};
+
+		// the push constants are filled while the graph is built, the record functions run later
+		void RecordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, CullPushConstants pushConstants) const;
+		void RecordBuild(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+		void ReadStats(uint32_t frameIndex);
+
+		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
+		SwapChain& m_SwapChain;
+		uint32_t m_FramesInFlight;
+
+		std::string m_CullPath = "shaders/hiz_cull.comp.spv";
+		std::string m_BuildPath = "shaders/hiz_build.comp.spv";
+		std::unique_ptr<Pipeline> m_pCullPipeline;
+		std::unique_ptr<Pipeline> m_pBuildPipeline;
+
+		std::unique_ptr<DescriptorPool> m_pDescriptorPool;
+		std::unique_ptr<DescriptorSetLayout> m_pCullDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pCullDescriptorSet;
+		std::unique_ptr<DescriptorSetLayout> m_pBuildDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pBuildDescriptorSet;	// one per frame in flight & pyramid level
+
+		// one pyramid for all frames in flight, the queue runs the frames in order
+		std::unique_ptr<Image> m_pPyramid;
+		glm::mat4 m_PyramidViewProj{ 1.f };
+		bool m_IsPyramidValid = false;
+		bool m_UseOcclusion = true;
+
+		std::vector<std::unique_ptr<Buffer>> m_pDraws;		// host visible
+		std::vector<std::unique_ptr<Buffer>> m_pEarlyCommands;
+		std::vector<std::unique_ptr<Buffer>> m_pLateCommands;
+		std::vector<std::unique_ptr<Buffer>> m_pMainCommands;
+		std::vector<std::unique_ptr<Buffer>> m_pCounters;
+		std::vector<uint32_t> m_DrawCounts;
+		std::vector<CullDraw> m_CullDraws;	// staging, reused every frame
+		uint32_t m_DrawCapacity = INITIAL_DRAW_CAPACITY;
+
+		Stats m_Stats{};
+	};
+}
@@ -0,0 +1,212 @@
+#include "LightClusterPass.h"
+
+#include "../utils/DebugLabel.h"
+
+// std
+#include <algorithm>
+#include <iostream>
+
+cat::LightClusterPass::LightClusterPass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight)
+	: m_Device(device), m_FrameConstants(frameConstants), m_FramesInFlight(framesInFlight)
+{
+	m_DirtyRanges.resize(m_FramesInFlight, { 0, 0 });
+
+	CreateLightBuffers();
+	CreateClusterBuffers();
+	CreateDescriptors();
+	UpdateDescriptors();
+	CreatePipeline();
+}
+
+cat::LightClusterPass::~LightClusterPass() = default;
+
+bool cat::LightClusterPass::UpdateLights(uint32_t frameIndex, Scene& scene)
+{
+	// the fence of this frame has been waited on, so last round's overflow is final
+	ReadOverflow(frameIndex);
+
+	const auto& lights = scene.GetPointLights();
+	const uint32_t lightCount = static_cast<uint32_t>(lights.size());
+
+	// a different scene replaces every light, otherwise only what changed since the last frame
+	if (&scene != m_pUploadedScene)
+	{
+		m_pUploadedScene = &scene;
+		MarkDirty(0, lightCount);
+	}
+	else
+	{
+		const auto [first, last] = scene.GetDirtyPointLights();
+		MarkDirty(first, last);
+	}
+	scene.ClearDirtyPointLights();
+
+	bool isRecreated = false;
+	if (lightCount > m_LightCapacity)
+	{
+		// the other frames in flight still read their buffers
+		vkDeviceWaitIdle(m_Device.GetDevice());
+
+		while (m_LightCapacity < lightCount) m_LightCapacity *= 2;
+		CreateLightBuffers();
+		UpdateDescriptors();
+
+		std::fill(m_DirtyRanges.begin(), m_DirtyRanges.end(), std::pair<uint32_t, uint32_t>{ 0, lightCount });
+		isRecreated = true;
+	}
+
+	// lights past the count are never read, so removed lights need no write
+	auto& [first, last] = m_DirtyRanges[frameIndex];
+	last = std::min(last, lightCount);
+	if (first < last)
+	{
+		vmaCopyMemoryToAllocation(m_Device.GetAllocator(), lights.data() + first, m_pLights[frameIndex]->GetAllocation(),
+			sizeof(Scene::PointLight) * first, sizeof(Scene::PointLight) * (last - first));
+	}
+	m_DirtyRanges[frameIndex] = { 0, 0 };
+
+	return isRecreated;
+}
+
+void cat::LightClusterPass::AddToGraph(RenderGraph& graph, uint32_t frameIndex) const
+{
+	// the light buffer is written by the host before the submit, which makes it visible to the GPU
+	graph.AddPass("LightCull", [this, frameIndex](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, frameIndex);
+		})
+		.WriteBuffer(GetClusterCounts(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(GetClusterIndices(frameIndex), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+		.WriteBuffer(m_pOverflowCounts[frameIndex]->GetBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+		.SetAsyncCompute();
+}
+
+
+void cat::LightClusterPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex) const
+{
+	DebugLabel::Begin(commandBuffer, "Light Cull", glm::vec4(0.9f, 0.9f, 0.2f, 1));
+
+	vkCmdFillBuffer(commandBuffer, m_pOverflowCounts[frameIndex]->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	m_pPipeline->Bind(commandBuffer);
+	m_FrameConstants.Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE);
+	m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 1, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + 63) / 64, 1, 1);
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::LightClusterPass::ReadOverflow(uint32_t frameIndex)
+{
+	vmaCopyAllocationToMemory(m_Device.GetAllocator(), m_pOverflowCounts[frameIndex]->GetAllocation(), 0, &m_OverflowClusters, sizeof(uint32_t));
+
+	// only once, the performance CSV has the count of every frame
+	if (m_OverflowClusters > 0 && !m_HasWarnedOverflow)
+	{
+		m_HasWarnedOverflow = true;
+		std::cout << m_OverflowClusters << " light clusters have more than " << CLUSTER_MAX_LIGHTS << " lights, the rest are not shaded" << std::endl;
+	}
+}
+
+void cat::LightClusterPass::MarkDirty(uint32_t first, uint32_t last)
+{
+	if (first >= last)
+		return;
+
+	for (auto& range : m_DirtyRanges)
+	{
+		if (range.first >= range.second)
+			range = { first, last };
+		else
+			range = { std::min(range.first, first), std::max(range.second, last) };
+	}
+}
+
+
+void cat::LightClusterPass::CreateLightBuffers()
+{
+	m_pLights.clear();
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pLights.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(Scene::PointLight) * m_LightCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, true }));
+	}
+}
+
+void cat::LightClusterPass::CreateClusterBuffers()
+{
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pClusterCounts.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(uint32_t) * CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, false }));
+		m_pClusterIndices.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(uint32_t) * CLUSTER_COUNT * CLUSTER_MAX_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, false }));
+
+		m_pOverflowCounts.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO, true }));
+		uint32_t overflow{ 0 };
+		m_pOverflowCounts.back()->WriteToBuffer(&overflow);
+	}
+}
+
+void cat::LightClusterPass::CreateDescriptors()
+{
+	m_pDescriptorPool = std::make_unique<DescriptorPool>(m_Device);
+	m_pDescriptorPool
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_FramesInFlight * 4)
+		->Create(m_FramesInFlight);
+
+	m_pDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+	m_pDescriptorSetLayout
+		->AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		->AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		->AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		->Create();
+
+	m_pDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
+}
+
+void cat::LightClusterPass::UpdateDescriptors()
+{
+	std::vector<VkDescriptorBufferInfo> lightInfos, countInfos, indexInfos, overflowInfos;
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		lightInfos.push_back(GetLightsInfo(i));
+		countInfos.push_back(GetClusterCountsInfo(i));
+		indexInfos.push_back(GetClusterIndicesInfo(i));
+		overflowInfos.push_back(m_pOverflowCounts[i]->GetDescriptorBufferInfo());
+	}
+
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pDescriptorSet->ClearDescriptorWrites();
+		m_pDescriptorSet
+			->AddBufferWrite(0, lightInfos, i) // point lights
+			->AddBufferWrite(1, countInfos, i) // cluster light counts
+			->AddBufferWrite(2, indexInfos, i) // cluster light indices
+			->AddBufferWrite(3, overflowInfos, i) // overflowing clusters
+			->UpdateByIdx(i);
+	}
+}
+
+void cat::LightClusterPass::CreatePipeline()
+{
+	Pipeline::PipelineInfo pipelineInfo{};
+	pipelineInfo.SetDefault();
+	pipelineInfo.CreatePipelineLayout(m_Device, {
+		m_FrameConstants.GetDescriptorSetLayout(),
+		m_pDescriptorSetLayout->GetDescriptorSetLayout()
+	});
+
+	m_pPipeline = std::make_unique<Pipeline>(m_Device, m_CullPath, pipelineInfo);
+}
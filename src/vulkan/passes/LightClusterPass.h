@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../Pipeline.h"
+#include "../RenderGraph.h"
+#include "../buffers/FrameConstants.h"
+
+#include "../scene/Scene.h"
+
+// std
+#include <utility>
+
+namespace cat
+{
+	// Bins the point lights into a camera aligned 3D grid of clusters, the lighting pass then only shades
+	// the lights of its pixel's cluster instead of every light in the scene.
+	//	- every frame in flight owns a host visible copy of the scene's lights, only the ranges the scene
+	//	  marked dirty are written, the buffers double when the lights no longer fit,
+	//	- LightCull writes the light count & index list of every cluster & counts the clusters that had more
+	//	  lights than slots, those lights are dropped.
+	// See shaders/clusters.glsl for the grid, the constants below have to match it.
+	class LightClusterPass final
+	{
+	public:
+		static constexpr VkExtent3D CLUSTER_GRID{ 16, 9, 24 };
+		static constexpr uint32_t CLUSTER_COUNT = CLUSTER_GRID.width * CLUSTER_GRID.height * CLUSTER_GRID.depth;
+		static constexpr uint32_t CLUSTER_MAX_LIGHTS = 256;	// index slots per cluster
+		static constexpr uint32_t INITIAL_LIGHT_CAPACITY = 256;
+
+		// CTOR & DTOR
+		//------------------------------
+		LightClusterPass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight);
+		~LightClusterPass();
+
+		LightClusterPass(const LightClusterPass&) = delete;
+		LightClusterPass& operator=(const LightClusterPass&) = delete;
+		LightClusterPass(LightClusterPass&&) = delete;
+		LightClusterPass& operator=(LightClusterPass&&) = delete;
+
+
+		// METHODS
+		//------------------------------
+		// copies the dirty lights into this frame's buffer & reads back the overflow of the frame's last round,
+		// call after the frame's fence & before AddToGraph.
+		// returns true when the light buffers were recreated, the readers have to update their descriptors
+		bool UpdateLights(uint32_t frameIndex, Scene& scene);
+		// has to be added before the lighting pass
+		void AddToGraph(RenderGraph& graph, uint32_t frameIndex) const;
+
+		// Getters & Setters
+		VkDescriptorBufferInfo GetLightsInfo(uint32_t frameIndex) const { return m_pLights[frameIndex]->GetDescriptorBufferInfo(); }
+		VkDescriptorBufferInfo GetClusterCountsInfo(uint32_t frameIndex) const { return m_pClusterCounts[frameIndex]->GetDescriptorBufferInfo(); }
+		VkDescriptorBufferInfo GetClusterIndicesInfo(uint32_t frameIndex) const { return m_pClusterIndices[frameIndex]->GetDescriptorBufferInfo(); }
+		VkBuffer GetClusterCounts(uint32_t frameIndex) const { return m_pClusterCounts[frameIndex]->GetBuffer(); }
+		VkBuffer GetClusterIndices(uint32_t frameIndex) const { return m_pClusterIndices[frameIndex]->GetBuffer(); }
+		// clusters of the last finished frame in this slot that dropped lights
+		uint32_t GetOverflowClusters() const { return m_OverflowClusters; }
+
+	private:
+		// Private methods
+		//------------------------------
+		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+		void ReadOverflow(uint32_t frameIndex);
+		void CreateLightBuffers();
+		void CreateClusterBuffers();
+		void CreateDescriptors();
+		void UpdateDescriptors();
+		void CreatePipeline();
+
+		// marks [first, last) dirty in every frame's copy
+		void MarkDirty(uint32_t first, uint32_t last);
+
+		// Private members
+		//------------------------------
+		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
+		uint32_t m_FramesInFlight;
+
+		std::string m_CullPath = "shaders/light_cull.comp.spv";
+		std::unique_ptr<Pipeline> m_pPipeline;
+
+		std::unique_ptr<DescriptorPool> m_pDescriptorPool;
+		std::unique_ptr<DescriptorSetLayout> m_pDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pDescriptorSet;
+
+		std::vector<std::unique_ptr<Buffer>> m_pLights;
+		std::vector<std::unique_ptr<Buffer>> m_pClusterCounts;
+		std::vector<std::unique_ptr<Buffer>> m_pClusterIndices;
+		std::vector<std::unique_ptr<Buffer>> m_pOverflowCounts;	// host visible, cleared by LightCull
+		uint32_t m_OverflowClusters = 0;
+		bool m_HasWarnedOverflow = false;
+
+		uint32_t m_LightCapacity = INITIAL_LIGHT_CAPACITY;
+		// lights [first, second) of every frame's copy that still have to be written, empty when first >= second
+		std::vector<std::pair<uint32_t, uint32_t>> m_DirtyRanges;
+		const Scene* m_pUploadedScene = nullptr;
+	};
+}
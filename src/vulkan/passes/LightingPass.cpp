@@ -3,23 +3,10 @@
 #include "ShadowPass.h"
 #include "../utils/DebugLabel.h"
 
-cat::LightingPass::LightingPass(Device& device, VkExtent2D extent, uint32_t framesInFlight, const GeometryPass& geometryPass, HDRImage* pSkyBoxImage, SwapChain& swapchain, const ShadowPass& shadowPass)
-	: m_Device(device), m_FramesInFlight(framesInFlight), m_Extent(extent), m_GeometryPass(geometryPass), m_pSkyBoxImage(pSkyBoxImage), m_SwapChain(swapchain), m_ShadowPass(shadowPass)
+cat::LightingPass::LightingPass(Device& device, RingBuffer& ringBuffer, const FrameConstants& frameConstants, TransientImageAllocator& transientImages, VkExtent2D extent, uint32_t framesInFlight, const GeometryPass& geometryPass, HDRImage* pSkyBoxImage, SwapChain& swapchain, const ShadowPass& shadowPass, const LightClusterPass& lightClusterPass)
+	: m_Device(device), m_RingBuffer(ringBuffer), m_FrameConstants(frameConstants), m_TransientImages(transientImages), m_FramesInFlight(framesInFlight), m_Extent(extent), m_GeometryPass(geometryPass), m_LightClusterPass(lightClusterPass), m_pSkyBoxImage(pSkyBoxImage), m_SwapChain(swapchain), m_ShadowPass(shadowPass)
 {
-	// IMAGES
-	m_pLitImages.resize(m_FramesInFlight);
-	for (int index{ 0 }; index < m_FramesInFlight; ++index){
-		m_pLitImages[index] = std::make_unique<Image>(
-			m_Device,
-			extent.width, extent.height,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VMA_MEMORY_USAGE_AUTO
-		);
-		DebugLabel::NameImage(m_pLitImages[index]->GetImage(), std::string("Lit buffer <3.") + std::to_string(index));
-	}
-
-	CreateBuffers();
+	RequestImages();
 	CreateDescriptors();
 	CreatePipeline();
 }
@@ -30,55 +17,27 @@ cat::LightingPass::~LightingPass()
 	m_pPipeline = nullptr;
 }
 
-void cat::LightingPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Camera camera, Scene& scene) const
+void cat::LightingPass::AddToGraph(RenderGraph& graph, uint32_t frameIndex, const Scene& scene) const
 {
-	Image& litImage = *m_pLitImages[frameIndex];
+	graph.AddPass("LightingPass", [this, frameIndex, &scene](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, frameIndex, scene);
+		})
+		.Read(m_GeometryPass.GetAlbedoBuffer(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(m_GeometryPass.GetNormalBuffer(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(m_GeometryPass.GetSpecularBuffer(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_SwapChain.GetDepthImage(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_ShadowPass.GetDepthImages()[frameIndex], RenderGraph::FRAGMENT_SAMPLED)
+		.ReadBuffer(m_LightClusterPass.GetClusterCounts(frameIndex), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+		.ReadBuffer(m_LightClusterPass.GetClusterIndices(frameIndex), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+		.Write(GetLitImage(frameIndex), RenderGraph::COLOR_ATTACHMENT_WRITE, true);
+}
+
+void cat::LightingPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Scene& scene) const
+{
+	Image& litImage = GetLitImage(frameIndex);
 	// BEGIN RECORDING
 	{
-		LightingUbo uboData = {
-			.lightDirection = scene.GetDirectionalLight().direction,
-			.lightColor = scene.GetDirectionalLight().color,
-			.lightIntensity = scene.GetDirectionalLight().intensity,
-			.lightViewProj = scene.GetDirectionalLight().projectionMatrix * scene.GetDirectionalLight().viewMatrix,
-
-			.cameraPosition = glm::vec4(camera.GetOrigin(),1.0),
-			.proj = camera.GetProjection(),
-			.view = camera.GetView(),
-			.viewportSize = { static_cast<float>(m_Extent.width), static_cast<float>(m_Extent.height) },
-
-			.pointLightCount = static_cast<uint32_t>(scene.GetPointLights().size())
-		};
-		m_pUniformBuffer->Update(frameIndex,uboData);
-
-		std::array<Scene::PointLight, LightingPass::MAX_POINT_LIGHTS> pointLights{};
-		const auto& sceneLights = scene.GetPointLights();
-		for (size_t i = 0; i < sceneLights.size() && i < LightingPass::MAX_POINT_LIGHTS; ++i) {
-			pointLights[i] = sceneLights[i];
-		}
-		m_pPointLightingStorageBuffer->Update(frameIndex, pointLights);
-
-
-
-		// transitioning images
-		//----------------------
-		m_SwapChain.GetDepthImage(frameIndex)->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			Image::BarrierInfo{
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT
-			});
-
-		litImage.TransitionImageLayout(commandBuffer,VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			{
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_ACCESS_NONE,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-			});
-
-
-
 		// Render Attachments
 		//---------------------
 		VkClearValue clearValue {};
@@ -126,7 +85,7 @@ void cat::LightingPass::Record(VkCommandBuffer commandBuffer, uint32_t frameInde
 		scissor.extent = m_Extent;
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		m_pUboDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 0);
+		m_FrameConstants.Bind(commandBuffer, m_pPipeline->GetPipelineLayout());
 		m_pSamplersDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 1);
 		m_pHDRISamplersDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 2);
 		m_pShadowDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 3);
@@ -139,84 +98,34 @@ void cat::LightingPass::Record(VkCommandBuffer commandBuffer, uint32_t frameInde
 	{
 		vkCmdEndRenderingKHR(commandBuffer);
 		DebugLabel::End(commandBuffer);
-
-		// transitioning images
-		//----------------------
-		m_SwapChain.GetDepthImage(frameIndex)->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			Image::BarrierInfo{
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
-			});
-
-		litImage.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			Image::BarrierInfo{
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			});
 	}
 }
 
-void cat::LightingPass::CreateBuffers()
-{
-	m_pUniformBuffer = std::make_unique<UniformBuffer<LightingUbo>>(m_Device);
-	m_pPointLightingStorageBuffer = std::make_unique<StorageBuffer<Scene::PointLight, MAX_POINT_LIGHTS>>(m_Device);
-}
-
 void cat::LightingPass::CreateDescriptors()
 {
 	m_pDescriptorPool = std::make_unique<DescriptorPool>(m_Device);
 	m_pDescriptorPool
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_FramesInFlight)
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_FramesInFlight)
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight * 5)
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_FramesInFlight * 3)
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight * 4)
 		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight * 2)
 		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight)
-		->Create(m_FramesInFlight * 4);
+		->Create(m_FramesInFlight * 3);
 
-	// UBO 
-	{
-		m_pUboDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
-		m_pUboDescriptorSetLayout
-			->AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
-			->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
-			->Create();
-
-
-		m_pUboDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pUboDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
-		m_pUboDescriptorSet
-			->AddBufferWrite(0, m_pUniformBuffer->GetDescriptorBufferInfos())
-			->AddBufferWrite(1, m_pPointLightingStorageBuffer->GetDescriptorBufferInfos())
-			->UpdateAll();
-	}
-
-	// SAMPLERS
+	// POINT LIGHTS & SAMPLERS
 	{
 		m_pSamplersDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
 		m_pSamplersDescriptorSetLayout
-			->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			->AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
 			->AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
 			->AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
 			->AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
 			->AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			->AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			->AddBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
 			->Create();
 
 		m_pSamplersDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pSamplersDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
-
-		for (int i = 0; i < m_pSamplersDescriptorSet->GetDescriptorSetCount(); ++i)
-		{
-
-			m_pSamplersDescriptorSet
-				->AddImageWrite(0, m_GeometryPass.GetAlbedoBuffer(i).GetImageInfo(), i) // albedo
-				->AddImageWrite(1, m_GeometryPass.GetNormalBuffer(i).GetImageInfo(), i) // normal
-				->AddImageWrite(2, m_GeometryPass.GetSpecularBuffer(i).GetImageInfo(), i) // specular
-				->AddImageWrite(3, m_GeometryPass.GetWorldBuffer(i).GetImageInfo(), i) // world
-				->AddImageWrite(4, m_SwapChain.GetDepthImage(i)->GetImageInfo(), i) // depth
-				->UpdateByIdx(i);
-		}
+		// written in UpdateDescriptors, once the G-buffer has memory
 	}
 
 	// HDRI 
@@ -271,7 +180,7 @@ void cat::LightingPass::CreatePipeline()
 
 	// attachments
 	pipelineInfo.colorAttachments = {
-		m_pLitImages[0]->GetFormat()
+		LIT_FORMAT
 	};
 	pipelineInfo.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
 
@@ -285,7 +194,7 @@ void cat::LightingPass::CreatePipeline()
 	pipelineInfo.vertexBindingDescriptions = {};
 
 	pipelineInfo.CreatePipelineLayout(m_Device, { 
-		m_pUboDescriptorSetLayout->GetDescriptorSetLayout(),
+		m_FrameConstants.GetDescriptorSetLayout(),
 		m_pSamplersDescriptorSetLayout->GetDescriptorSetLayout(),
 		m_pHDRISamplersDescriptorSetLayout->GetDescriptorSetLayout(),
 		m_pShadowDescriptorSetLayout->GetDescriptorSetLayout()
@@ -304,62 +213,50 @@ void cat::LightingPass::CreatePipeline()
 }
 
 
-void cat::LightingPass::Resize(VkExtent2D size, const GeometryPass& geometryPass)
+void cat::LightingPass::Resize(VkExtent2D size)
 {
 	m_Extent = size;
+	RequestImages();
+}
 
-	VkFormat litFormat = m_pLitImages[0]->GetFormat();
-
-	m_pLitImages.clear();
-	m_pLitImages.resize(m_FramesInFlight);
-
-	for (uint32_t i = 0; i < m_FramesInFlight; ++i)
+void cat::LightingPass::UpdateDescriptors()
+{
+	std::vector<VkDescriptorBufferInfo> lightInfos, countInfos, indexInfos;
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; i++)
 	{
-		m_pLitImages[i] = std::make_unique<Image>(
-			m_Device,
-			m_Extent.width, m_Extent.height,
-			litFormat,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VMA_MEMORY_USAGE_AUTO
-		);
-		DebugLabel::NameImage(m_pLitImages[i]->GetImage(), std::string("Lit buffer <3.") + std::to_string(i));
+		lightInfos.push_back(m_LightClusterPass.GetLightsInfo(i));
+		countInfos.push_back(m_LightClusterPass.GetClusterCountsInfo(i));
+		indexInfos.push_back(m_LightClusterPass.GetClusterIndicesInfo(i));
 	}
 
-	for (size_t i{ 0 }; i < m_FramesInFlight; i++)
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; i++)
 	{
-		VkDescriptorImageInfo imageInfo = geometryPass.GetAlbedoBuffer(i).GetImageInfo();
-
 		m_pSamplersDescriptorSet->ClearDescriptorWrites();
 		m_pSamplersDescriptorSet
-			->AddImageWrite(0, geometryPass.GetAlbedoBuffer(i).GetImageInfo(), i) // albedo
-			->AddImageWrite(1, geometryPass.GetNormalBuffer(i).GetImageInfo(), i) // normal
-			->AddImageWrite(2, geometryPass.GetSpecularBuffer(i).GetImageInfo(), i) // specular
-			->AddImageWrite(3, geometryPass.GetWorldBuffer(i).GetImageInfo(), i) // world
-			->AddImageWrite(4, m_SwapChain.GetDepthImage(i)->GetImageInfo(), i) // depth()
-			->UpdateByIdx(i);
-
-
-
-		VkDescriptorImageInfo cubemapInfo{};
-		cubemapInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		cubemapInfo.imageView = m_pSkyBoxImage->GetCubeMapImageView();
-		cubemapInfo.sampler = m_pSkyBoxImage->GetCubeMapSampler();
-
-		VkDescriptorImageInfo irradianceInfo{};
-		irradianceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		irradianceInfo.imageView = m_pSkyBoxImage->GetIrradianceMapImageView();
-		irradianceInfo.sampler = m_pSkyBoxImage->GetIrradianceMapSampler();
-
-		m_pHDRISamplersDescriptorSet->ClearDescriptorWrites();
-		m_pHDRISamplersDescriptorSet
-			->AddImageWrite(0, cubemapInfo, i) // skybox
-			->AddImageWrite(1, irradianceInfo, i) // irradiance
+			->AddBufferWrite(0, lightInfos, i) // point lights
+			->AddImageWrite(1, m_GeometryPass.GetAlbedoBuffer(i).GetImageInfo(), i) // albedo
+			->AddImageWrite(2, m_GeometryPass.GetNormalBuffer(i).GetImageInfo(), i) // normal
+			->AddImageWrite(3, m_GeometryPass.GetSpecularBuffer(i).GetImageInfo(), i) // specular
+			->AddImageWrite(4, m_SwapChain.GetDepthImage(i)->GetImageInfo(), i) // depth
+			->AddBufferWrite(5, countInfos, i) // cluster light counts
+			->AddBufferWrite(6, indexInfos, i) // cluster light indices
 			->UpdateByIdx(i);
+	}
+}
 
-
-		m_pShadowDescriptorSet->ClearDescriptorWrites();
-		m_pShadowDescriptorSet
-			->AddImageWrite(0, m_ShadowPass.GetDepthImages()[i]->GetImageInfo(), i) // shadow map
-			->UpdateByIdx(i);
+void cat::LightingPass::RequestImages()
+{
+	m_LitImages.clear();
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_LitImages.push_back(m_TransientImages.Request({
+			.name = std::string("Lit buffer <3.") + std::to_string(i),
+			.extent = m_Extent,
+			.format = LIT_FORMAT,
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			.frameIndex = i,
+			.firstPass = PassOrder::LightingPass,
+			.lastPass = PassOrder::VolumetricPass
+		}));
 	}
 }
@@ -2,9 +2,12 @@
 #include "../scene/Scene.h"
 #include "../scene/Camera.h"
 
-#include "../buffers/StorageBuffer.h"
+#include "../buffers/FrameConstants.h"
+#include "../RenderGraph.h"
+#include "../TransientImageAllocator.h"
 
 #include "GeometryPass.h"
+#include "LightClusterPass.h"
 #include "ShadowPass.h"
 
 namespace cat
@@ -12,12 +15,12 @@ namespace cat
 	class LightingPass final
 	{
 	public:
-		static constexpr size_t MAX_POINT_LIGHTS = 16;
+		static constexpr VkFormat LIT_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
 
 		// CTOR & DTOR
 		//----------------
-		LightingPass(Device& device, VkExtent2D extent, uint32_t framesInFlight, const GeometryPass& geometryPass,
-		             HDRImage* pSkyBoxImage, SwapChain& swapchain, const ShadowPass& shadowPass);
+		LightingPass(Device& device, RingBuffer& ringBuffer, const FrameConstants& frameConstants, TransientImageAllocator& transientImages, VkExtent2D extent, uint32_t framesInFlight, const GeometryPass& geometryPass,
+		             HDRImage* pSkyBoxImage, SwapChain& swapchain, const ShadowPass& shadowPass, const LightClusterPass& lightClusterPass);
 		~LightingPass();
 
 		LightingPass(const LightingPass&) = delete;
@@ -27,57 +30,44 @@ namespace cat
 
 		// METHODS
 		//-----------------
-		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
-		            Camera camera, Scene& scene) const;
-		void Resize(VkExtent2D size, const GeometryPass& geometryPass);
+		// samples the G-buffer, depth & shadow map, shades the point lights of every pixel's cluster and writes this frame's lit image
+		void AddToGraph(RenderGraph& graph, uint32_t frameIndex, const Scene& scene) const;
+		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Scene& scene) const;
+		// requests the lit images at the new size, the transient images have to be cleared before & allocated after
+		void Resize(VkExtent2D size);
+		// points the samplers at the current G-buffer & depth, call after every transient allocation
+		// and whenever the light cluster pass recreated its light buffers
+		void UpdateDescriptors();
 
 		// Getters & Setters
-		const std::vector<std::unique_ptr<Image>>& GetLitImages() const { return m_pLitImages; }
+		Image& GetLitImage(uint32_t idx) const { return m_TransientImages.GetImage(m_LitImages[idx]); }
 
 	private:
 		// PRIVATE METHODS
 		//-----------------
-		void CreateBuffers();
+		void RequestImages();
 		void CreateDescriptors();
 		void CreatePipeline();
 
 		// PRIVATE MEMBERS
 		//-----------------
 		Device& m_Device;
+		RingBuffer& m_RingBuffer;
+		const FrameConstants& m_FrameConstants;
+		TransientImageAllocator& m_TransientImages;
 		SwapChain& m_SwapChain;
 		uint32_t m_FramesInFlight;
 		VkExtent2D m_Extent;
 		const ShadowPass& m_ShadowPass;
 		const GeometryPass& m_GeometryPass;
+		const LightClusterPass& m_LightClusterPass;
 
 
-		struct alignas(16) LightingUbo
-		{
-			glm::vec3 lightDirection;
-			const float padding{};
-			glm::vec3 lightColor = { 1.f, 1.f, 1.f };
-			float lightIntensity;
-			glm::mat4 lightViewProj = glm::mat4(1.0f);
-
-			glm::vec4 cameraPosition;
-			glm::mat4 proj;
-			glm::mat4 view;
-			glm::vec2 viewportSize;
-			float padding1[2]{};
-
-			uint32_t pointLightCount;
-			float padding2[3]{};
-		};
-		std::unique_ptr<UniformBuffer<LightingUbo>> m_pUniformBuffer;
-		std::unique_ptr<StorageBuffer<Scene::PointLight, MAX_POINT_LIGHTS>> m_pPointLightingStorageBuffer;
-
 		std::unique_ptr<DescriptorPool> m_pDescriptorPool;
-		std::unique_ptr<DescriptorSetLayout> m_pUboDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> m_pSamplersDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> m_pHDRISamplersDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> m_pShadowDescriptorSetLayout;
 
-		std::unique_ptr<DescriptorSet> m_pUboDescriptorSet;
 		std::unique_ptr<DescriptorSet> m_pSamplersDescriptorSet;
 		std::unique_ptr<DescriptorSet> m_pHDRISamplersDescriptorSet;
 		std::unique_ptr<DescriptorSet> m_pShadowDescriptorSet;
@@ -86,7 +76,7 @@ namespace cat
 		std::string m_FragPath = "shaders/lighting.frag.spv";
 		Pipeline* m_pPipeline;
 
-		std::vector<std::unique_ptr<Image>> m_pLitImages;
+		std::vector<TransientImageAllocator::ImageHandle> m_LitImages;
 		HDRImage* m_pSkyBoxImage;
 
 	};
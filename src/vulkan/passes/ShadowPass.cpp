@@ -1,58 +1,137 @@
 #include "ShadowPass.h"
 #include "../utils/DebugLabel.h"
 
-cat::ShadowPass::ShadowPass(Device& device, uint32_t framesInFlight)
-	: m_Device(device), m_FramesInFlight(framesInFlight)
+// std
+#include <algorithm>
+
+cat::ShadowPass::ShadowPass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight, uint32_t resolution)
+	: m_Device(device), m_FrameConstants(frameConstants), m_FramesInFlight(framesInFlight), m_Resolution(resolution)
 {
 	// IMAGES
 	m_pDepthImages.resize(m_FramesInFlight);
 	for (int index{ 0 }; index < m_FramesInFlight; ++index) {
 		m_pDepthImages[index] = std::make_unique<Image>(
 			m_Device,
-			2048, 2048,
+			m_Resolution, m_Resolution,
 			VK_FORMAT_D32_SFLOAT,
+			CASCADE_COUNT,
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			VMA_MEMORY_USAGE_AUTO
 		);
-		DebugLabel::NameImage(m_pDepthImages[index]->GetImage(), std::string("Depth Image - Directional light POV <") + std::to_string(index));
+		m_pDepthImages[index]->SetName(std::string("Depth Image - Directional light cascades <") + std::to_string(index));
 	}
+	m_Cache.resize(m_FramesInFlight);
+	m_PyramidValidMasks.resize(m_FramesInFlight, 0);
 
-	CreateUniformBuffers();
+	CreatePyramids();
 	CreateDescriptors();
 	CreatePipeline();
 }
 
 cat::ShadowPass::~ShadowPass()
 {
-	delete m_pDescriptorSet;
-	m_pDescriptorSet = nullptr;
-	delete m_pDescriptorSetLayout;
-	m_pDescriptorSetLayout = nullptr;
-	delete m_pDescriptorPool;
-	m_pDescriptorPool = nullptr;
-
 	delete m_pPipeline;
 }
 
-void cat::ShadowPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Scene& scene) const
+void cat::ShadowPass::AddToGraph(RenderGraph& graph, ParallelRecorder& recorder, uint32_t frameIndex, const Scene& scene)
 {
-	// BEGIN RECORDING
+	InvalidateCache(scene);
+
+	const auto& light = scene.GetDirectionalLight();
+	std::array<bool, CASCADE_COUNT> isStale{};
+	uint32_t staleMask = 0;
+	m_RedrawnCascadeCount = 0;
+	m_CasterStats = {};
+	for (uint32_t cascade{ 0 }; cascade < CASCADE_COUNT; ++cascade)
+	{
+		const CachedCascade& cached = m_Cache[frameIndex][cascade];
+		isStale[cascade] = !m_UseCache || !cached.isValid || cached.viewProj != light.cascadeViewProj[cascade];
+		m_RedrawnCascadeCount += isStale[cascade];
+		staleMask |= isStale[cascade] ? 1u << cascade : 0u;
+	}
+	m_PyramidValidMasks[frameIndex] &= ~staleMask;
+
+	// every layer of this frame in flight is still valid, the readers sample the cached map
+	if (m_RedrawnCascadeCount == 0)
+	{
+		AddPyramidToGraph(graph, frameIndex);
+		return;
+	}
+
+	// the layers that are kept have to survive the transition
+	const bool discard = m_RedrawnCascadeCount == CASCADE_COUNT;
+
+	graph.AddPass("ShadowPass", [this, frameIndex, isStale](VkCommandBuffer commandBuffer)
+		{
+			for (uint32_t cascade{ 0 }; cascade < CASCADE_COUNT; ++cascade)
+			{
+				if (isStale[cascade])
+					Record(commandBuffer, frameIndex, cascade, m_Draws[cascade]);
+			}
+		})
+		.Write(*m_pDepthImages[frameIndex], RenderGraph::DEPTH_ATTACHMENT_WRITE, discard)
+		.Prepare([this, &recorder, frameIndex, &scene, isStale]
+		{
+			const auto& light = scene.GetDirectionalLight();
+			for (uint32_t cascade{ 0 }; cascade < CASCADE_COUNT; ++cascade)
+			{
+				if (!isStale[cascade])
+					continue;
+
+				CullCascade(cascade, scene);
+				m_Draws[cascade] = RecordDraws(recorder, frameIndex, cascade, scene, m_CascadeDrawItems[cascade]);
+				m_Cache[frameIndex][cascade] = { light.cascadeViewProj[cascade], true };
+			}
+		});
+
+	AddPyramidToGraph(graph, frameIndex);
+}
+
+void cat::ShadowPass::AddPyramidToGraph(RenderGraph& graph, uint32_t frameIndex)
+{
+	constexpr uint32_t allLayers = (1u << CASCADE_COUNT) - 1;
+	const uint32_t layerMask = ~m_PyramidValidMasks[frameIndex] & allLayers;
+	if (layerMask == 0)
+		return;
+
+	// culled while nothing marches, the layers are then reduced once a reader comes back
+	graph.AddPass("ShadowPyramid", [this, frameIndex, layerMask](VkCommandBuffer commandBuffer)
+		{
+			RecordPyramid(commandBuffer, frameIndex, layerMask);
+		})
+		.Read(*m_pDepthImages[frameIndex], RenderGraph::COMPUTE_SAMPLED)
+		.Write(*m_pPyramids[frameIndex], RenderGraph::COMPUTE_STORAGE_WRITE, layerMask == allLayers)
+		.Prepare([this, frameIndex, layerMask]
+		{
+			m_PyramidValidMasks[frameIndex] |= layerMask;
+		})
+		.SetAsyncCompute();
+}
+
+cat::ParallelRecorder::Batch cat::ShadowPass::RecordDraws(ParallelRecorder& recorder, uint32_t frameIndex, uint32_t cascade, const Scene& scene,
+	const std::vector<Scene::DrawItem>& drawItems) const
+{
+	std::vector<ParallelRecorder::RecordFunction> chunks;
+	for (const auto& range : ParallelRecorder::Split(drawItems.size(), recorder.GetThreadCount()))
 	{
-		ShadowUbo uboData = {  scene.GetDirectionalLight().projectionMatrix,scene.GetDirectionalLight().viewMatrix };
-		m_pUniformBuffer->Update(frameIndex, uboData);
-
-		m_pDepthImages[frameIndex]->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			Image::BarrierInfo{
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-				VK_ACCESS_NONE,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		chunks.emplace_back([this, frameIndex, cascade, &scene, &drawItems, range](VkCommandBuffer commandBuffer)
+			{
+				RecordDrawChunk(commandBuffer, frameIndex, cascade, scene,
+					std::span(drawItems).subspan(range.first, range.count));
 			});
+	}
 
+	return recorder.Record({ {}, VK_FORMAT_D32_SFLOAT }, std::move(chunks));
+}
+
+void cat::ShadowPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t cascade, ParallelRecorder::Batch& draws) const
+{
+	// BEGIN RECORDING
+	{
 		// Render Attachments
 		VkRenderingAttachmentInfoKHR depthAttachmentInfo{};
 		depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
-		depthAttachmentInfo.imageView = m_pDepthImages[frameIndex]->GetImageView();
+		depthAttachmentInfo.imageView = m_pDepthImages[frameIndex]->GetLayerImageView(cascade);
 		depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -61,76 +140,198 @@ void cat::ShadowPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
 		// Render Info
 		VkRenderingInfoKHR renderInfo{};
 		renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
 		renderInfo.renderArea = { {0, 0}, m_pDepthImages[frameIndex]->GetExtent() };
 		renderInfo.layerCount = 1;
 		renderInfo.colorAttachmentCount = 0;
 		renderInfo.pColorAttachments = nullptr;
 		renderInfo.pDepthAttachment = &depthAttachmentInfo;
-		DebugLabel::Begin(commandBuffer, "Shadow Pass", glm::vec4(0.7f, 0.1f, 0.5f, 1));
+		DebugLabel::Begin(commandBuffer, "Shadow Pass - Cascade " + std::to_string(cascade), glm::vec4(0.7f, 0.1f, 0.5f, 1));
 		vkCmdBeginRenderingKHR(commandBuffer, &renderInfo);
 	}
 
 	// Drawing
 	{
-		m_pPipeline->Bind(commandBuffer);
-
-		// viewport
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(m_pDepthImages[frameIndex]->GetExtent().width);
-		viewport.height = static_cast<float>(m_pDepthImages[frameIndex]->GetExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-		// scissor
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = m_pDepthImages[frameIndex]->GetExtent();
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-		m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex);
-
-		// draw the scene
-		scene.DrawOpaque(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, true);
+		ParallelRecorder::Execute(commandBuffer, draws);
 	}
 
 	// END RECORDING
 	{
 		vkCmdEndRenderingKHR(commandBuffer);
 		DebugLabel::End(commandBuffer);
-		m_pDepthImages[frameIndex]->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			Image::BarrierInfo{
-				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,   
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-				 VK_ACCESS_SHADER_READ_BIT
-			});
 	}
 }
 
-void cat::ShadowPass::CreateUniformBuffers()
+void cat::ShadowPass::RecordPyramid(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t layerMask) const
 {
-	m_pUniformBuffer = std::make_unique<UniformBuffer<ShadowUbo>>(m_Device);
+	DebugLabel::Begin(commandBuffer, "Shadow Pyramid", glm::vec4(0.3f, 0.3f, 0.3f, 1));
+
+	m_pPyramidPipeline->Bind(commandBuffer);
+
+	const Image& pyramid = *m_pPyramids[frameIndex];
+	VkExtent2D srcSize{ m_Resolution, m_Resolution };
+	for (uint32_t level{ 0 }; level < pyramid.GetMipLevels(); ++level)
+	{
+		if (level > 0)
+		{
+			// the previous level has to be written before it is reduced
+			VkMemoryBarrier levelBarrier{};
+			levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &levelBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const VkExtent2D dstSize{
+			std::max(pyramid.GetExtent().width >> level, 1u),
+			std::max(pyramid.GetExtent().height >> level, 1u)
+		};
+
+		m_pPyramidDescriptorSet->Bind(commandBuffer, m_pPyramidPipeline->GetPipelineLayout(), frameIndex * MAX_PYRAMID_LEVELS + level, 0, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+		PyramidPushConstants pushConstants{};
+		pushConstants.srcSize = { static_cast<int>(srcSize.width), static_cast<int>(srcSize.height) };
+		pushConstants.dstSize = { static_cast<int>(dstSize.width), static_cast<int>(dstSize.height) };
+		pushConstants.isDepth = level == 0 ? 1u : 0u;
+		pushConstants.layerMask = layerMask;
+		vkCmdPushConstants(commandBuffer, m_pPyramidPipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidPushConstants), &pushConstants);
+
+		vkCmdDispatch(commandBuffer, (dstSize.width + 7) / 8, (dstSize.height + 7) / 8, CASCADE_COUNT);
+		srcSize = dstSize;
+	}
+
+	DebugLabel::End(commandBuffer);
 }
 
-void cat::ShadowPass::CreateDescriptors()
+void cat::ShadowPass::RecordDrawChunk(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t cascade, const Scene& scene,
+	std::span<const Scene::DrawItem> drawItems) const
 {
-	m_pDescriptorPool = new DescriptorPool(m_Device);
-	m_pDescriptorPool
-		->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, cat::MAX_FRAMES_IN_FLIGHT)
-		->Create(m_FramesInFlight);
+	m_pPipeline->Bind(commandBuffer);
 
-	m_pDescriptorSetLayout = new DescriptorSetLayout(m_Device);
-	m_pDescriptorSetLayout
-		->AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-		->Create();
+	// viewport
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(m_pDepthImages[frameIndex]->GetExtent().width);
+	viewport.height = static_cast<float>(m_pDepthImages[frameIndex]->GetExtent().height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	// scissor
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_pDepthImages[frameIndex]->GetExtent();
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	m_FrameConstants.Bind(commandBuffer, m_pPipeline->GetPipelineLayout());
+
+	// the model matrix is pushed per draw, the cascade sits behind it
+	vkCmdPushConstants(commandBuffer, m_pPipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), sizeof(uint32_t), &cascade);
 
-	m_pDescriptorSet = new DescriptorSet(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
-	m_pDescriptorSet
-		->AddBufferWrite(0, m_pUniformBuffer->GetDescriptorBufferInfos())
-		->UpdateAll();
+	// draw the scene
+	scene.DrawItems(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, true, drawItems);
+}
+
+void cat::ShadowPass::CullCascade(uint32_t cascade, const Scene& scene)
+{
+	const auto& light = scene.GetDirectionalLight();
+	const glm::mat4& viewProj = light.cascadeViewProj[cascade];
+
+	// the receivers of the cascade lie in the sphere it was fitted around, in clip space a disc of radius 1 around its center.
+	// not the current slice of the camera frustum, the layer stays cached while that slice moves inside the sphere
+	const glm::vec2 receiverCenter = glm::vec2(viewProj * glm::vec4(glm::vec3(light.cascadeSpheres[cascade]), 1.f));
+	const float texelsPerClipUnit = static_cast<float>(m_Resolution) * 0.5f;
+	const float minCasterTexels = scene.GetCascadeSettings().minCasterTexels;
+
+	auto& drawItems = m_CascadeDrawItems[cascade];
+	drawItems.clear();
+	for (const auto& item : scene.GetOpaqueDrawItems())
+	{
+		++m_CasterStats.candidates;
+
+		const auto [worldMin, worldMax] = item.GetWorldBounds();
+		const auto [clipMin, clipMax] = GetClipBounds(viewProj, worldMin, worldMax);
+		if (!IsInLightVolume(clipMin, clipMax))
+		{
+			++m_CasterStats.outsideVolume;
+			continue;
+		}
+
+		// the shadow falls along the light direction, which is clip space z, so it only covers the caster's own xy rect
+		const glm::vec2 closest = glm::clamp(receiverCenter, glm::vec2(clipMin), glm::vec2(clipMax));
+		if (glm::length(closest - receiverCenter) > 1.f)
+		{
+			++m_CasterStats.noReceiver;
+			continue;
+		}
+
+		const glm::vec2 texels = (glm::vec2(clipMax) - glm::vec2(clipMin)) * texelsPerClipUnit;
+		if (std::max(texels.x, texels.y) < minCasterTexels)
+		{
+			++m_CasterStats.tooSmall;
+			continue;
+		}
+
+		++m_CasterStats.drawn;
+		drawItems.push_back(item);
+	}
+}
+
+void cat::ShadowPass::InvalidateCache(const Scene& scene)
+{
+	// another scene, none of the layers hold its casters
+	if (m_pCachedScene != &scene)
+	{
+		m_pCachedScene = &scene;
+		for (auto& cascades : m_Cache)
+		{
+			for (auto& cached : cascades) cached.isValid = false;
+		}
+		return;
+	}
+
+	for (const auto& [boundsMin, boundsMax] : scene.GetMovedCasterBounds())
+	{
+		for (auto& cascades : m_Cache)
+		{
+			for (auto& cached : cascades)
+			{
+				if (!cached.isValid)
+					continue;
+
+				const auto [clipMin, clipMax] = GetClipBounds(cached.viewProj, boundsMin, boundsMax);
+				if (IsInLightVolume(clipMin, clipMax))
+					cached.isValid = false;
+			}
+		}
+	}
+}
+
+std::pair<glm::vec3, glm::vec3> cat::ShadowPass::GetClipBounds(const glm::mat4& viewProj, const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+	// orthographic, so w stays 1
+	glm::vec3 clipMin{ FLT_MAX };
+	glm::vec3 clipMax{ -FLT_MAX };
+	for (uint32_t corner{ 0 }; corner < 8; ++corner)
+	{
+		const glm::vec3 point{
+			(corner & 1) ? worldMax.x : worldMin.x,
+			(corner & 2) ? worldMax.y : worldMin.y,
+			(corner & 4) ? worldMax.z : worldMin.z
+		};
+		const glm::vec3 clipPoint = glm::vec3(viewProj * glm::vec4(point, 1.f));
+		clipMin = glm::min(clipMin, clipPoint);
+		clipMax = glm::max(clipMax, clipPoint);
+	}
+	return { clipMin, clipMax };
+}
+
+bool cat::ShadowPass::IsInLightVolume(const glm::vec3& clipMin, const glm::vec3& clipMax)
+{
+	// the near plane already reaches back to the scene bounds, so only the far plane culls in depth
+	return !(clipMax.x < -1.f || clipMin.x > 1.f || clipMax.y < -1.f || clipMin.y > 1.f || clipMin.z > 1.f);
 }
 
 void cat::ShadowPass::CreatePipeline()
@@ -146,7 +347,13 @@ void cat::ShadowPass::CreatePipeline()
 	attrib.format = VK_FORMAT_R32G32B32_SFLOAT;
 	attrib.offset = offsetof(Mesh::Vertex, Mesh::Vertex::pos);
 	pipelineInfo.vertexAttributeDescriptions = { attrib };
-	pipelineInfo.CreatePipelineLayout(m_Device, { m_pDescriptorSetLayout->GetDescriptorSetLayout() });
+	// model matrix + cascade index
+	pipelineInfo.pushConstantRanges = VkPushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof(glm::mat4) + sizeof(uint32_t)
+	};
+	pipelineInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout() });
 
 	m_pPipeline = new Pipeline(
 		m_Device,
@@ -154,4 +361,73 @@ void cat::ShadowPass::CreatePipeline()
 		m_FragPath,
 		pipelineInfo
 	);
+
+	// MIN/MAX PYRAMID
+	{
+		Pipeline::PipelineInfo computeInfo{};
+		computeInfo.SetDefault();
+		computeInfo.pushConstantRanges = VkPushConstantRange{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(PyramidPushConstants)
+		};
+		computeInfo.CreatePipelineLayout(m_Device, { m_pPyramidDescriptorSetLayout->GetDescriptorSetLayout() });
+
+		m_pPyramidPipeline = std::make_unique<Pipeline>(m_Device, m_PyramidPath, computeInfo);
+	}
+}
+
+void cat::ShadowPass::CreatePyramids()
+{
+	// level 0 halves the shadow map, the last level is a single texel per cascade
+	const uint32_t size = std::max(m_Resolution / 2, 1u);
+	uint32_t mipLevels = 1;
+	while ((size >> mipLevels) > 0) ++mipLevels;
+	mipLevels = std::min(mipLevels, MAX_PYRAMID_LEVELS);
+
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pPyramids.push_back(std::make_unique<Image>(m_Device, size, size, mipLevels, PYRAMID_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO, CASCADE_COUNT));
+		m_pPyramids.back()->SetName(std::string("Shadow min/max pyramid <") + std::to_string(i));
+	}
+}
+
+void cat::ShadowPass::CreateDescriptors()
+{
+	m_pDescriptorPool = std::make_unique<DescriptorPool>(m_Device);
+	m_pDescriptorPool
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight * MAX_PYRAMID_LEVELS)
+		->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_FramesInFlight * MAX_PYRAMID_LEVELS)
+		->Create(m_FramesInFlight * MAX_PYRAMID_LEVELS);
+
+	m_pPyramidDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+	m_pPyramidDescriptorSetLayout
+		->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+		->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+		->Create();
+
+	m_pPyramidDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pPyramidDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight * MAX_PYRAMID_LEVELS);
+
+	// the images never change, so the sets are written once
+	m_pPyramidDescriptorSet->ClearDescriptorWrites();
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		const Image& pyramid = *m_pPyramids[i];
+		for (uint32_t level{ 0 }; level < pyramid.GetMipLevels(); ++level)
+		{
+			const uint32_t idx = i * MAX_PYRAMID_LEVELS + level;
+
+			// level 0 reduces the cascades, every other level the one above it
+			const VkDescriptorImageInfo srcInfo = level == 0
+				? m_pDepthImages[i]->GetImageInfo()
+				: VkDescriptorImageInfo{ pyramid.GetSampler(), pyramid.GetMipImageView(level - 1), VK_IMAGE_LAYOUT_GENERAL };
+			const VkDescriptorImageInfo dstInfo{ VK_NULL_HANDLE, pyramid.GetMipImageView(level), VK_IMAGE_LAYOUT_GENERAL };
+
+			m_pPyramidDescriptorSet
+				->AddImageWrite(0, srcInfo, idx) // source
+				->AddImageWrite(1, dstInfo, idx) // destination level
+				->UpdateByIdx(idx);
+		}
+	}
 }
@@ -1,17 +1,43 @@
 #pragma once
 #include "../Pipeline.h"
+#include "../RenderGraph.h"
+#include "../buffers/ParallelRecorder.h"
+#include "../buffers/FrameConstants.h"
 
 #include "../scene/Camera.h"
 #include "../scene/Scene.h"
 
+// std
+#include <array>
+
 namespace cat
 {
+	// Cascaded shadow map of the directional light, one layer per cascade of Scene::DirectionalLight.
+	// Every cascade only draws the opaque items that overlap its light volume, can shade a receiver inside the sphere
+	// the volume was fitted around and cover at least CascadeSettings::minCasterTexels.
+	// The layers are cached per frame in flight, a layer is only redrawn when its light volume moved
+	// or a caster that was added, moved or removed overlaps it. With nothing to redraw the pass is left out of the graph.
+	// The redrawn layers are reduced into a min/max depth pyramid, ray marchers skip the texels that are entirely lit or shadowed with it.
 	class ShadowPass
 	{
 	public:
+		static constexpr uint32_t CASCADE_COUNT = Scene::DirectionalLight::CASCADE_COUNT;
+		static constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+		static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32G32_SFLOAT; // r = min, g = max depth
+
+		// summed over the cascades drawn by the last frame
+		struct CasterStats
+		{
+			uint32_t candidates = 0;		// opaque items tested
+			uint32_t outsideVolume = 0;
+			uint32_t noReceiver = 0;		// shadow cannot reach the receivers of the cascade
+			uint32_t tooSmall = 0;			// below the texel threshold
+			uint32_t drawn = 0;
+		};
+
 		// CTOR & DTOR
 		//------------------------------
-		ShadowPass(Device& device, uint32_t framesInFlight);
+		ShadowPass(Device& device, const FrameConstants& frameConstants, uint32_t framesInFlight, uint32_t resolution);
 		~ShadowPass();
 
 		ShadowPass(const ShadowPass&) = delete;
@@ -22,41 +48,89 @@ namespace cat
 
 		// METHODS
 		//------------------------------
-		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Scene& scene) const;
+		// writes this frame's stale cascades, the draws are culled & recorded on the worker threads once the graph knows the pass is live
+		void AddToGraph(RenderGraph& graph, ParallelRecorder& recorder, uint32_t frameIndex, const Scene& scene);
+
+		// records the draws of one cascade on the worker threads, has to be called before Record of the same frame
+		ParallelRecorder::Batch RecordDraws(ParallelRecorder& recorder, uint32_t frameIndex, uint32_t cascade, const Scene& scene, const std::vector<Scene::DrawItem>& drawItems) const;
+		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t cascade, ParallelRecorder::Batch& draws) const;
+		// adds the pyramid pass after the shadow pass
+		void AddPyramidToGraph(RenderGraph& graph, uint32_t frameIndex);
+		// reduces the cascades in layerMask into the pyramid of the frame
+		void RecordPyramid(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t layerMask) const;
 
 		// Getters & Setters
 		const std::vector<std::unique_ptr<Image>>& GetDepthImages() const { return m_pDepthImages; }
+		// level 0 is half the shadow map, sampled in GENERAL
+		const std::vector<std::unique_ptr<Image>>& GetMinMaxPyramids() const { return m_pPyramids; }
+		uint32_t GetRedrawnCascadeCount() const { return m_RedrawnCascadeCount; }	// of the last AddToGraph
+		const CasterStats& GetCasterStats() const { return m_CasterStats; }
+		void ToggleCache() { m_UseCache = !m_UseCache; }
+		void SetUseCache(bool useCache) { m_UseCache = useCache; }
 
 	private:
 		// Private methods
 		//------------------------------
-		void CreateUniformBuffers();
-		void CreateDescriptors();
 		void CreatePipeline();
+		void CreatePyramids();
+		void CreateDescriptors();
 
+		void RecordDrawChunk(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t cascade, const Scene& scene, std::span<const Scene::DrawItem> drawItems) const;
+		// keeps the opaque items that can cast a visible shadow in the cascade
+		void CullCascade(uint32_t cascade, const Scene& scene);
+		// drops the cached layers a moved caster overlaps, in every frame in flight
+		void InvalidateCache(const Scene& scene);
+
+		// bounds of a world space box in the clip space of a cascade
+		static std::pair<glm::vec3, glm::vec3> GetClipBounds(const glm::mat4& viewProj, const glm::vec3& worldMin, const glm::vec3& worldMax);
+		static bool IsInLightVolume(const glm::vec3& clipMin, const glm::vec3& clipMax);
 
 
 		// Private members
 		//------------------------------
 		Device& m_Device;
+		const FrameConstants& m_FrameConstants;
 		uint32_t m_FramesInFlight;
 
-		std::vector<std::unique_ptr<Image>> m_pDepthImages;
-
-		struct alignas(16) ShadowUbo
-		{
-			glm::mat4 lightProj;
-			glm::mat4 lightView;
-		};
-		std::unique_ptr<UniformBuffer<ShadowUbo>> m_pUniformBuffer;
-		DescriptorPool* m_pDescriptorPool;
-		DescriptorSetLayout* m_pDescriptorSetLayout;
-		DescriptorSet* m_pDescriptorSet;
+		uint32_t m_Resolution;
+		std::vector<std::unique_ptr<Image>> m_pDepthImages;	// one layer per cascade
 
 		std::string m_VertPath = "shaders/shadow.vert.spv";
 		std::string m_FragPath = "";
 
 		Pipeline* m_pPipeline;
 
+		// MIN/MAX PYRAMID
+		struct PyramidPushConstants
+		{
+			glm::ivec2 srcSize;
+			glm::ivec2 dstSize;
+			uint32_t isDepth;		// level 0 reads the shadow map
+			uint32_t layerMask;
+		};
+
+		std::string m_PyramidPath = "shaders/shadow_pyramid.comp.spv";
+		std::unique_ptr<Pipeline> m_pPyramidPipeline;
+		std::unique_ptr<DescriptorPool> m_pDescriptorPool;
+		std::unique_ptr<DescriptorSetLayout> m_pPyramidDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pPyramidDescriptorSet;	// one per frame in flight & pyramid level
+		std::vector<std::unique_ptr<Image>> m_pPyramids;		// one per frame in flight, one layer per cascade
+		std::vector<uint32_t> m_PyramidValidMasks;				// per frame in flight, the cascades reduced since their last redraw
+
+		// filled in Prepare, the worker threads read them until the pass has recorded
+		std::array<std::vector<Scene::DrawItem>, CASCADE_COUNT> m_CascadeDrawItems{};
+		std::array<ParallelRecorder::Batch, CASCADE_COUNT> m_Draws{};
+
+		// the light volume every layer was last drawn with
+		struct CachedCascade
+		{
+			glm::mat4 viewProj{ 0.f };
+			bool isValid = false;
+		};
+		std::vector<std::array<CachedCascade, CASCADE_COUNT>> m_Cache;	// per frame in flight
+		const Scene* m_pCachedScene = nullptr;
+		bool m_UseCache = true;
+		uint32_t m_RedrawnCascadeCount = 0;
+		CasterStats m_CasterStats{};
 	};
 }
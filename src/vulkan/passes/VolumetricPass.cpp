@@ -3,24 +3,16 @@
 #include "LightingPass.h"
 #include "../utils/DebugLabel.h"
 
-cat::VolumetricPass::VolumetricPass(Device& device, SwapChain& swapChain, uint32_t framesInFlight, LightingPass& lightingPass, ShadowPass& shadowPass)
-	: m_Device(device), m_FramesInFlight(framesInFlight), m_SwapChain(swapChain), m_Extent(swapChain.GetSwapChainExtent()),
+#include <algorithm>
+
+cat::VolumetricPass::VolumetricPass(Device& device, RingBuffer& ringBuffer, const FrameConstants& frameConstants, TransientImageAllocator& transientImages, SwapChain& swapChain, uint32_t framesInFlight, LightingPass& lightingPass, ShadowPass& shadowPass)
+	: m_Device(device), m_RingBuffer(ringBuffer), m_FrameConstants(frameConstants), m_TransientImages(transientImages), m_FramesInFlight(framesInFlight), m_SwapChain(swapChain), m_Extent(swapChain.GetSwapChainExtent()),
 	m_ShadowPass(shadowPass), m_LightingPass(lightingPass)
 {
-	// IMAGES
-	m_pVolumetricImages.resize(m_FramesInFlight);
-	for (int index{ 0 }; index < m_FramesInFlight; ++index) {
-		m_pVolumetricImages[index] = std::make_unique<Image>(
-			m_Device,
-			m_SwapChain.GetSwapChainExtent().width, m_SwapChain.GetSwapChainExtent().height,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VMA_MEMORY_USAGE_AUTO
-		);
-		DebugLabel::NameImage(m_pVolumetricImages[index]->GetImage(), std::string("Volumetric buffer <3.") + std::to_string(index));
-	}
-
-	CreateBuffers();
+	RequestImages();
+	CreateVolumes();
+	CreateMarchImages();
+	CreateMarchCounters();
 	CreateDescriptors();
 	CreatePipeline();
 }
@@ -33,79 +25,186 @@ cat::VolumetricPass::~VolumetricPass()
 	m_pDescriptorSetLayout = nullptr;
 	delete m_pDescriptorSet;
 	m_pDescriptorSet = nullptr;
-
-	delete m_pPipeline;
-	m_pPipeline = nullptr;
 }
 
-void cat::VolumetricPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Camera camera, Scene& scene) const
+void cat::VolumetricPass::AddToGraph(RenderGraph& graph, uint32_t frameIndex)
 {
-	DebugLabel::Begin(commandBuffer, "Volumetric Pass", glm::vec4(0.4f, 0.0f, 0.8f, 1.0f));
+	// the fence of this frame has been waited on, so the last march in this slot is done
+	ReadMarchStats(frameIndex);
 
-	Image& volImage = *m_pVolumetricImages[frameIndex];
+	const bool isMarch = m_Settings.mode == Mode::RayMarch;
+	const uint32_t prev = m_HistoryIndex;
+	const uint32_t cur = isMarch ? prev ^ 1 : prev;
 
-	// BEGIN RECORDING
+	const VolumetricsUbo uboData = {
+		.gridSize = glm::uvec4(FROXEL_GRID.width, FROXEL_GRID.height, FROXEL_GRID.depth, 0),
+
+		.fogDensity = 0.005f,
+		.froxelNear = FROXEL_NEAR,
+		.froxelFar = FROXEL_FAR,
+		.fogPhaseK = 0.82f,
+
+		.rayStrength = 80.f,
+		.rayDensity = 0.98f,
+		.multiScatterStrength = 0.2f,
+		.frameCounter = m_FrameCounter,
+
+		.marchSize = glm::uvec2(m_MarchExtent.width, m_MarchExtent.height),
+		.isHistoryValid = m_IsHistoryValid ? 1u : 0u,
+		.historyWeight = 0.9f
+	};
+	const uint32_t uboOffset = m_RingBuffer.Push(uboData);
+	const uint32_t setIndex = GetSetIndex(frameIndex, cur);
+
+	if (isMarch)
 	{
-		VolumetricsUbo uboData = {
-			.invViewProj = glm::inverse(camera.GetProjection() * camera.GetView()),
-			.lightViewProj = scene.GetDirectionalLight().projectionMatrix * scene.GetDirectionalLight().viewMatrix,
-			.camPos = camera.GetOrigin(),
-
-			.lightDir = scene.GetDirectionalLight().direction,
-			.lightColor = scene.GetDirectionalLight().color,
-			.lightIntensity = scene.GetDirectionalLight().intensity,
-			.volumetricDensity = 0.005f,
-
-			.stepSize = 0.1f,
-			.numSteps = 500,
-
-			.rayStrength = 80.f,
-			.rayDecay = 0.99f,
-			.rayDensity = 0.98f,
-			.rayWeight = 0.8f,
-
-			.useMultiScattering = m_UseMultiScattering,
-			.multiScatterStrength = 0.2f
-		};
-		m_pUniformBuffer->Update(frameIndex, uboData);
-
-		// transitioning images
-		//----------------------
-		volImage.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		const Pipeline* pMarchPipeline = &m_pMarchPipelines->Get(GetMarchConstants());
+		graph.AddPass("VolumetricMarch", [this, frameIndex, setIndex, uboOffset, pMarchPipeline](VkCommandBuffer commandBuffer)
 			{
-				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				VK_ACCESS_NONE,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-			});
-
-		m_ShadowPass.GetDepthImages()[frameIndex]->TransitionImageLayout(
-			commandBuffer,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				vkCmdFillBuffer(commandBuffer, m_pMarchCounters[frameIndex]->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+				VkMemoryBarrier clearBarrier{};
+				clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+					1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+				RecordMarch(commandBuffer, setIndex, uboOffset, *pMarchPipeline);
+			})
+			.Read(*m_ShadowPass.GetDepthImages()[frameIndex], RenderGraph::COMPUTE_SAMPLED)
+			.Read(*m_ShadowPass.GetMinMaxPyramids()[frameIndex], RenderGraph::COMPUTE_STORAGE_READ)
+			.Read(*m_SwapChain.GetDepthImage(frameIndex), RenderGraph::COMPUTE_SAMPLED)
+			.Read(*m_pMarchColors[prev], RenderGraph::COMPUTE_SAMPLED)
+			.Read(*m_pMarchDepths[prev], RenderGraph::COMPUTE_SAMPLED)
+			.Write(*m_pMarchColors[cur], RenderGraph::COMPUTE_STORAGE_WRITE, true)
+			.Write(*m_pMarchDepths[cur], RenderGraph::COMPUTE_STORAGE_WRITE, true)
+			.WriteBuffer(m_pMarchCounters[frameIndex]->GetBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+			.SetAsyncCompute();
+
+		m_HasMarched[frameIndex] = true;
+		m_HistoryIndex = cur;
+		m_IsHistoryValid = true;
+		++m_FrameCounter;
+	}
+	else
+	{
+		const Pipeline* pInjectPipeline = &m_pInjectPipelines->Get(GetInjectConstants());
+		graph.AddPass("FroxelInject", [this, frameIndex, uboOffset, pInjectPipeline](VkCommandBuffer commandBuffer)
 			{
-				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			}
-		);
-
-		m_LightingPass.GetLitImages()[frameIndex]->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				RecordInject(commandBuffer, frameIndex, uboOffset, *pInjectPipeline);
+			})
+			.Read(*m_ShadowPass.GetDepthImages()[frameIndex], RenderGraph::COMPUTE_SAMPLED)
+			.Write(*m_pScatteringVolumes[frameIndex], RenderGraph::COMPUTE_STORAGE_WRITE, true)
+			.SetAsyncCompute();
+
+		graph.AddPass("FroxelIntegrate", [this, frameIndex, uboOffset](VkCommandBuffer commandBuffer)
 			{
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			});
+				RecordIntegrate(commandBuffer, frameIndex, uboOffset);
+			})
+			.Read(*m_pScatteringVolumes[frameIndex], RenderGraph::COMPUTE_STORAGE_READ)
+			.Write(*m_pIntegratedVolumes[frameIndex], RenderGraph::COMPUTE_STORAGE_WRITE, true)
+			.SetAsyncCompute();
+
+		// the march history goes stale while the froxels run
+		m_IsHistoryValid = false;
+	}
+
+	// both sources stay bound, the one the mode skips only has to be in the sampled layout
+	const Pipeline* pCompositePipeline = &m_pCompositePipelines->Get(GetCompositeConstants());
+	graph.AddPass("VolumetricPass", [this, setIndex, uboOffset, pCompositePipeline](VkCommandBuffer commandBuffer)
+		{
+			Record(commandBuffer, setIndex, uboOffset, *pCompositePipeline);
+		})
+		.Read(m_LightingPass.GetLitImage(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_SwapChain.GetDepthImage(frameIndex), RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_pIntegratedVolumes[frameIndex], RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_pMarchColors[cur], RenderGraph::FRAGMENT_SAMPLED)
+		.Read(*m_pMarchDepths[cur], RenderGraph::FRAGMENT_SAMPLED)
+		.Write(GetVolumetricImage(frameIndex), RenderGraph::COLOR_ATTACHMENT_WRITE, true);
+}
+
+void cat::VolumetricPass::ReadMarchStats(uint32_t frameIndex)
+{
+	if (!m_HasMarched[frameIndex])
+	{
+		m_MarchStats = {};
+		return;
+	}
+
+	MarchCounters counters{};
+	vmaCopyAllocationToMemory(m_Device.GetAllocator(), m_pMarchCounters[frameIndex]->GetAllocation(), 0, &counters, sizeof(MarchCounters));
+	m_MarchStats = { counters.steps, counters.texels };
+	m_HasMarched[frameIndex] = false;
+}
+
+bool cat::VolumetricPass::SetSettings(const Settings& settings)
+{
+	const bool isResized = settings.resolutionDivisor != m_Settings.resolutionDivisor;
+	m_Settings = settings;
+	m_Settings.resolutionDivisor = std::max(m_Settings.resolutionDivisor, 1u);
+	m_Settings.marchSteps = std::max(m_Settings.marchSteps, 1u);
+
+	if (isResized)
+	{
+		vkDeviceWaitIdle(m_Device.GetDevice());
+		CreateMarchImages();
+		UpdateDescriptors();
+	}
+	return isResized;
+}
+
+void cat::VolumetricPass::RecordInject(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t uboOffset, const Pipeline& pipeline) const
+{
+	DebugLabel::Begin(commandBuffer, "Froxel Inject", glm::vec4(0.4f, 0.0f, 0.8f, 1.0f));
+
+	pipeline.Bind(commandBuffer);
+	m_FrameConstants.Bind(commandBuffer, pipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE);
+	m_pFroxelDescriptorSet->Bind(commandBuffer, pipeline.GetPipelineLayout(), frameIndex, 1, { uboOffset }, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	// one thread per froxel
+	vkCmdDispatch(commandBuffer, (FROXEL_GRID.width + 7) / 8, (FROXEL_GRID.height + 7) / 8, FROXEL_GRID.depth);
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::VolumetricPass::RecordIntegrate(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t uboOffset) const
+{
+	DebugLabel::Begin(commandBuffer, "Froxel Integrate", glm::vec4(0.4f, 0.0f, 0.8f, 1.0f));
+
+	m_pIntegratePipeline->Bind(commandBuffer);
+	m_FrameConstants.Bind(commandBuffer, m_pIntegratePipeline->GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE);
+	m_pFroxelDescriptorSet->Bind(commandBuffer, m_pIntegratePipeline->GetPipelineLayout(), frameIndex, 1, { uboOffset }, VK_PIPELINE_BIND_POINT_COMPUTE);
 
-		m_SwapChain.GetDepthImage(frameIndex)->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {
-				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			});
+	// one thread per froxel column
+	vkCmdDispatch(commandBuffer, (FROXEL_GRID.width + 7) / 8, (FROXEL_GRID.height + 7) / 8, 1);
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::VolumetricPass::RecordMarch(VkCommandBuffer commandBuffer, uint32_t setIndex, uint32_t uboOffset, const Pipeline& pipeline) const
+{
+	DebugLabel::Begin(commandBuffer, "Volumetric March", glm::vec4(0.4f, 0.0f, 0.8f, 1.0f));
+
+	pipeline.Bind(commandBuffer);
+	m_FrameConstants.Bind(commandBuffer, pipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE);
+	m_pMarchDescriptorSet->Bind(commandBuffer, pipeline.GetPipelineLayout(), setIndex, 1, { uboOffset }, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	// one thread per low resolution texel
+	vkCmdDispatch(commandBuffer, (m_MarchExtent.width + 7) / 8, (m_MarchExtent.height + 7) / 8, 1);
+
+	DebugLabel::End(commandBuffer);
+}
+
+void cat::VolumetricPass::Record(VkCommandBuffer commandBuffer, uint32_t setIndex, uint32_t uboOffset, const Pipeline& pipeline) const
+{
+	DebugLabel::Begin(commandBuffer, "Volumetric Pass", glm::vec4(0.4f, 0.0f, 0.8f, 1.0f));
 
+	Image& volImage = GetVolumetricImage(setIndex / 2);
 
+	// BEGIN RECORDING
+	{
 		// Render Attachments
 		//---------------------
 		VkClearValue clearValue{};
@@ -149,9 +248,10 @@ void cat::VolumetricPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIn
 		scissor.extent = m_Extent;
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		m_pPipeline->Bind(commandBuffer);
+		pipeline.Bind(commandBuffer);
 
-		m_pDescriptorSet->Bind(commandBuffer, m_pPipeline->GetPipelineLayout(), frameIndex, 0);
+		m_FrameConstants.Bind(commandBuffer, pipeline.GetPipelineLayout());
+		m_pDescriptorSet->Bind(commandBuffer, pipeline.GetPipelineLayout(), setIndex, 1, { uboOffset });
 
 		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
@@ -160,89 +260,281 @@ void cat::VolumetricPass::Record(VkCommandBuffer commandBuffer, uint32_t frameIn
 	// END RECORDING
 	{
 		vkCmdEndRenderingKHR(commandBuffer);
-
-		// transitioning images
-		//----------------------
-		volImage.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			Image::BarrierInfo{
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT
-			});
-
-
 	}
 
 	DebugLabel::End(commandBuffer);
 }
 
-void cat::VolumetricPass::CreateBuffers()
-{
-	m_pUniformBuffer = std::make_unique<UniformBuffer<VolumetricsUbo>>(m_Device, m_FramesInFlight);
-}
-
 void cat::VolumetricPass::CreateDescriptors()
 {
+	// composite & march: 2 sets per frame, froxels: 1 set per frame
 	m_pDescriptorPool = new DescriptorPool(m_Device);
-	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 * m_FramesInFlight);
-	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 * m_FramesInFlight);
-	m_pDescriptorPool->Create(m_FramesInFlight);
+	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 21 * m_FramesInFlight);
+	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6 * m_FramesInFlight);
+	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * m_FramesInFlight);
+	m_pDescriptorPool->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 5 * m_FramesInFlight);
+	m_pDescriptorPool->Create(5 * m_FramesInFlight);
 
+	// COMPOSITE
 	m_pDescriptorSetLayout = new DescriptorSetLayout(m_Device);
 	m_pDescriptorSetLayout->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // frame
 	m_pDescriptorSetLayout->AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // depth
-	m_pDescriptorSetLayout->AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // shadow map
-	m_pDescriptorSetLayout->AddBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT); // buffer
+	m_pDescriptorSetLayout->AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // integrated volume
+	m_pDescriptorSetLayout->AddBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT); // buffer
+	m_pDescriptorSetLayout->AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // march color
+	m_pDescriptorSetLayout->AddBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); // march depth
 	m_pDescriptorSetLayout->Create();
 
-	m_pDescriptorSet = new DescriptorSet(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
-	for (int i{}; i < m_pDescriptorSet->GetDescriptorSetCount();i++)
-	{
-		m_pDescriptorSet
-			->AddImageWrite(0, m_LightingPass.GetLitImages()[i]->GetImageInfo(), i) // scene
-			->AddImageWrite(1, m_SwapChain.GetDepthImage(i)->GetImageInfo(), i) // depth
-			->AddImageWrite(2, m_ShadowPass.GetDepthImages()[i]->GetImageInfo(), i) // shadow map)
-			->AddBufferWrite(3, m_pUniformBuffer->GetDescriptorBufferInfos(), i) // buffer 
-			->UpdateByIdx(i);
-	}
+	m_pDescriptorSet = new DescriptorSet(m_Device, *m_pDescriptorSetLayout, *m_pDescriptorPool, 2 * m_FramesInFlight);
+
+	// INJECT & INTEGRATE
+	m_pFroxelDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+	m_pFroxelDescriptorSetLayout
+		->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // shadow map
+		->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // scattering volume
+		->AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // integrated volume
+		->AddBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // buffer
+		->Create();
+
+	m_pFroxelDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pFroxelDescriptorSetLayout, *m_pDescriptorPool, m_FramesInFlight);
+
+	// MARCH
+	m_pMarchDescriptorSetLayout = std::make_unique<DescriptorSetLayout>(m_Device);
+	m_pMarchDescriptorSetLayout
+		->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // shadow map
+		->AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // depth
+		->AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // history color
+		->AddBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // buffer
+		->AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // history depth
+		->AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // color
+		->AddBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // depth
+		->AddBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // shadow min/max pyramid
+		->AddBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // counters
+		->Create();
+
+	m_pMarchDescriptorSet = std::make_unique<DescriptorSet>(m_Device, *m_pMarchDescriptorSetLayout, *m_pDescriptorPool, 2 * m_FramesInFlight);
+	// written in UpdateDescriptors, once the lit images have memory
 }
 
 void cat::VolumetricPass::CreatePipeline()
 {
-	Pipeline::PipelineInfo pipelineInfo{};
-	pipelineInfo.SetDefault();
+	// every variant owns its layout, the layouts of one shader are identical so the descriptor sets fit all of them
+	// COMPOSITE
+	m_pCompositePipelines = std::make_unique<PipelineVariants>([this](const PipelineVariants::Constants& constants)
+		{
+			Pipeline::PipelineInfo pipelineInfo{};
+			pipelineInfo.SetDefault();
+			pipelineInfo.specializationConstants = constants;
+
+			// attachments
+			pipelineInfo.depthStencil.depthTestEnable = VK_FALSE;
+			pipelineInfo.colorAttachments = {
+				VOLUMETRIC_FORMAT
+			};
+			pipelineInfo.colorBlendAttachments.resize(pipelineInfo.colorAttachments.size(),
+				VkPipelineColorBlendAttachmentState{ .blendEnable = VK_FALSE, .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT }
+			);
+			pipelineInfo.colorBlending.pAttachments = pipelineInfo.colorBlendAttachments.data();
+			pipelineInfo.colorBlending.attachmentCount = static_cast<uint32_t>(pipelineInfo.colorBlendAttachments.size());
+
+			pipelineInfo.vertexBindingDescriptions = {};
+			pipelineInfo.vertexAttributeDescriptions = {};
+
+			pipelineInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout(), m_pDescriptorSetLayout->GetDescriptorSetLayout() });
+
+			return std::make_unique<Pipeline>(m_Device, m_VertPath, m_FragPath, pipelineInfo);
+		});
+
+	// INJECT & INTEGRATE
+	m_pInjectPipelines = std::make_unique<PipelineVariants>([this](const PipelineVariants::Constants& constants)
+		{
+			Pipeline::PipelineInfo computeInfo{};
+			computeInfo.SetDefault();
+			computeInfo.specializationConstants = constants;
+			computeInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout(), m_pFroxelDescriptorSetLayout->GetDescriptorSetLayout() });
+			return std::make_unique<Pipeline>(m_Device, m_InjectPath, computeInfo);
+		});
+	{
+		Pipeline::PipelineInfo computeInfo{};
+		computeInfo.SetDefault();
+		computeInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout(), m_pFroxelDescriptorSetLayout->GetDescriptorSetLayout() });
+		m_pIntegratePipeline = std::make_unique<Pipeline>(m_Device, m_IntegratePath, computeInfo);
+	}
 
-	// attachments
-	pipelineInfo.depthStencil.depthTestEnable = VK_FALSE;
-	pipelineInfo.colorAttachments = {
-		VK_FORMAT_R32G32B32A32_SFLOAT
-	};
-	pipelineInfo.colorBlendAttachments.resize(pipelineInfo.colorAttachments.size(),
-		VkPipelineColorBlendAttachmentState{ .blendEnable = VK_FALSE, .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT }
-	);
-	pipelineInfo.colorBlending.pAttachments = pipelineInfo.colorBlendAttachments.data();
-	pipelineInfo.colorBlending.attachmentCount = static_cast<uint32_t>(pipelineInfo.colorBlendAttachments.size());
+	// MARCH
+	m_pMarchPipelines = std::make_unique<PipelineVariants>([this](const PipelineVariants::Constants& constants)
+		{
+			Pipeline::PipelineInfo computeInfo{};
+			computeInfo.SetDefault();
+			computeInfo.specializationConstants = constants;
+			computeInfo.CreatePipelineLayout(m_Device, { m_FrameConstants.GetDescriptorSetLayout(), m_pMarchDescriptorSetLayout->GetDescriptorSetLayout() });
+			return std::make_unique<Pipeline>(m_Device, m_MarchPath, computeInfo);
+		});
+
+	// the toggles switch between these without a hitch, other step counts are created on first use
+	for (const VkBool32 useMultiScattering : { VK_FALSE, VK_TRUE })
+	{
+		m_pInjectPipelines->Get({ static_cast<uint32_t>(Mode::Froxels), useMultiScattering });
+		for (const VkBool32 useSkipping : { VK_FALSE, VK_TRUE })
+		{
+			m_pMarchPipelines->Get({ static_cast<uint32_t>(Mode::RayMarch), useMultiScattering, m_Settings.marchSteps, useSkipping });
+		}
+	}
+	for (const Mode mode : { Mode::Froxels, Mode::RayMarch })
+	{
+		m_pCompositePipelines->Get({ static_cast<uint32_t>(mode) });
+	}
+}
 
-	pipelineInfo.vertexBindingDescriptions = {};
-	pipelineInfo.vertexAttributeDescriptions = {};
+// constant_id 0 = mode, 1 = multi-scattering, 2 = march steps, 3 = empty space skipping
+cat::PipelineVariants::Constants cat::VolumetricPass::GetCompositeConstants() const
+{
+	return { static_cast<uint32_t>(m_Settings.mode) };
+}
 
-	pipelineInfo.CreatePipelineLayout(m_Device, { m_pDescriptorSetLayout->GetDescriptorSetLayout() });
+cat::PipelineVariants::Constants cat::VolumetricPass::GetInjectConstants() const
+{
+	return { static_cast<uint32_t>(Mode::Froxels), m_UseMultiScattering ? VK_TRUE : VK_FALSE };
+}
 
-	m_pPipeline = new Pipeline(m_Device, m_VertPath, m_FragPath, pipelineInfo);
+cat::PipelineVariants::Constants cat::VolumetricPass::GetMarchConstants() const
+{
+	return {
+		static_cast<uint32_t>(Mode::RayMarch),
+		m_UseMultiScattering ? VK_TRUE : VK_FALSE,
+		m_Settings.marchSteps,
+		m_Settings.useEmptySpaceSkipping ? VK_TRUE : VK_FALSE
+	};
 }
 
 void cat::VolumetricPass::Resize(VkExtent2D size)
 {
 	m_Extent = size;
-	for (size_t i{ 0 }; i < m_FramesInFlight; i++)
+	RequestImages();
+	CreateMarchImages();
+}
+
+void cat::VolumetricPass::UpdateDescriptors()
+{
+	// the composite & march sets are indexed by GetSetIndex
+	const auto uboInfos = m_RingBuffer.GetDescriptorBufferInfos(sizeof(VolumetricsUbo), 2 * m_FramesInFlight);
+	std::vector<VkDescriptorBufferInfo> counterInfos;
+	for (uint32_t i{ 0 }; i < 2 * m_FramesInFlight; ++i)
+		counterInfos.push_back(m_pMarchCounters[i / 2]->GetDescriptorBufferInfo());
+
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; i++)
 	{
-		m_pDescriptorSet->ClearDescriptorWrites();
-		m_pDescriptorSet
-			->AddImageWrite(0, m_LightingPass.GetLitImages()[i]->GetImageInfo(), i) //Lit image
-			->AddImageWrite(1, m_SwapChain.GetDepthImage(i)->GetImageInfo(), i) // depth
-			->AddImageWrite(2, m_ShadowPass.GetDepthImages()[i]->GetImageInfo(), i) // shadow map
-			->AddBufferWrite(3, m_pUniformBuffer->GetDescriptorBufferInfos(), i)
+		// the march writes history cur & reads the other one
+		for (uint32_t cur{ 0 }; cur < 2; ++cur)
+		{
+			const uint32_t setIndex = GetSetIndex(i, cur);
+			const uint32_t prev = cur ^ 1;
+
+			m_pDescriptorSet->ClearDescriptorWrites();
+			m_pDescriptorSet
+				->AddImageWrite(0, m_LightingPass.GetLitImage(i).GetImageInfo(), setIndex) // lit image
+				->AddImageWrite(1, m_SwapChain.GetDepthImage(i)->GetImageInfo(), setIndex) // depth
+				->AddImageWrite(2, m_pIntegratedVolumes[i]->GetImageInfo(), setIndex) // integrated volume
+				->AddBufferWrite(3, uboInfos, setIndex) // buffer
+				->AddImageWrite(4, m_pMarchColors[cur]->GetImageInfo(), setIndex) // march color
+				->AddImageWrite(5, m_pMarchDepths[cur]->GetImageInfo(), setIndex) // march depth
+				->UpdateByIdx(setIndex);
+
+			// the march results are written in GENERAL
+			const VkDescriptorImageInfo colorInfo{ VK_NULL_HANDLE, m_pMarchColors[cur]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+			const VkDescriptorImageInfo depthInfo{ VK_NULL_HANDLE, m_pMarchDepths[cur]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+			const Image& pyramid = *m_ShadowPass.GetMinMaxPyramids()[i];
+			const VkDescriptorImageInfo pyramidInfo{ pyramid.GetSampler(), pyramid.GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+
+			m_pMarchDescriptorSet->ClearDescriptorWrites();
+			m_pMarchDescriptorSet
+				->AddImageWrite(0, m_ShadowPass.GetDepthImages()[i]->GetImageInfo(), setIndex) // shadow map
+				->AddImageWrite(1, m_SwapChain.GetDepthImage(i)->GetImageInfo(), setIndex) // depth
+				->AddImageWrite(2, m_pMarchColors[prev]->GetImageInfo(), setIndex) // history color
+				->AddBufferWrite(3, uboInfos, setIndex) // buffer
+				->AddImageWrite(4, m_pMarchDepths[prev]->GetImageInfo(), setIndex) // history depth
+				->AddImageWrite(5, colorInfo, setIndex) // color
+				->AddImageWrite(6, depthInfo, setIndex) // depth
+				->AddImageWrite(7, pyramidInfo, setIndex) // shadow min/max pyramid
+				->AddBufferWrite(8, counterInfos, setIndex) // counters
+				->UpdateByIdx(setIndex);
+		}
+
+		// the volumes are written in GENERAL
+		const VkDescriptorImageInfo scatteringInfo{ VK_NULL_HANDLE, m_pScatteringVolumes[i]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+		const VkDescriptorImageInfo integratedInfo{ VK_NULL_HANDLE, m_pIntegratedVolumes[i]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL };
+
+		m_pFroxelDescriptorSet->ClearDescriptorWrites();
+		m_pFroxelDescriptorSet
+			->AddImageWrite(0, m_ShadowPass.GetDepthImages()[i]->GetImageInfo(), i) // shadow map
+			->AddImageWrite(1, scatteringInfo, i) // scattering volume
+			->AddImageWrite(2, integratedInfo, i) // integrated volume
+			->AddBufferWrite(3, m_RingBuffer.GetDescriptorBufferInfos(sizeof(VolumetricsUbo), m_FramesInFlight), i) // buffer
 			->UpdateByIdx(i);
 	}
-}
\ No newline at end of file
+}
+
+void cat::VolumetricPass::CreateVolumes()
+{
+	// the grid follows the camera, not the screen, so the volumes survive a resize
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pScatteringVolumes.push_back(std::make_unique<Image>(m_Device, FROXEL_GRID, FROXEL_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT, VMA_MEMORY_USAGE_AUTO));
+		m_pScatteringVolumes.back()->SetName(std::string("Froxel scattering <") + std::to_string(i));
+
+		m_pIntegratedVolumes.push_back(std::make_unique<Image>(m_Device, FROXEL_GRID, FROXEL_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO));
+		m_pIntegratedVolumes.back()->SetName(std::string("Froxel integrated <") + std::to_string(i));
+	}
+}
+
+void cat::VolumetricPass::CreateMarchImages()
+{
+	const uint32_t divisor = m_Settings.resolutionDivisor;
+	m_MarchExtent = { (m_Extent.width + divisor - 1) / divisor, (m_Extent.height + divisor - 1) / divisor };
+
+	// shared by the frames in flight, the queue runs the frames in order
+	for (uint32_t i{ 0 }; i < 2; ++i)
+	{
+		m_pMarchColors[i] = std::make_unique<Image>(m_Device, m_MarchExtent.width, m_MarchExtent.height, MARCH_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO);
+		m_pMarchColors[i]->SetName(std::string("Volumetric march <") + std::to_string(i));
+
+		// linear filtering of 32 bit floats is optional, the depths are fetched anyway
+		m_pMarchDepths[i] = std::make_unique<Image>(m_Device, m_MarchExtent.width, m_MarchExtent.height, MARCH_DEPTH_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO, VK_FILTER_NEAREST);
+		m_pMarchDepths[i]->SetName(std::string("Volumetric march depth <") + std::to_string(i));
+	}
+	m_IsHistoryValid = false;
+}
+
+void cat::VolumetricPass::CreateMarchCounters()
+{
+	// read back on the CPU once the frame is done
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_pMarchCounters.push_back(std::make_unique<Buffer>(m_Device, Buffer::BufferInfo{
+			sizeof(MarchCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO, true }));
+		MarchCounters counters{};
+		m_pMarchCounters.back()->WriteToBuffer(&counters);
+	}
+	m_HasMarched.resize(m_FramesInFlight, false);
+}
+
+void cat::VolumetricPass::RequestImages()
+{
+	m_VolumetricImages.clear();
+	for (uint32_t i{ 0 }; i < m_FramesInFlight; ++i)
+	{
+		m_VolumetricImages.push_back(m_TransientImages.Request({
+			.name = std::string("Volumetric buffer <3.") + std::to_string(i),
+			.extent = m_Extent,
+			.format = VOLUMETRIC_FORMAT,
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			.frameIndex = i,
+			.firstPass = PassOrder::VolumetricPass,
+			.lastPass = PassOrder::BlitPass
+		}));
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 
 #include "LightingPass.h"
@@ -8,13 +9,52 @@
 
 namespace cat
 {
-
+	// Volumetric fog, in one of two modes:
+	//	- froxels, the cost follows the grid & not the screen resolution:
+	//		- inject: in-scattered light & extinction of every froxel of a camera aligned 3D grid, shadowed by the cascades,
+	//		- integrate: front to back along every froxel column,
+	//		- composite: one fetch of the integrated volume per pixel on top of the lit image.
+	//	- ray march at 1 / resolutionDivisor of the screen with a jitter that moves every frame,
+	//	  accumulated over the frames & upsampled with a depth aware bilateral filter in the composite.
+	//	  The march steps over the parts of a ray the shadow min/max pyramid shows entirely lit or shadowed.
+	// The mode, multi-scattering, march steps & skipping are specialization constants, every combination
+	// in use is its own pipeline so the shaders carry no branches on them.
 	class VolumetricPass final
 	{
 	public:
+		static constexpr VkFormat VOLUMETRIC_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
+		static constexpr VkFormat FROXEL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+		static constexpr VkExtent3D FROXEL_GRID{ 160, 90, 64 };
+		static constexpr float FROXEL_NEAR = 0.5f;		// view depth of the first & last slice boundary
+		static constexpr float FROXEL_FAR = 128.f;
+		static constexpr VkFormat MARCH_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+		static constexpr VkFormat MARCH_DEPTH_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+		enum class Mode : uint32_t
+		{
+			Froxels,
+			RayMarch
+		};
+
+		struct Settings
+		{
+			Mode mode = Mode::Froxels;
+			uint32_t resolutionDivisor = 2;	// of the ray march, 2 = half, 4 = quarter resolution
+			uint32_t marchSteps = 32;
+			bool useEmptySpaceSkipping = true;
+		};
+
+		// of the last finished ray march in this slot, read back from the GPU
+		struct MarchStats
+		{
+			uint32_t steps = 0;		// shadow segments evaluated
+			uint32_t texels = 0;	// texels that marched, the sky does not
+			float GetStepsPerTexel() const { return texels > 0 ? static_cast<float>(steps) / static_cast<float>(texels) : 0.f; }
+		};
+
 		// CTOR & DTOR
 		//----------------
-		VolumetricPass(Device& device, SwapChain& swapChain, uint32_t framesInFlight, LightingPass& lightingPass, ShadowPass& shadowPass);
+		VolumetricPass(Device& device, RingBuffer& ringBuffer, const FrameConstants& frameConstants, TransientImageAllocator& transientImages, SwapChain& swapChain, uint32_t framesInFlight, LightingPass& lightingPass, ShadowPass& shadowPass);
 		~VolumetricPass();
 
 		VolumetricPass(const VolumetricPass&) = delete;
@@ -24,71 +64,122 @@ namespace cat
 
 		// METHODS
 		//-----------------
-		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, Camera camera, Scene& scene) const;
+		// fills the froxel volumes from the shadow map, then composites them over the lit image into this frame's volumetric image
+		void AddToGraph(RenderGraph& graph, uint32_t frameIndex);
+		void RecordInject(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t uboOffset, const Pipeline& pipeline) const;
+		void RecordIntegrate(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t uboOffset) const;
+		// setIndex picks the history the ray march writes, see GetSetIndex
+		void RecordMarch(VkCommandBuffer commandBuffer, uint32_t setIndex, uint32_t uboOffset, const Pipeline& pipeline) const;
+		void Record(VkCommandBuffer commandBuffer, uint32_t setIndex, uint32_t uboOffset, const Pipeline& pipeline) const;
+		// requests the volumetric images at the new size, the transient images have to be cleared before & allocated after
 		void Resize(VkExtent2D size);
+		// points the samplers at the current lit, depth & froxel images, call after every transient allocation
+		void UpdateDescriptors();
 
 		// Getters & Setters
-		const std::vector<std::unique_ptr<Image>>& GetVolumetricImages() const { return m_pVolumetricImages; }
+		Image& GetVolumetricImage(uint32_t idx) const { return m_TransientImages.GetImage(m_VolumetricImages[idx]); }
+		const Settings& GetSettings() const { return m_Settings; }
+		const MarchStats& GetMarchStats() const { return m_MarchStats; }
+		// a new divisor recreates the ray march images, waits for the device & returns true
+		bool SetSettings(const Settings& settings);
 		void ToggleUseMultiScattering()
 		{
 			m_UseMultiScattering = !m_UseMultiScattering;
 			std::cout << "Using multiscattering: " << m_UseMultiScattering << std::endl;
 		}
+		void SetUseMultiScattering(bool useMultiScattering) { m_UseMultiScattering = useMultiScattering; }
 
 	private:
 		// PRIVATE METHODS
 		//-----------------
-		void CreateBuffers();
+		void RequestImages();
+		void CreateVolumes();
+		void CreateMarchImages();
+		void CreateMarchCounters();
+		void ReadMarchStats(uint32_t frameIndex);
+		// one descriptor set per frame in flight & history the ray march writes
+		static uint32_t GetSetIndex(uint32_t frameIndex, uint32_t historyIndex) { return frameIndex * 2 + historyIndex; }
 		void CreatePipeline();
 		void CreateDescriptors();
+		// the specialization constants of the pipelines for the current settings, see shaders/froxels.glsl
+		PipelineVariants::Constants GetCompositeConstants() const;
+		PipelineVariants::Constants GetInjectConstants() const;
+		PipelineVariants::Constants GetMarchConstants() const;
 
 
 		// PRIVATE MEMBERS
 		//-----------------
 		Device& m_Device;
+		RingBuffer& m_RingBuffer;
+		const FrameConstants& m_FrameConstants;
+		TransientImageAllocator& m_TransientImages;
 		const uint32_t m_FramesInFlight;
 		SwapChain& m_SwapChain;
 		VkExtent2D m_Extent;
 
 		std::string m_VertPath = "shaders/triangle.vert.spv";
 		std::string m_FragPath = "shaders/volumetric.frag.spv";
-		Pipeline* m_pPipeline;
+		std::string m_InjectPath = "shaders/froxel_inject.comp.spv";
+		std::string m_IntegratePath = "shaders/froxel_integrate.comp.spv";
+		std::string m_MarchPath = "shaders/volumetric_march.comp.spv";
+		std::unique_ptr<PipelineVariants> m_pCompositePipelines;
+		std::unique_ptr<PipelineVariants> m_pInjectPipelines;
+		std::unique_ptr<Pipeline> m_pIntegratePipeline;
+		std::unique_ptr<PipelineVariants> m_pMarchPipelines;
 
 		DescriptorSetLayout* m_pDescriptorSetLayout;
 		DescriptorPool* m_pDescriptorPool;
 		DescriptorSet* m_pDescriptorSet;
+		std::unique_ptr<DescriptorSetLayout> m_pFroxelDescriptorSetLayout;	// shared by inject & integrate
+		std::unique_ptr<DescriptorSet> m_pFroxelDescriptorSet;
+		std::unique_ptr<DescriptorSetLayout> m_pMarchDescriptorSetLayout;
+		std::unique_ptr<DescriptorSet> m_pMarchDescriptorSet;
+
+		// one of each per frame in flight
+		std::vector<std::unique_ptr<Image>> m_pScatteringVolumes;	// rgb = in-scattering, a = extinction
+		std::vector<std::unique_ptr<Image>> m_pIntegratedVolumes;	// rgb = scattering, a = transmittance from the camera
+
+		// ray march history, written & read in turns
+		std::array<std::unique_ptr<Image>, 2> m_pMarchColors;		// rgb = scattering, a = transmittance
+		std::array<std::unique_ptr<Image>, 2> m_pMarchDepths;		// view depth of every texel
+		VkExtent2D m_MarchExtent{};
+		uint32_t m_HistoryIndex = 0;	// written last
+		bool m_IsHistoryValid = false;
+		uint32_t m_FrameCounter = 0;
+
+		struct MarchCounters
+		{
+			uint32_t steps;
+			uint32_t texels;
+		};
+		std::vector<std::unique_ptr<Buffer>> m_pMarchCounters;	// per frame in flight
+		std::vector<bool> m_HasMarched;							// the counters of the slot hold a march
+		MarchStats m_MarchStats{};
+
+		Settings m_Settings{};
 		ShadowPass& m_ShadowPass;
 		LightingPass& m_LightingPass;
 
 		bool m_UseMultiScattering = true;
 		struct alignas(16) VolumetricsUbo
 		{
-			glm::mat4 invViewProj;
-			glm::mat4 lightViewProj;
+			glm::uvec4 gridSize;	// xyz = froxels
 
-			glm::vec3 camPos;
-			float _padding1;
-
-			glm::vec3 lightDir;
-			float _padding2;
-			glm::vec3 lightColor;
-			float lightIntensity;
-			float volumetricDensity;
-
-			float stepSize;
-			int numSteps;
+			float fogDensity;
+			float froxelNear;
+			float froxelFar;
+			float fogPhaseK;
 
 			float rayStrength;
-			float rayDecay;
 			float rayDensity;
-			float rayWeight;
-
-			int useMultiScattering = 0;
 			float multiScatterStrength;
-			float _padding3[3];
+			uint32_t frameCounter;
+
+			glm::uvec2 marchSize;
+			uint32_t isHistoryValid;
+			float historyWeight;
 		};
-		std::unique_ptr<UniformBuffer<VolumetricsUbo>> m_pUniformBuffer;
 
-		std::vector<std::unique_ptr<Image>> m_pVolumetricImages;
+		std::vector<TransientImageAllocator::ImageHandle> m_VolumetricImages;
 	};
 }
@@ -21,10 +21,13 @@ void cat::Camera::Update(float deltaTime)
 	if (m_Window.GetFrameBufferResized())
 		UpdateAspectRatio(); 
 
-	// Handle Input
+	// Handle Input, there is none headless
 	//-----------------
-	HandleKeyboardInput(deltaTime);
-	HandleMouseInput();
+	if (!m_Window.IsHeadless())
+	{
+		HandleKeyboardInput(deltaTime);
+		HandleMouseInput();
+	}
 
 
 	// UPDATING VECTORS
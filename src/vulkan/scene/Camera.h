@@ -73,6 +73,18 @@ namespace cat
 			m_TotalYaw = yaw;
 			UpdateVectors();
 		}
+		float GetPitch() const { return m_TotalPitch; }
+		float GetYaw() const { return m_TotalYaw; }
+
+		// in degrees like SetPitchYaw, see CameraPath
+		void SetPose(glm::vec3 origin, float pitch, float yaw)
+		{
+			m_Origin = origin;
+			m_TotalPitch = pitch;
+			m_TotalYaw = yaw;
+			m_IsPositionDirty = true;
+			UpdateVectors();
+		}
 
 		Specifications GetSpecs() const { return m_Specs; }	
 		void SetSpecs(const Specifications& specs)
@@ -0,0 +1,114 @@
+#include "CameraPath.h"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace cat
+{
+	// Methods
+	//--------------------
+	void CameraPath::AddSample(float time, Camera& camera)
+	{
+		Sample sample{};
+		sample.time = time;
+		sample.origin = camera.GetOrigin();
+		sample.pitch = camera.GetPitch();
+		sample.yaw = camera.GetYaw();
+		sample.specs = camera.GetSpecs();
+		m_Samples.push_back(sample);
+	}
+
+	CameraPath::Sample CameraPath::Evaluate(float time) const
+	{
+		if (m_Samples.empty())
+			throw std::runtime_error("failed to evaluate camera path, it has no samples!");
+
+		const auto next = std::upper_bound(m_Samples.begin(), m_Samples.end(), time,
+			[](float t, const Sample& sample) { return t < sample.time; });
+		if (next == m_Samples.begin()) return m_Samples.front();
+		if (next == m_Samples.end()) return m_Samples.back();
+
+		// the specifications change in steps, only the pose is blended
+		const Sample& previous = *(next - 1);
+		const float t = (time - previous.time) / std::max(next->time - previous.time, 1e-6f);
+
+		Sample sample = previous;
+		sample.time = time;
+		sample.origin = glm::mix(previous.origin, next->origin, t);
+		sample.pitch = glm::mix(previous.pitch, next->pitch, t);
+		sample.yaw = glm::mix(previous.yaw, next->yaw, t);
+		return sample;
+	}
+
+	void CameraPath::Apply(const Sample& sample, Camera& camera)
+	{
+		Camera::Specifications specs = sample.specs;
+		specs.aspectRatio = camera.GetSpecs().aspectRatio;
+		camera.SetSpecs(specs);
+		camera.SetPose(sample.origin, sample.pitch, sample.yaw);
+	}
+
+	void CameraPath::Save(const std::string& filename) const
+	{
+		std::ofstream file(filename);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open camera path " + filename + "!");
+
+		file << "Time(s),OriginX,OriginY,OriginZ,Pitch,Yaw,Fovy,NearPlane,FarPlane,Aperture,ShutterSpeed,ISO\n";
+		file << std::setprecision(9);
+		for (const Sample& sample : m_Samples)
+		{
+			file << sample.time << "," << sample.origin.x << "," << sample.origin.y << "," << sample.origin.z << ","
+				<< sample.pitch << "," << sample.yaw << "," << sample.specs.fovy << "," << sample.specs.nearPlane << ","
+				<< sample.specs.farPlane << "," << sample.specs.aperture << "," << sample.specs.shutterSpeed << "," << sample.specs.iso << "\n";
+		}
+	}
+
+	CameraPath CameraPath::Load(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open camera path " + filename + "!");
+
+		CameraPath path{};
+		std::string line;
+		std::getline(file, line); // header
+		while (std::getline(file, line))
+		{
+			if (line.empty()) continue;
+
+			std::stringstream ss(line);
+			std::string value;
+			std::vector<float> values{};
+			while (std::getline(ss, value, ','))
+			{
+				values.push_back(std::stof(value));
+			}
+			if (values.size() != 12)
+				throw std::runtime_error("failed to load camera path " + filename + ", a sample needs 12 values!");
+
+			Sample sample{};
+			sample.time = values[0];
+			sample.origin = { values[1], values[2], values[3] };
+			sample.pitch = values[4];
+			sample.yaw = values[5];
+			sample.specs.fovy = values[6];
+			sample.specs.nearPlane = values[7];
+			sample.specs.farPlane = values[8];
+			sample.specs.aperture = values[9];
+			sample.specs.shutterSpeed = values[10];
+			sample.specs.iso = values[11];
+			path.m_Samples.push_back(sample);
+		}
+
+		if (path.IsEmpty())
+			throw std::runtime_error("failed to load camera path " + filename + ", it has no samples!");
+		if (!std::is_sorted(path.m_Samples.begin(), path.m_Samples.end(), [](const Sample& a, const Sample& b) { return a.time < b.time; }))
+			throw std::runtime_error("failed to load camera path " + filename + ", the samples are not in time order!");
+		return path;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Camera.h"
+
+// std
+#include <string>
+#include <vector>
+
+namespace cat
+{
+	// A camera flight recorded once per frame & replayed at fixed time steps, so benchmarks render the same views every run.
+	//	- the samples keep the wall clock time they were recorded at, replay interpolates between them,
+	//	- saved as CSV, one sample per line: time, origin, pitch, yaw & the camera specifications.
+	class CameraPath final
+	{
+	public:
+		static constexpr float REPLAY_TIME_STEP = 1.f / 60.f;	// seconds of path time per replayed frame
+
+		struct Sample
+		{
+			float time = 0.f;	// seconds since the recording started
+			glm::vec3 origin{ 0.f };
+			float pitch = 0.f;
+			float yaw = 0.f;
+			Camera::Specifications specs{};	// the aspect ratio is the one of the replaying window
+		};
+
+		// Methods
+		//--------------------
+		void AddSample(float time, Camera& camera);
+		// between the two samples around time, clamped to the first & last one
+		Sample Evaluate(float time) const;
+		// moves the camera to the sample, keeping its aspect ratio
+		static void Apply(const Sample& sample, Camera& camera);
+
+		void Save(const std::string& filename) const;
+		static CameraPath Load(const std::string& filename);
+
+		// Getters & Setters
+		bool IsEmpty() const { return m_Samples.empty(); }
+		size_t GetSampleCount() const { return m_Samples.size(); }
+		float GetDuration() const { return m_Samples.empty() ? 0.f : m_Samples.back().time; }
+
+	private:
+		std::vector<Sample> m_Samples{};	// by increasing time
+	};
+}
@@ -54,7 +54,107 @@ namespace cat
 
 		CreateTextureSampler(filter, VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
-		DebugLabel::NameImage(m_Image,"TEXTURE: " + filename);
+		SetName("TEXTURE: " + filename);
+	}
+
+	Image::Image(Device& device, VkImage externalImage, uint32_t width, uint32_t height, VkFormat format, VkFilter filter)
+		: m_Device(device), m_Image(externalImage), m_Allocation(VK_NULL_HANDLE),
+		m_ImageView(VK_NULL_HANDLE), m_Format(format), m_MipLevels(1)
+	{
+		// without an allocation vmaDestroyImage only destroys the handle, so the destructor needs no special case
+		CreateTextureImageView();
+		CreateTextureSampler(filter, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+		m_Extent = VkExtent2D{ width, height };
+	}
+
+	Image::Image(Device& device, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t layerCount)
+		: m_Device(device), m_Image(VK_NULL_HANDLE), m_Allocation(VK_NULL_HANDLE),
+		m_ImageView(VK_NULL_HANDLE), m_Format(format), m_MipLevels(mipLevels), m_LayerCount(layerCount)
+	{
+		CreateImage(width, height, m_MipLevels, format, usage, memoryUsage, m_LayerCount);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_Image;
+		viewInfo.viewType = m_LayerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_Format;
+		viewInfo.subresourceRange = GetSubresourceRange();
+
+		if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_ImageView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create image view!");
+		}
+
+		m_MipImageViews.resize(m_MipLevels);
+		for (uint32_t level{ 0 }; level < m_MipLevels; ++level)
+		{
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_MipImageViews[level]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create mip image view!");
+			}
+		}
+
+		// reductions read exact texels, so no filtering between levels
+		CreateTextureSampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+		m_Extent = VkExtent2D{ width, height };
+	}
+
+	Image::Image(Device& device, uint32_t width, uint32_t height, VkFormat format, uint32_t layerCount, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage)
+		: m_Device(device), m_Image(VK_NULL_HANDLE), m_Allocation(VK_NULL_HANDLE),
+		m_ImageView(VK_NULL_HANDLE), m_Format(format), m_MipLevels(1), m_LayerCount(layerCount)
+	{
+		CreateImage(width, height, m_MipLevels, format, usage, memoryUsage, m_LayerCount);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = m_Format;
+		viewInfo.subresourceRange = GetSubresourceRange();
+
+		if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_ImageView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create image view!");
+		}
+
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		m_LayerImageViews.resize(m_LayerCount);
+		for (uint32_t layer{ 0 }; layer < m_LayerCount; ++layer)
+		{
+			viewInfo.subresourceRange.baseArrayLayer = layer;
+			viewInfo.subresourceRange.layerCount = 1;
+			if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_LayerImageViews[layer]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create layer image view!");
+			}
+		}
+
+		CreateTextureSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+		m_Extent = VkExtent2D{ width, height };
+	}
+
+	Image::Image(Device& device, VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage)
+		: m_Device(device), m_Image(VK_NULL_HANDLE), m_Allocation(VK_NULL_HANDLE),
+		m_ImageView(VK_NULL_HANDLE), m_Format(format), m_MipLevels(1), m_Depth(extent.depth)
+	{
+		CreateImage(extent.width, extent.height, m_MipLevels, format, usage, memoryUsage, 1, m_Depth);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+		viewInfo.format = m_Format;
+		viewInfo.subresourceRange = GetSubresourceRange();
+
+		if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_ImageView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create image view!");
+		}
+
+		CreateTextureSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+		m_Extent = VkExtent2D{ extent.width, extent.height };
 	}
 
 	Image::Image(Device& device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, VkImage existingImage)
@@ -72,6 +172,14 @@ namespace cat
 		{
 			vkDestroyImageView(m_Device.GetDevice(), m_ImageView, nullptr);
 		}
+		for (VkImageView mipView : m_MipImageViews)
+		{
+			vkDestroyImageView(m_Device.GetDevice(), mipView, nullptr);
+		}
+		for (VkImageView layerView : m_LayerImageViews)
+		{
+			vkDestroyImageView(m_Device.GetDevice(), layerView, nullptr);
+		}
 		if (!m_IsSwapchainImage)
 		{
 
@@ -96,17 +204,7 @@ namespace cat
 		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		barrier.image = m_Image;
 
-		if (HasDepth())
-		{
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			if (HasStencil()) barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
-		else barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = m_MipLevels;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange = GetSubresourceRange();
 		barrier.srcAccessMask = barrierInfo.srcAccessMask;
 		barrier.dstAccessMask = barrierInfo.dstAccessMask;
 
@@ -121,24 +219,31 @@ namespace cat
 		);
 
 		m_ImageLayout = newLayout;
+		m_SyncState = { static_cast<VkPipelineStageFlags>(barrierInfo.dstStageMask), static_cast<VkAccessFlags>(barrierInfo.dstAccessMask) };
+	}
+
+	void Image::SetName(const std::string& name)
+	{
+		m_Name = name;
+		DebugLabel::NameImage(m_Image, m_Name);
 	}
 
-	void Image::CreateImage(uint32_t width, uint32_t height, uint32_t miplevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage)
+	void Image::CreateImage(uint32_t width, uint32_t height, uint32_t miplevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t layerCount, uint32_t depth)
 	{
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.imageType = depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
 		imageInfo.extent.width = width;
 		imageInfo.extent.height = height;
-		imageInfo.extent.depth = 1;
+		imageInfo.extent.depth = depth;
 		imageInfo.mipLevels = miplevels;
-		imageInfo.arrayLayers = 1;
+		imageInfo.arrayLayers = layerCount;
 		imageInfo.format = format;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageInfo.usage = usage;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		m_Device.SetSharingMode(imageInfo);
 
 		VmaAllocationCreateInfo allocInfo{};
 		allocInfo.usage = memoryUsage;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "../Device.h"
 
@@ -18,11 +19,32 @@ namespace cat
 			VkAccessFlagBits dstAccessMask = VK_ACCESS_NONE;
 		};
 
+		// last stages & accesses that touched the image, kept across frames by the render graph
+		struct SyncState
+		{
+			VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags accessMask = VK_ACCESS_NONE;
+		};
+
 		// CTOR & DTOR
 		//--------------------
 		explicit Image(Device& device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, VkFilter filter = VK_FILTER_LINEAR);
 		Image(Device& device, const std::string& filename, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, VkFilter filter = VK_FILTER_LINEAR);
 
+		// Wraps an image whose memory was bound by someone else, e.g. the TransientImageAllocator.
+		// The image handle is destroyed with this object, its memory is not.
+		Image(Device& device, VkImage externalImage, uint32_t width, uint32_t height, VkFormat format, VkFilter filter = VK_FILTER_LINEAR);
+
+		// full mip chain without contents, e.g. for compute reductions. Every level gets its own view next to the one over the whole chain,
+		// with more than one layer all views are arrays over every layer
+		Image(Device& device, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t layerCount = 1);
+
+		// array of layerCount layers, e.g. shadow cascades. GetImageView() sees the whole array, GetLayerImageView() one layer to render to
+		Image(Device& device, uint32_t width, uint32_t height, VkFormat format, uint32_t layerCount, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage);
+
+		// 3D volume without contents, e.g. the froxel grids. Sampled with linear filtering & clamped on every axis
+		Image(Device& device, VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage);
+
 		//Used for swapchain only
 		Image(Device& device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, VkImage existingImage);
 		~Image();
@@ -35,6 +57,8 @@ namespace cat
 		// Methods
 		//--------------------
 		void TransitionImageLayout(VkCommandBuffer commandBuffer, const VkImageLayout& newLayout, const BarrierInfo& barrierInfo);
+		// names the image for debug tools & the render graph dump
+		void SetName(const std::string& name);
 
 		// Getters & Setters
 		VkImage GetImage()const { return m_Image; }
@@ -42,6 +66,37 @@ namespace cat
 		VkFormat GetFormat() const { return m_Format; }
 		VkSampler GetSampler()const { return  m_Sampler; }
 		VkExtent2D GetExtent() const { return m_Extent; }
+		uint32_t GetMipLevels() const { return m_MipLevels; }
+		VkImageView GetMipImageView(uint32_t level) const { return m_MipImageViews[level]; }
+		uint32_t GetLayerCount() const { return m_LayerCount; }
+		uint32_t GetDepth() const { return m_Depth; }	// slices of a 3D image
+		VkImageView GetLayerImageView(uint32_t layer) const { return m_LayerImageViews[layer]; }
+		const std::string& GetName() const { return m_Name; }
+		VkImageLayout GetLayout() const { return m_ImageLayout; }
+		void SetLayout(VkImageLayout layout) { m_ImageLayout = layout; }
+		const SyncState& GetSyncState() const { return m_SyncState; }
+		void SetSyncState(const SyncState& syncState) { m_SyncState = syncState; }
+
+		// images sharing (part of) this image's memory, their last use has to finish before this one is written
+		const std::vector<Image*>& GetAliases() const { return m_pAliases; }
+		void AddAlias(Image* pImage) { m_pAliases.push_back(pImage); }
+
+		VkImageSubresourceRange GetSubresourceRange() const
+		{
+			VkImageSubresourceRange range{};
+			if (HasDepth())
+			{
+				range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				if (HasStencil()) range.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+			}
+			else range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+			range.baseMipLevel = 0;
+			range.levelCount = m_MipLevels;
+			range.baseArrayLayer = 0;
+			range.layerCount = m_LayerCount;
+			return range;
+		}
 
 		bool HasDepth() const
 		{
@@ -81,7 +136,7 @@ namespace cat
 	private:
 		// Private Methods
 		//--------------------
-		void CreateImage(uint32_t width, uint32_t height, uint32_t miplevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage);
+		void CreateImage(uint32_t width, uint32_t height, uint32_t miplevels, VkFormat format, VkImageUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t layerCount = 1, uint32_t depth = 1);
 		void CreateTextureImageView();
 		void CreateTextureSampler(VkFilter filter, VkSamplerAddressMode addressMode);
 		void GenerateMipmaps(VkFormat format, uint32_t width, uint32_t height) const;
@@ -93,15 +148,22 @@ namespace cat
 		Device& m_Device;
 
 		std::string m_Path;
+		std::string m_Name;
 
 		VkImage m_Image;
 		VmaAllocation m_Allocation;
 		VkImageView m_ImageView;
+		std::vector<VkImageView> m_MipImageViews{};
+		std::vector<VkImageView> m_LayerImageViews{};
 		VkSampler m_Sampler;
 		uint32_t m_MipLevels{};
+		uint32_t m_LayerCount{ 1 };
+		uint32_t m_Depth{ 1 };
 
 		VkFormat m_Format;
 		VkImageLayout m_ImageLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		SyncState m_SyncState{};
+		std::vector<Image*> m_pAliases{};
 		VkEvent m_ImageEvent{ VK_NULL_HANDLE };
 
 		VkExtent2D m_Extent{ 0, 0 };
@@ -20,13 +20,19 @@ namespace cat
 {
     // CTOR & DTOR
     //--------------------
-    Mesh::Mesh(Device& device, UniformBuffer<MatrixUbo>* ubo, DescriptorSetLayout* layout, DescriptorPool* pool,
+    Mesh::Mesh(Device& device, DescriptorSetLayout* layout, DescriptorPool* pool,
         const RawMeshData& meshData)
         : m_Device{ device }, m_Vertices{ meshData.vertices }, m_Indices{ meshData.indices }, m_Transform(meshData.transform)
     {
         CreateVertexBuffer();
         CreateIndexBuffer();
 
+        for (const Vertex& vertex : m_Vertices)
+        {
+            m_MinBounds = glm::min(m_MinBounds, vertex.pos);
+            m_MaxBounds = glm::max(m_MaxBounds, vertex.pos);
+        }
+
         m_Images.push_back(new Image(device, meshData.material.albedoPath.c_str(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO)); // albedo texture
         m_Images.push_back(new Image(device, meshData.material.normalPath.c_str(), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO)); // normal texture
         m_Images.push_back(new Image(device, meshData.material.specularPath.c_str(), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO)); // normal texture
@@ -60,6 +66,14 @@ namespace cat
             vkCmdDraw(commandBuffer, m_VertexCount, 1, 0, 0);
     }
 
+    void Mesh::DrawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, VkDeviceSize offset)
+    {
+        if (m_HasIndexBuffer)
+            vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+        else
+            vkCmdDrawIndirect(commandBuffer, indirectBuffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
     void Mesh::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t idx, bool isDepthPass)
     {
         if (!isDepthPass)
@@ -10,6 +10,7 @@
 
 // std
 #include <array>
+#include <cfloat>
 #include <memory>
 
 namespace cat
@@ -101,7 +102,7 @@ namespace cat
 
         // CTOR & DTOR
         //--------------------
-        Mesh(Device& device, UniformBuffer<MatrixUbo>* ubo,
+        Mesh(Device& device,
             DescriptorSetLayout* layout, DescriptorPool* pool,
             const RawMeshData& meshData);
         ~Mesh();
@@ -114,6 +115,9 @@ namespace cat
         // Methods
         //--------------------
         void Draw(VkCommandBuffer commandBuffer);
+        // draws with the command at offset, laid out as a VkDrawIndexedIndirectCommand with firstIndex & vertexOffset 0,
+        // so its first fields also read as the VkDrawIndirectCommand of a mesh without indices
+        void DrawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, VkDeviceSize offset);
         void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t idx, bool isDepthPass);
 
         // Getters & Setters
@@ -124,6 +128,10 @@ namespace cat
         std::vector<uint32_t>GetIndices()const { return  m_Indices; }
 
         const glm::mat4& GetTransform() const { return m_Transform; }
+        // bounds of the vertices in model space
+        std::pair<glm::vec3, glm::vec3> GetBounds() const { return { m_MinBounds, m_MaxBounds }; }
+        // indices to draw, or vertices for a mesh without an index buffer
+        uint32_t GetElementCount() const { return m_HasIndexBuffer ? m_IndexCount : m_VertexCount; }
 
 
     private:
@@ -151,6 +159,8 @@ namespace cat
         std::vector<Image*> m_Images;
 
         const glm::mat4 m_Transform = glm::mat4(1.0f);
+        glm::vec3 m_MinBounds = glm::vec3(FLT_MAX);
+        glm::vec3 m_MaxBounds = glm::vec3(-FLT_MAX);
 
     };
 }
\ No newline at end of file
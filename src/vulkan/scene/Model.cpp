@@ -10,9 +10,8 @@ namespace cat
 	// CTOR & DTOR
 	//--------------------
 
-	Model::Model(Device& device, UniformBuffer<MatrixUbo>* ubo, const std::string& path)
+	Model::Model(Device& device, const std::string& path)
 		: m_Device{ device },
-		m_pUniformBuffer{ ubo },
 		m_Path(path), m_Directory{ path }
 	{
 		LoadModel(path);
@@ -20,7 +19,6 @@ namespace cat
 		// Create descriptor pool
 		m_pDescriptorPool = new DescriptorPool(device);
 		m_pDescriptorPool
-			->AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(m_RawMeshes.size() * cat::MAX_FRAMES_IN_FLIGHT))
 			->AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 				static_cast<uint32_t>(m_RawMeshes.size() * cat::MAX_FRAMES_IN_FLIGHT) * m_Material.amount);
 		m_pDescriptorPool = m_pDescriptorPool->Create(static_cast<uint32_t>(m_RawMeshes.size() * cat::MAX_FRAMES_IN_FLIGHT));
@@ -41,13 +39,13 @@ namespace cat
 		{
 			if (data.opaque)
 			{
-				m_OpaqueMeshes.push_back(new Mesh(m_Device, ubo,
+				m_OpaqueMeshes.push_back(new Mesh(m_Device,
 					m_pDescriptorSetLayout, m_pDescriptorPool,
 					data));
 			}
 			else
 			{
-				m_TransparentMeshes.push_back(new Mesh(m_Device, ubo,
+				m_TransparentMeshes.push_back(new Mesh(m_Device,
 					m_pDescriptorSetLayout, m_pDescriptorPool,
 					data));
 			}
@@ -25,7 +25,7 @@ namespace cat
 
 		// CTOR & DTOR
 		//--------------------
-		Model(Device& device, UniformBuffer<MatrixUbo>* ubo, const std::string& path);
+		Model(Device& device, const std::string& path);
 		~Model();
 
 		Model(const Model&) = delete;
@@ -85,7 +85,6 @@ namespace cat
 		// Private Datamembers
 		//--------------------
 		Device& m_Device;
-		UniformBuffer<MatrixUbo>* m_pUniformBuffer;
 		DescriptorSetLayout* m_pDescriptorSetLayout;
 		DescriptorPool* m_pDescriptorPool;
 
@@ -1,11 +1,15 @@
 #include "Scene.h"
 
+// std
+#include <algorithm>
+#include <cmath>
+
 namespace cat
 {
 	// CTOR & DTOR
 	//--------------------
-	Scene::Scene(Device& device, UniformBuffer<MatrixUbo>* ubo)
-		: m_Device{ device }, m_pUniformBuffer(ubo), m_DirectionalLight({})
+	Scene::Scene(Device& device)
+		: m_Device{ device }, m_DirectionalLight({})
 	{
 		m_MinBounds = glm::vec3(FLT_MAX);
 		m_MaxBounds = glm::vec3(-FLT_MAX);
@@ -32,6 +36,9 @@ namespace cat
 		m_MinBounds = glm::vec3(FLT_MAX);
 		m_MaxBounds = glm::vec3(-FLT_MAX);
 
+		std::vector<Caster> movedCasters;
+		movedCasters.reserve(m_pModels.size());
+
 		for (const auto& model : m_pModels)
 		{
 			auto [modelMin, modelMax] = model->GetBounds();
@@ -48,11 +55,17 @@ namespace cat
 				glm::vec3(transform * glm::vec4(modelMax.x, modelMax.y, modelMax.z, 1.0f))
 			};
 
+			glm::vec3 worldMin{ FLT_MAX };
+			glm::vec3 worldMax{ -FLT_MAX };
 			for (int i = 0; i < 8; ++i)
 			{
-				m_MinBounds = glm::min(m_MinBounds, corners[i]);
-				m_MaxBounds = glm::max(m_MaxBounds, corners[i]);
+				worldMin = glm::min(worldMin, corners[i]);
+				worldMax = glm::max(worldMax, corners[i]);
 			}
+			m_MinBounds = glm::min(m_MinBounds, worldMin);
+			m_MaxBounds = glm::max(m_MaxBounds, worldMax);
+
+			movedCasters.push_back({ model, transform, worldMin, worldMax });
 		}
 
 		if (m_pModels.empty())
@@ -61,64 +74,146 @@ namespace cat
 			m_MaxBounds = glm::vec3(1.0f, 1.0f, 1.0f);
 		}
 
-		glm::vec3 sceneCenter = (m_MinBounds + m_MaxBounds) * 0.5f;
-		glm::vec3 lightDirection = glm::normalize(m_DirectionalLight.direction);
-
-		std::vector<glm::vec3> corners = {
-			{ m_MinBounds.x, m_MinBounds.y, m_MinBounds.z } ,
-			{ m_MaxBounds.x, m_MinBounds.y, m_MinBounds.z },
-			{ m_MinBounds.x, m_MaxBounds.y, m_MinBounds.z },
-			{ m_MaxBounds.x, m_MaxBounds.y, m_MinBounds.z },
-			{ m_MinBounds.x, m_MinBounds.y, m_MaxBounds.z },
-			{ m_MaxBounds.x, m_MinBounds.y, m_MaxBounds.z },
-			{ m_MinBounds.x, m_MaxBounds.y, m_MaxBounds.z },
-			{ m_MaxBounds.x, m_MaxBounds.y, m_MaxBounds.z },
-		};
-
-
-		float minProj = FLT_MAX;
-		float maxProj = -FLT_MAX;
-
-		for (const auto& corner : corners)
+		//-- UPDATE MOVED CASTERS
+		// the old & new bounds of every model that was added, moved or removed since the last update
+		m_MovedCasterBounds.clear();
+		for (const auto& caster : movedCasters)
+		{
+			auto it = std::find_if(m_Casters.begin(), m_Casters.end(), [&](const Caster& previous) { return previous.pModel == caster.pModel; });
+			if (it == m_Casters.end())
+			{
+				m_MovedCasterBounds.push_back({ caster.worldMin, caster.worldMax });
+			}
+			else if (it->transform != caster.transform)
+			{
+				m_MovedCasterBounds.push_back({ it->worldMin, it->worldMax });
+				m_MovedCasterBounds.push_back({ caster.worldMin, caster.worldMax });
+			}
+		}
+		for (const auto& previous : m_Casters)
 		{
-			float proj = glm::dot(corner, lightDirection);
-			minProj = std::min(minProj, proj);
-			maxProj = std::max(maxProj, proj);
+			if (std::none_of(movedCasters.begin(), movedCasters.end(), [&](const Caster& caster) { return caster.pModel == previous.pModel; }))
+			{
+				m_MovedCasterBounds.push_back({ previous.worldMin, previous.worldMax });
+			}
 		}
+		m_Casters = std::move(movedCasters);
+	}
 
-		const float distance = maxProj - glm::dot(sceneCenter, lightDirection);
-		const glm::vec3 lightPosition = sceneCenter - lightDirection * distance;
+	void Scene::UpdateShadowCascades(Camera& camera)
+	{
+		const Camera::Specifications specs = camera.GetSpecs();
+		const float nearPlane = specs.nearPlane;
+		const float farPlane = std::min(specs.farPlane, m_CascadeSettings.shadowDistance);
+
+		// corners of the whole camera frustum, near (ndc z = 0) & far (ndc z = 1)
+		const glm::mat4 invViewProj = glm::inverse(camera.GetProjection() * camera.GetView());
+		std::array<glm::vec3, 4> nearCorners{};
+		std::array<glm::vec3, 4> farCorners{};
+		for (uint32_t i{ 0 }; i < 4; ++i)
+		{
+			const glm::vec2 ndc{ (i & 1) ? 1.f : -1.f, (i & 2) ? 1.f : -1.f };
+			const glm::vec4 nearCorner = invViewProj * glm::vec4(ndc, 0.f, 1.f);
+			const glm::vec4 farCorner = invViewProj * glm::vec4(ndc, 1.f, 1.f);
+			nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+			farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+		}
 
+		const glm::vec3 lightDirection = glm::normalize(m_DirectionalLight.direction);
 		const glm::vec3 up = glm::abs(glm::dot(lightDirection, glm::vec3(0.f, 1.f, 0.f))) < (1.f - FLT_EPSILON)
 			? glm::vec3(0.f, 1.f, 0.f)
 			: glm::vec3(0.f, 0.f, -1.f);
 
-		m_DirectionalLight.viewMatrix = glm::lookAtLH(lightPosition, sceneCenter, up);
-
-		glm::vec3 minLightSpace(FLT_MAX);
-		glm::vec3 maxLightSpace(-FLT_MAX);
-		for (const auto& corner : corners)
+		// a new light direction or grown scene bounds move every light volume, the near planes have to reach the new casters
+		const bool canKeepCascades = m_AreCascadesFitted
+			&& lightDirection == m_FittedLightDirection
+			&& glm::all(glm::greaterThanEqual(m_MinBounds, m_FittedMinBounds))
+			&& glm::all(glm::lessThanEqual(m_MaxBounds, m_FittedMaxBounds));
+		if (!canKeepCascades)
 		{
-			const glm::vec3 transformedCorner = glm::vec3(m_DirectionalLight.viewMatrix * glm::vec4(corner, 1.0f));
-			minLightSpace = glm::min(minLightSpace, transformedCorner);
-			maxLightSpace = glm::max(maxLightSpace, transformedCorner);
+			m_AreCascadesFitted = true;
+			m_FittedLightDirection = lightDirection;
+			m_FittedMinBounds = m_MinBounds;
+			m_FittedMaxBounds = m_MaxBounds;
 		}
 
+		const std::array<glm::vec3, 8> sceneCorners = {
+			glm::vec3{ m_FittedMinBounds.x, m_FittedMinBounds.y, m_FittedMinBounds.z },
+			glm::vec3{ m_FittedMaxBounds.x, m_FittedMinBounds.y, m_FittedMinBounds.z },
+			glm::vec3{ m_FittedMinBounds.x, m_FittedMaxBounds.y, m_FittedMinBounds.z },
+			glm::vec3{ m_FittedMaxBounds.x, m_FittedMaxBounds.y, m_FittedMinBounds.z },
+			glm::vec3{ m_FittedMinBounds.x, m_FittedMinBounds.y, m_FittedMaxBounds.z },
+			glm::vec3{ m_FittedMaxBounds.x, m_FittedMinBounds.y, m_FittedMaxBounds.z },
+			glm::vec3{ m_FittedMinBounds.x, m_FittedMaxBounds.y, m_FittedMaxBounds.z },
+			glm::vec3{ m_FittedMaxBounds.x, m_FittedMaxBounds.y, m_FittedMaxBounds.z },
+		};
+
+		const float cascadeCount = static_cast<float>(DirectionalLight::CASCADE_COUNT);
+		float sliceNear = nearPlane;
+		for (uint32_t cascade{ 0 }; cascade < DirectionalLight::CASCADE_COUNT; ++cascade)
+		{
+			// practical split scheme, a blend of the logarithmic & the uniform split
+			const float p = static_cast<float>(cascade + 1) / cascadeCount;
+			const float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+			const float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+			const float sliceFar = m_CascadeSettings.splitLambda * logSplit + (1.f - m_CascadeSettings.splitLambda) * uniformSplit;
+
+			// corners of the slice, along the rays of the frustum edges
+			std::array<glm::vec3, 8> sliceCorners{};
+			const float tNear = (sliceNear - nearPlane) / (specs.farPlane - nearPlane);
+			const float tFar = (sliceFar - nearPlane) / (specs.farPlane - nearPlane);
+			for (uint32_t i{ 0 }; i < 4; ++i)
+			{
+				sliceCorners[i] = glm::mix(nearCorners[i], farCorners[i], tNear);
+				sliceCorners[i + 4] = glm::mix(nearCorners[i], farCorners[i], tFar);
+			}
+
+			// a bounding sphere keeps the size of the cascade constant while the camera rotates, so it does not shimmer
+			glm::vec3 center{ 0.f };
+			for (const auto& corner : sliceCorners) center += corner;
+			center /= 8.f;
+
+			float radius = 0.f;
+			for (const auto& corner : sliceCorners) radius = std::max(radius, glm::length(corner - center));
+
+			// keep the last volume while the slice still fits inside it, so the cached shadow map stays valid
+			const glm::vec4& fittedSphere = m_DirectionalLight.cascadeSpheres[cascade];
+			m_DirectionalLight.cascadeSplits[cascade] = sliceFar;
+			sliceNear = sliceFar;
+			if (canKeepCascades && glm::length(center - glm::vec3(fittedSphere)) + radius <= fittedSphere.w)
+				continue;
+
+			// the padding gives the camera some room before the volume has to move
+			radius = std::ceil(radius * (1.f + m_CascadeSettings.fitPadding) * 16.f) / 16.f;
+			m_DirectionalLight.cascadeSpheres[cascade] = glm::vec4(center, radius);
+
+			const glm::mat4 view = glm::lookAtLH(center - lightDirection * radius, center, up);
 
-		constexpr float nearZ = 0.f;
-		const float farZ = maxLightSpace.z - minLightSpace.z;
-		m_DirectionalLight.projectionMatrix = glm::orthoLH(
-			minLightSpace.x, maxLightSpace.x,
-			minLightSpace.y, maxLightSpace.y,
-			nearZ, farZ		
-		);
-		m_DirectionalLight.projectionMatrix[1][1] *= -1.f;
+			// the volume reaches back to the scene bounds, so casters between the light & the slice are kept
+			float minZ = 0.f;
+			for (const auto& corner : sceneCorners)
+				minZ = std::min(minZ, (view * glm::vec4(corner, 1.f)).z);
+
+			glm::mat4 projection = glm::orthoLH(-radius, radius, -radius, radius, minZ, 2.f * radius);
+			projection[1][1] *= -1.f;
+
+			// snap the origin to whole texels, so the cascade only moves in texel steps
+			const float halfResolution = static_cast<float>(m_CascadeSettings.resolution) * 0.5f;
+			const glm::vec4 origin = projection * view * glm::vec4(0.f, 0.f, 0.f, 1.f);
+			const glm::vec2 texelOrigin = glm::vec2(origin) * halfResolution;
+			const glm::vec2 snapOffset = (glm::round(texelOrigin) - texelOrigin) / halfResolution;
+			projection[3][0] += snapOffset.x;
+			projection[3][1] += snapOffset.y;
+
+			m_DirectionalLight.cascadeViewProj[cascade] = projection * view;
+		}
 	}
 
 	Model* Scene::AddModel(const std::string& path)
 	{
-		Model* model = new Model(m_Device,m_pUniformBuffer,path);
+		Model* model = new Model(m_Device, path);
 		m_pModels.push_back(model);
+		RebuildDrawItems();
 
 		auto [modelMin, modelMax] = model->GetBounds();
 
@@ -142,6 +237,7 @@ namespace cat
 			delete* it;
 			m_pModels.erase(it, m_pModels.end());
 		}
+		RebuildDrawItems();
 	}
 
 	void Scene::UpdateDirectionalLight()
@@ -159,6 +255,7 @@ namespace cat
 	void Scene::AddPointLight(const PointLight& light)
 	{
 		m_PointLights.push_back(light);
+		MarkPointLightsDirty(static_cast<uint32_t>(m_PointLights.size() - 1), static_cast<uint32_t>(m_PointLights.size()));
 	}
 
 	void Scene::RemovePointLight(const PointLight& light)
@@ -167,30 +264,122 @@ namespace cat
 			[&](const PointLight& l) { return l.position == light.position; });
 		if (it != m_PointLights.end())
 		{
+			// the lights behind the removed ones shift down
+			MarkPointLightsDirty(static_cast<uint32_t>(it - m_PointLights.begin()), static_cast<uint32_t>(m_PointLights.size()));
 			m_PointLights.erase(it, m_PointLights.end());
 		}
 	}
 
+	void Scene::SetPointLight(size_t index, const PointLight& light)
+	{
+		m_PointLights[index] = light;
+		MarkPointLightsDirty(static_cast<uint32_t>(index), static_cast<uint32_t>(index + 1));
+	}
+
+	void Scene::ClearPointLights()
+	{
+		// nothing is read past the light count, so there is nothing to upload
+		m_PointLights.clear();
+	}
+
+	void Scene::MarkPointLightsDirty(uint32_t first, uint32_t last)
+	{
+		if (m_DirtyPointLights.first >= m_DirtyPointLights.second)
+			m_DirtyPointLights = { first, last };
+		else
+			m_DirtyPointLights = { std::min(m_DirtyPointLights.first, first), std::max(m_DirtyPointLights.second, last) };
+	}
+
 	void Scene::Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx, bool isDepthPass) const
 	{
-		for (const auto& model : m_pModels)
-		{
-			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), model->GetTransform());
-			model->Draw(commandBuffer, pipelineLayout, frameIdx, isDepthPass);
-		}
+		DrawItems(commandBuffer, pipelineLayout, frameIdx, isDepthPass, m_DrawItems);
 	}
 
 	void Scene::DrawOpaque(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx,
 		bool isDepthPass) const
 	{
+		DrawItems(commandBuffer, pipelineLayout, frameIdx, isDepthPass, m_OpaqueDrawItems);
+	}
 
-		for (const auto& model : m_pModels)
+	void Scene::DrawItems(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx,
+		bool isDepthPass, std::span<const DrawItem> drawItems) const
+	{
+		const Model* pBoundModel = nullptr;
+		for (const auto& item : drawItems)
+		{
+			// items of one model are contiguous, so the transform only changes at model boundaries
+			if (item.pModel != pBoundModel)
+			{
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), item.pModel->GetTransform());
+				pBoundModel = item.pModel;
+			}
+
+			item.pMesh->Bind(commandBuffer, pipelineLayout, frameIdx, isDepthPass);
+			item.pMesh->Draw(commandBuffer);
+		}
+	}
+
+	void Scene::DrawItemsIndirect(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx,
+		bool isDepthPass, std::span<const DrawItem> drawItems, VkBuffer indirectBuffer, size_t firstCommand) const
+	{
+		const Model* pBoundModel = nullptr;
+		for (size_t i{ 0 }; i < drawItems.size(); ++i)
 		{
-			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), model->GetTransform());
-			for (auto mesh : model->GetOpaqueMeshes())
+			const DrawItem& item = drawItems[i];
+			if (item.pModel != pBoundModel)
+			{
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), item.pModel->GetTransform());
+				pBoundModel = item.pModel;
+			}
+
+			// culled items still bind, the GPU skips the draw with an instance count of 0
+			item.pMesh->Bind(commandBuffer, pipelineLayout, frameIdx, isDepthPass);
+			item.pMesh->DrawIndirect(commandBuffer, indirectBuffer, (firstCommand + i) * sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+
+	std::pair<glm::vec3, glm::vec3> Scene::DrawItem::GetWorldBounds() const
+	{
+		const glm::mat4& transform = *pModel->GetTransform();
+		const auto [boundsMin, boundsMax] = pMesh->GetBounds();
+
+		glm::vec3 worldMin{ FLT_MAX };
+		glm::vec3 worldMax{ -FLT_MAX };
+		for (uint32_t corner{ 0 }; corner < 8; ++corner)
+		{
+			const glm::vec3 point{
+				(corner & 1) ? boundsMax.x : boundsMin.x,
+				(corner & 2) ? boundsMax.y : boundsMin.y,
+				(corner & 4) ? boundsMax.z : boundsMin.z
+			};
+			const glm::vec3 worldPoint = glm::vec3(transform * glm::vec4(point, 1.f));
+			worldMin = glm::min(worldMin, worldPoint);
+			worldMax = glm::max(worldMax, worldPoint);
+		}
+		return { worldMin, worldMax };
+	}
+
+
+	// Private methods
+	//--------------------
+	void Scene::RebuildDrawItems()
+	{
+		m_DrawItems.clear();
+		m_OpaqueDrawItems.clear();
+		m_TransparentDrawItems.clear();
+
+		for (Model* model : m_pModels)
+		{
+			for (Mesh* mesh : model->GetOpaqueMeshes())
+			{
+				m_DrawItems.push_back({ model, mesh });
+				m_OpaqueDrawItems.push_back({ model, mesh });
+			}
+			for (Mesh* mesh : model->GetTransparentMeshes())
 			{
-				mesh->Bind(commandBuffer, pipelineLayout, frameIdx, isDepthPass);
-				mesh->Draw(commandBuffer);
+				m_DrawItems.push_back({ model, mesh });
+				m_TransparentDrawItems.push_back({ model, mesh });
 			}
 		}
 	}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "Camera.h"
 #include "HDRImage.h"
 #include "Model.h"
 #include "../Pipeline.h"
 
+#include <array>
+#include <span>
 #include <vector>
 
 namespace cat
@@ -22,18 +25,40 @@ namespace cat
 
 		struct DirectionalLight
 		{
+			static constexpr uint32_t CASCADE_COUNT = 4;
+
 			glm::vec3 direction = { 0.f,-1.f,0.f };
 			glm::vec3 color {1.0f};
 			float intensity = 5.f;
 
-			// should be updated
-			glm::mat4 viewMatrix = glm::mat4(1.0f);
-			glm::mat4 projectionMatrix = glm::mat4(1.0f);
+			// fitted to the camera frustum by UpdateShadowCascades
+			std::array<glm::mat4, CASCADE_COUNT> cascadeViewProj{};
+			std::array<float, CASCADE_COUNT> cascadeSplits{};	// view space far distance of every cascade
+			std::array<glm::vec4, CASCADE_COUNT> cascadeSpheres{};	// world space sphere every volume was fitted around, xyz = center, w = radius
+		};
+
+		// how the camera frustum is split between the cascades
+		struct CascadeSettings
+		{
+			float splitLambda = 0.8f;		// 0 = uniform, 1 = logarithmic splits, in between the practical split scheme
+			float shadowDistance = 150.f;	// no shadows beyond, clamped to the camera's far plane
+			uint32_t resolution = 2048;		// of every cascade, used to snap the cascades to whole texels
+			float fitPadding = 0.1f;		// extra radius of every volume, a cascade is only refitted once its slice leaves the volume
+			float minCasterTexels = 1.f;	// casters smaller than this in the shadow map are skipped
+		};
+
+		struct DrawItem
+		{
+			Model* pModel;
+			Mesh* pMesh;
+
+			// world space box around the transformed mesh bounds
+			std::pair<glm::vec3, glm::vec3> GetWorldBounds() const;
 		};
 
 		// CTOR & DTOR
 		//--------------------
-		Scene(Device& device, UniformBuffer<MatrixUbo>* ubo);
+		explicit Scene(Device& device);
 		~Scene();
 
 		Scene(const Scene&) = delete;
@@ -50,32 +75,77 @@ namespace cat
 
 		void SetDirectionalLight(const DirectionalLight& light) { m_DirectionalLight = light; }
 		void UpdateDirectionalLight();
+		// splits the camera frustum & fits one texel snapped orthographic light volume around every slice,
+		// a volume is kept as long as its slice stays inside it
+		void UpdateShadowCascades(Camera& camera);
 		void AddPointLight(const PointLight& light);
 		void RemovePointLight(const PointLight& light);
+		void SetPointLight(size_t index, const PointLight& light);
+		void ClearPointLights();
 
 		void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx, bool isDepthPass = 0) const;
 		void DrawOpaque(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx, bool isDepthPass = 0) const;
+		void DrawItems(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx, bool isDepthPass, std::span<const DrawItem> drawItems) const;
+		// draws item i with the indirect command at index firstCommand + i, e.g. written by the Hi-Z culling
+		void DrawItemsIndirect(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint16_t frameIdx, bool isDepthPass, std::span<const DrawItem> drawItems,
+			VkBuffer indirectBuffer, size_t firstCommand) const;
 
 
 		// Getters & Setters
 		const std::vector<Model*> GetModels() const { return m_pModels; }
 		const DirectionalLight& GetDirectionalLight() const { return m_DirectionalLight; }
 		const std::vector<PointLight>& GetPointLights() const { return m_PointLights; }
+		// lights [first, second) changed since the last ClearDirtyPointLights, empty when first >= second
+		std::pair<uint32_t, uint32_t> GetDirtyPointLights() const { return m_DirtyPointLights; }
+		void ClearDirtyPointLights() { m_DirtyPointLights = { 0, 0 }; }
+		const std::vector<DrawItem>& GetDrawItems() const { return m_DrawItems; }
+		const std::vector<DrawItem>& GetOpaqueDrawItems() const { return m_OpaqueDrawItems; }
+		const std::vector<DrawItem>& GetTransparentDrawItems() const { return m_TransparentDrawItems; }
 		std::pair<glm::vec3, glm::vec3> GetSceneBounds() const { return { m_MinBounds, m_MaxBounds }; }
+		// world bounds of the models that were added, moved or removed by the last Update, before & after the move
+		const std::vector<std::pair<glm::vec3, glm::vec3>>& GetMovedCasterBounds() const { return m_MovedCasterBounds; }
 		void ToggleRotateDirectionalLight() { m_RotateDirectionalLight = !m_RotateDirectionalLight; }
+		const CascadeSettings& GetCascadeSettings() const { return m_CascadeSettings; }
+		void SetCascadeSettings(const CascadeSettings& settings) { m_CascadeSettings = settings; }
 
 	private:
+		// Private methods
+		//--------------------
+		void RebuildDrawItems();
+		void MarkPointLightsDirty(uint32_t first, uint32_t last);
+
 		// Private members
 		//--------------------
 		Device& m_Device;
-		UniformBuffer<MatrixUbo>* m_pUniformBuffer;
 		
 		std::vector<Model*> m_pModels;
+		std::vector<DrawItem> m_DrawItems;			// every mesh, opaque before transparent per model
+		std::vector<DrawItem> m_OpaqueDrawItems;
+		std::vector<DrawItem> m_TransparentDrawItems;
 		DirectionalLight m_DirectionalLight{};
+		CascadeSettings m_CascadeSettings{};
 		bool m_RotateDirectionalLight = false;
 		std::vector<PointLight> m_PointLights;
+		std::pair<uint32_t, uint32_t> m_DirtyPointLights{ 0, 0 };
 
 		glm::vec3 m_MinBounds{ FLT_MAX };
 		glm::vec3 m_MaxBounds{ -FLT_MAX };
+
+		// transforms of the last Update, to find the casters that moved
+		struct Caster
+		{
+			const Model* pModel;
+			glm::mat4 transform;
+			glm::vec3 worldMin;
+			glm::vec3 worldMax;
+		};
+		std::vector<Caster> m_Casters;
+		std::vector<std::pair<glm::vec3, glm::vec3>> m_MovedCasterBounds;
+
+		// what the current cascades were fitted to
+		glm::vec3 m_FittedLightDirection{ 0.f };
+		glm::vec3 m_FittedMinBounds{ 0.f };
+		glm::vec3 m_FittedMaxBounds{ 0.f };
+		bool m_AreCascadesFitted = false;
 	};
 }
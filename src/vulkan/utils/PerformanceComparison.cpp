@@ -0,0 +1,139 @@
+// PerformanceComparison.cpp
+#include "PerformanceComparison.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace cat
+{
+	PerformanceComparison::PerformanceComparison(const std::string& baselineFile, const std::string& candidateFile)
+		: m_Baseline{ LoadFrames(baselineFile) }, m_Candidate{ LoadFrames(candidateFile) }
+	{
+	}
+
+	std::vector<PerformanceComparison::Result> PerformanceComparison::Compare(const std::vector<std::string>& metrics, double thresholdPercent, double minDifferenceMs) const
+	{
+		if (metrics.empty())
+			throw std::runtime_error("failed to compare, there are no metrics!");
+		if (const std::string missing = GetMissingMetrics(m_Baseline, metrics); !missing.empty())
+			throw std::runtime_error("failed to compare, the baseline has no" + missing + "!");
+		if (const std::string missing = GetMissingMetrics(m_Candidate, metrics); !missing.empty())
+			throw std::runtime_error("failed to compare, the candidate has no" + missing + "!");
+
+		std::vector<Result> results;
+		for (const std::string& metric : metrics)
+		{
+			const auto baseline = m_Baseline.columns.find(metric);
+			const auto candidate = m_Candidate.columns.find(metric);
+
+			Result result{};
+			result.metric = metric;
+			result.baselineMean = CalculateMean(baseline->second);
+			result.candidateMean = CalculateMean(candidate->second);
+			result.difference = result.candidateMean - result.baselineMean;
+			result.confidence = CONFIDENCE_Z * std::sqrt(CalculateVariance(baseline->second) / static_cast<double>(baseline->second.size())
+				+ CalculateVariance(candidate->second) / static_cast<double>(candidate->second.size()));
+			result.changePercent = result.baselineMean > 0.0 ? result.difference / result.baselineMean * 100.0 : 0.0;
+			result.baseline = CalculatePercentiles(baseline->second);
+			result.candidate = CalculatePercentiles(candidate->second);
+
+			// slower beyond the threshold, beyond the noise & by more than a rounding error
+			result.isRegression = result.changePercent > thresholdPercent
+				&& result.difference - result.confidence > 0.0
+				&& result.difference > minDifferenceMs;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	void PerformanceComparison::OutputResults(const std::vector<Result>& results, double thresholdPercent)
+	{
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "Metric, baseline -> candidate mean (ms), difference +- 95% interval (ms), change, P50 / P99 baseline -> candidate (ms)" << std::endl;
+		for (const Result& result : results)
+		{
+			std::cout << (result.isRegression ? "REGRESSED " : "          ") << result.metric << ": "
+				<< result.baselineMean << " -> " << result.candidateMean << ", "
+				<< std::showpos << result.difference << std::noshowpos << " +- " << result.confidence << ", "
+				<< std::setprecision(1) << std::showpos << result.changePercent << std::noshowpos << "%, " << std::setprecision(3)
+				<< result.baseline.p50 << " / " << result.baseline.p99 << " -> " << result.candidate.p50 << " / " << result.candidate.p99 << std::endl;
+		}
+
+		const auto regressions = std::count_if(results.begin(), results.end(), [](const Result& result) { return result.isRegression; });
+		std::cout << regressions << " of " << results.size() << " metrics regressed by more than " << std::setprecision(1) << thresholdPercent << "%" << std::endl;
+	}
+
+	std::vector<std::string> PerformanceComparison::GetDefaultMetrics() const
+	{
+		const auto isDefault = [](const std::string& name)
+			{
+				const auto endsWith = [&name](const std::string& suffix)
+					{
+						return name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+					};
+				return std::find(std::begin(DEFAULT_METRICS), std::end(DEFAULT_METRICS), name) != std::end(DEFAULT_METRICS)
+					|| std::any_of(std::begin(DEFAULT_METRIC_SUFFIXES), std::end(DEFAULT_METRIC_SUFFIXES), endsWith);
+			};
+
+		std::vector<std::string> metrics;
+		std::copy_if(m_Baseline.names.begin(), m_Baseline.names.end(), std::back_inserter(metrics), isDefault);
+		return metrics;
+	}
+
+	std::string PerformanceComparison::GetMissingMetrics(const Run& run, const std::vector<std::string>& metrics)
+	{
+		std::string missing;
+		for (const std::string& metric : metrics)
+		{
+			const auto column = run.columns.find(metric);
+			if (column == run.columns.end() || column->second.empty())
+				missing += " " + metric;
+		}
+		return missing;
+	}
+
+	PerformanceComparison::Run PerformanceComparison::LoadFrames(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open performance CSV " + filename + "!");
+
+		std::string line;
+		if (!std::getline(file, line))
+			throw std::runtime_error("failed to read performance CSV " + filename + ", it is empty!");
+
+		Run run;
+		std::vector<std::string>& names = run.names;
+		std::stringstream header(line);
+		std::string name;
+		while (std::getline(header, name, ','))
+		{
+			names.push_back(name);
+		}
+
+		// the frames end at the blank line before the summary
+		auto& columns = run.columns;
+		while (std::getline(file, line) && !line.empty())
+		{
+			std::stringstream row(line);
+			std::string value;
+			for (size_t column{ 0 }; column < names.size() && std::getline(row, value, ','); ++column)
+			{
+				if (value.empty()) continue; // e.g. no camera path
+				try
+				{
+					columns[names[column]].push_back(std::stod(value));
+				}
+				catch (const std::exception&)
+				{
+					throw std::runtime_error("failed to read performance CSV " + filename + ", " + names[column] + " has the value " + value + "!");
+				}
+			}
+		}
+		return run;
+	}
+}
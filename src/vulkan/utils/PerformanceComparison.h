@@ -0,0 +1,71 @@
+// PerformanceComparison.h
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Statistics.h"
+
+namespace cat
+{
+	// Compares the per-frame columns of two PerformanceTimer CSVs, see compare_main.cpp
+	//  - a metric regressed when the candidate's mean is slower by more than the threshold & the 95% confidence
+	//    interval of the difference excludes zero, so noise alone does not fail a run,
+	//  - the interval is Welch's with the normal approximation, the runs have hundreds of frames,
+	//  - changes below a minimum in ms are ignored, a 0.01 ms pass is all noise,
+	//  - a compared metric missing from either run is an error, a renamed pass must not pass the gate unnoticed.
+	class PerformanceComparison final
+	{
+	public:
+		static constexpr double CONFIDENCE_Z = 1.96;   // 95%
+		static constexpr double DEFAULT_THRESHOLD_PERCENT = 5.0;
+		static constexpr double DEFAULT_MIN_DIFFERENCE_MS = 0.05;
+
+		// compared when no metrics are given, the frame & record totals plus every pass timing column, <pass>CPU(ms) & <pass>GPU(ms).
+		// The other (ms) columns are counters like PacerSleep(ms), where more can be better
+		static constexpr const char* DEFAULT_METRICS[] = { "FrameTime(ms)", "TotalRecord(ms)" };
+		static constexpr const char* DEFAULT_METRIC_SUFFIXES[] = { "CPU(ms)", "GPU(ms)" };
+
+		struct Result
+		{
+			std::string metric;
+			double baselineMean = 0.0;
+			double candidateMean = 0.0;
+			double difference = 0.0;        // candidate - baseline, positive is slower
+			double confidence = 0.0;        // half width of the interval around the difference
+			double changePercent = 0.0;     // of the baseline mean
+			Percentiles baseline{};
+			Percentiles candidate{};
+			bool isRegression = false;
+		};
+
+		// CTOR & DTOR
+		//--------------------
+		// throws std::runtime_error when a file cannot be read
+		PerformanceComparison(const std::string& baselineFile, const std::string& candidateFile);
+
+		// METHODS
+		//--------------------
+		// throws std::runtime_error when there are no metrics or one is missing from either run
+		std::vector<Result> Compare(const std::vector<std::string>& metrics, double thresholdPercent, double minDifferenceMs) const;
+		static void OutputResults(const std::vector<Result>& results, double thresholdPercent);
+
+		// Getters & Setters
+		// the baseline's columns of DEFAULT_METRICS & DEFAULT_METRIC_SUFFIXES, in header order
+		std::vector<std::string> GetDefaultMetrics() const;
+
+	private:
+		// the frame rows, up to the summary, by column name
+		struct Run
+		{
+			std::vector<std::string> names;     // header order
+			std::unordered_map<std::string, std::vector<double>> columns;
+		};
+		static Run LoadFrames(const std::string& filename);
+		// space separated, empty when the run has every metric
+		static std::string GetMissingMetrics(const Run& run, const std::vector<std::string>& metrics);
+
+		Run m_Baseline;
+		Run m_Candidate;
+	};
+}
@@ -1,26 +1,71 @@
 // PerformanceTimer.cpp
 #include "PerformanceTimer.h"
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <utility>
 
 namespace cat
 {
-    PerformanceTimer::PerformanceTimer()
+    namespace
     {
-        m_FrameMetrics.reserve(5000); // Pre-allocate for 5000 frames
+        // CSV columns of the summed pipeline statistics
+        constexpr std::array<std::pair<const char*, uint64_t PipelineStatistics::*>, 6> STATISTICS_COLUMNS{ {
+            { "IAVertices", &PipelineStatistics::inputVertices }, { "IAPrimitives", &PipelineStatistics::inputPrimitives },
+            { "VSInvocations", &PipelineStatistics::vertexInvocations }, { "ClippingPrimitives", &PipelineStatistics::clippingPrimitives },
+            { "FSInvocations", &PipelineStatistics::fragmentInvocations }, { "CSInvocations", &PipelineStatistics::computeInvocations } } };
     }
 
+    // Registry
+    //--------------------
+    PerformanceTimer::MetricId PerformanceTimer::RegisterPass(const std::string& name)
+    {
+        if (const MetricId existing = FindPass(name); existing != INVALID_METRIC)
+            return existing;
+        if (m_PassNames.size() >= MAX_PASSES)
+            throw std::runtime_error("failed to register pass " + name + ", the performance timer holds " + std::to_string(MAX_PASSES) + " passes!");
+
+        const auto id = static_cast<MetricId>(m_PassNames.size());
+        m_PassNames.push_back(name);
+        m_PassIds.emplace(name, id);
+        return id;
+    }
+
+    void PerformanceTimer::AddPassAlias(const std::string& renderGraphPass, MetricId pass)
+    {
+        m_PassIds[renderGraphPass] = pass;
+    }
+
+    PerformanceTimer::MetricId PerformanceTimer::RegisterCounter(const std::string& column)
+    {
+        const auto it = std::find(m_CounterNames.begin(), m_CounterNames.end(), column);
+        if (it != m_CounterNames.end())
+            return static_cast<MetricId>(std::distance(m_CounterNames.begin(), it));
+        if (m_CounterNames.size() >= MAX_COUNTERS)
+            throw std::runtime_error("failed to register counter " + column + ", the performance timer holds " + std::to_string(MAX_COUNTERS) + " counters!");
+
+        m_CounterNames.push_back(column);
+        return static_cast<MetricId>(m_CounterNames.size() - 1);
+    }
+
+
+    // Recording
+    //--------------------
     void PerformanceTimer::StartRecording(uint32_t maxFrames)
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsRecording = false;
+        m_CurrentFrame = nullptr;
 
-        m_IsRecording = true;
+        // every frame that can be recorded exists up front, EndFrame only publishes it
+        m_Frames.assign(maxFrames, FrameRecord{});
         m_MaxFrames = maxFrames;
         m_FrameCount = 0;
-        m_FrameMetrics.clear();
-        m_FrameMetrics.reserve(maxFrames);
+        m_IsRecording = true;
 
         std::cout << "\n=== PERFORMANCE RECORDING STARTED ===" << std::endl;
         std::cout << "Will record first " << maxFrames << " frames" << std::endl;
@@ -29,19 +74,23 @@ namespace cat
 
     void PerformanceTimer::StopRecording()
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
-
         if (!m_IsRecording) return;
 
         m_IsRecording = false;
+        m_CurrentFrame = nullptr;
         std::cout << "\n=== PERFORMANCE RECORDING STOPPED ===" << std::endl;
         std::cout << "Recorded " << m_FrameCount << " frames" << std::endl;
 
-        if (!m_FrameMetrics.empty())
+        if (m_FrameCount > 0)
         {
-            auto summary = CalculateSummary();
-            std::cout << "Average FPS: " << std::fixed << std::setprecision(1) << summary.avgFPS << std::endl;
-            std::cout << "Average frame time: " << std::setprecision(3) << summary.avgFrameTime << " ms" << std::endl;
+            const uint32_t count = m_FrameCount;
+            double totalTime = 0.0;
+            for (uint32_t frame{ 0 }; frame < count; ++frame)
+            {
+                totalTime += m_Frames[frame].frameTime;
+            }
+            std::cout << "Average FPS: " << std::fixed << std::setprecision(1) << 1000.0 * count / totalTime << std::endl;
+            std::cout << "Average frame time: " << std::setprecision(3) << totalTime / count << " ms" << std::endl;
         }
     }
 
@@ -62,36 +111,25 @@ namespace cat
     void PerformanceTimer::BeginFrame()
     {
         if (!m_IsRecording || m_FrameCount >= m_MaxFrames) return;
-        
+
         m_FrameStart = std::chrono::high_resolution_clock::now();
 
         // Reset current frame metrics
-        m_CurrentFrameMetrics = FrameMetrics();
-        m_CurrentFrameMetrics.frameNumber = m_FrameCount + 1;
+        m_CurrentFrame = &m_Frames[m_FrameCount];
+        *m_CurrentFrame = FrameRecord{};
+        m_CurrentFrame->frameNumber = m_FrameCount + 1;
     }
 
     void PerformanceTimer::EndFrame()
     {
-        if (!m_IsRecording || m_FrameCount >= m_MaxFrames) return;
+        if (!IsRecordingFrame()) return;
 
         auto frameEnd = std::chrono::high_resolution_clock::now();
-        m_CurrentFrameMetrics.frameTime = std::chrono::duration<double, std::milli>(frameEnd - m_FrameStart).count();
+        m_CurrentFrame->frameTime = std::chrono::duration<double, std::milli>(frameEnd - m_FrameStart).count();
 
-        // Calculate derived metrics
-        m_CurrentFrameMetrics.totalGpuTime = m_CurrentFrameMetrics.depthPrepassTime +
-            m_CurrentFrameMetrics.shadowPassTime +
-            m_CurrentFrameMetrics.geometryPassTime +
-            m_CurrentFrameMetrics.lightingPassTime +
-            m_CurrentFrameMetrics.volumetricPassTime +
-            m_CurrentFrameMetrics.blitPassTime;
-
-        m_CurrentFrameMetrics.cpuOverhead = m_CurrentFrameMetrics.frameTime - m_CurrentFrameMetrics.totalGpuTime;
-        m_CurrentFrameMetrics.fps = (m_CurrentFrameMetrics.frameTime > 0) ?
-            1000.0 / m_CurrentFrameMetrics.frameTime : 0.0;
-
-        // Store this frame's data
-        m_FrameMetrics.push_back(m_CurrentFrameMetrics);
-        m_FrameCount++;
+        // Publish this frame's data
+        m_CurrentFrame = nullptr;
+        m_FrameCount.fetch_add(1, std::memory_order_release);
 
         // Auto-stop if we've reached max frames
         if (m_FrameCount >= m_MaxFrames)
@@ -100,88 +138,107 @@ namespace cat
         }
     }
 
-    void PerformanceTimer::BeginPass(const std::string& passName)
+
+    // Summary
+    //--------------------
+    double PerformanceTimer::GetTotalCpuTime(const FrameRecord& frame) const
     {
-        if (!m_IsRecording || m_FrameCount >= m_MaxFrames) return;
+        return std::accumulate(frame.cpuTimes.begin(), frame.cpuTimes.begin() + m_PassNames.size(), 0.0);
+    }
 
-        m_CurrentPassName = passName;
-        m_PassStart = std::chrono::high_resolution_clock::now();
+    double PerformanceTimer::GetTotalGpuTime(const FrameRecord& frame) const
+    {
+        return std::accumulate(frame.gpuTimes.begin(), frame.gpuTimes.begin() + m_PassNames.size(), 0.0);
     }
 
-    void PerformanceTimer::EndPass(const std::string& passName)
+    std::vector<PerformanceTimer::Column> PerformanceTimer::GetColumns() const
     {
-        if (!m_IsRecording || m_FrameCount >= m_MaxFrames || passName != m_CurrentPassName) return;
+        using Frame = const FrameRecord&;
+        using Timer = const PerformanceTimer&;
+
+        std::vector<Column> columns;
+        columns.push_back({ "FrameTime(ms)", [](Frame frame, MetricId, Timer) { return frame.frameTime; } });
+        for (MetricId pass{ 0 }; pass < m_PassNames.size(); ++pass)
+        {
+            columns.push_back({ m_PassNames[pass] + "CPU(ms)", [](Frame frame, MetricId id, Timer) { return frame.cpuTimes[id]; }, pass });
+        }
+        for (MetricId pass{ 0 }; pass < m_PassNames.size(); ++pass)
+        {
+            columns.push_back({ m_PassNames[pass] + "GPU(ms)", [](Frame frame, MetricId id, Timer) { return frame.gpuTimes[id]; }, pass });
+        }
 
-        auto passEnd = std::chrono::high_resolution_clock::now();
-        double duration = std::chrono::duration<double, std::milli>(passEnd - m_PassStart).count();
+        // async compute passes overlap the others, so does their GPU time
+        columns.push_back({ "TotalRecord(ms)", [](Frame frame, MetricId, Timer timer) { return timer.GetTotalCpuTime(frame); } });
+        columns.push_back({ "TotalGPU(ms)", [](Frame frame, MetricId, Timer timer) { return timer.GetTotalGpuTime(frame); } });
+        columns.push_back({ "CPUOverhead(ms)", [](Frame frame, MetricId, Timer timer) { return frame.frameTime - timer.GetTotalCpuTime(frame); } });
+        columns.push_back({ "FPS", [](Frame frame, MetricId, Timer) { return frame.frameTime > 0.0 ? 1000.0 / frame.frameTime : 0.0; } });
 
-        // Update the appropriate pass time
-        double* metricPtr = GetPassMetricPtr(passName);
-        if (metricPtr)
+        for (MetricId counter{ 0 }; counter < m_CounterNames.size(); ++counter)
         {
-            *metricPtr = duration;
+            columns.push_back({ m_CounterNames[counter], [](Frame frame, MetricId id, Timer) { return frame.counters[id]; }, counter });
         }
-    }
 
-    double* PerformanceTimer::GetPassMetricPtr(const std::string& passName)
-    {
-        if (passName == "DepthPrepass") return &m_CurrentFrameMetrics.depthPrepassTime;
-        if (passName == "ShadowPass") return &m_CurrentFrameMetrics.shadowPassTime;
-        if (passName == "GeometryPass") return &m_CurrentFrameMetrics.geometryPassTime;
-        if (passName == "LightingPass") return &m_CurrentFrameMetrics.lightingPassTime;
-        if (passName == "VolumetricPass") return &m_CurrentFrameMetrics.volumetricPassTime;
-        if (passName == "BlitPass") return &m_CurrentFrameMetrics.blitPassTime;
-        return nullptr;
+        // pipeline statistics of all passes
+        for (MetricId field{ 0 }; field < STATISTICS_COLUMNS.size(); ++field)
+        {
+            columns.push_back({ STATISTICS_COLUMNS[field].first, [](Frame frame, MetricId id, Timer timer)
+                {
+                    uint64_t total = 0;
+                    for (size_t pass{ 0 }; pass < timer.m_PassNames.size(); ++pass)
+                    {
+                        total += frame.statistics[pass].*STATISTICS_COLUMNS[id].second;
+                    }
+                    return static_cast<double>(total);
+                }, field });
+        }
+        return columns;
     }
 
-    PerformanceTimer::SummaryStats PerformanceTimer::CalculateSummary() const
+    PerformanceTimer::SummaryStats PerformanceTimer::CalculateSummary(const std::vector<Column>& columns) const
     {
         SummaryStats stats;
 
-        if (m_FrameMetrics.empty()) return stats;
+        const uint32_t count = m_FrameCount.load(std::memory_order_acquire);
+        if (count == 0) return stats;
 
-        // Calculate frame time statistics
-        std::vector<double> frameTimes;
-        frameTimes.reserve(m_FrameMetrics.size());
-
-        for (const auto& frame : m_FrameMetrics)
+        // Per column statistics
+        std::vector<double> values(count);
+        for (const Column& column : columns)
         {
-            frameTimes.push_back(frame.frameTime);
-            stats.totalTime += frame.frameTime;
-
-            // Track min/max
-            if (frame.frameTime < stats.minFrameTime) stats.minFrameTime = frame.frameTime;
-            if (frame.frameTime > stats.maxFrameTime) stats.maxFrameTime = frame.frameTime;
-
-            // Sum pass times for averages
-            stats.avgDepthTime += frame.depthPrepassTime;
-            stats.avgShadowTime += frame.shadowPassTime;
-            stats.avgGeometryTime += frame.geometryPassTime;
-            stats.avgLightingTime += frame.lightingPassTime;
-            stats.avgVolumetricTime += frame.volumetricPassTime;
-            stats.avgBlitTime += frame.blitPassTime;
+            for (uint32_t frame{ 0 }; frame < count; ++frame)
+            {
+                values[frame] = column.get(m_Frames[frame], column.id, *this);
+            }
+
+            stats.averages.push_back(CalculateMean(values));
+            stats.minimums.push_back(*std::min_element(values.begin(), values.end()));
+            stats.maximums.push_back(*std::max_element(values.begin(), values.end()));
+            stats.deviations.push_back(std::sqrt(CalculateVariance(values)));
+            stats.percentiles.push_back(CalculatePercentiles(values));
         }
 
-        // Calculate averages
-        size_t count = m_FrameMetrics.size();
-        stats.avgFrameTime = stats.totalTime / count;
-        stats.avgFPS = 1000.0 / stats.avgFrameTime;
-
-        stats.avgDepthTime /= count;
-        stats.avgShadowTime /= count;
-        stats.avgGeometryTime /= count;
-        stats.avgLightingTime /= count;
-        stats.avgVolumetricTime /= count;
-        stats.avgBlitTime /= count;
+        // Frame time distribution, the first column
+        for (uint32_t frame{ 0 }; frame < count; ++frame)
+        {
+            const double frameTime = m_Frames[frame].frameTime;
+            const size_t bucket = std::min(static_cast<size_t>(frameTime / HISTOGRAM_BUCKET_MS), HISTOGRAM_BUCKETS - 1);
+            ++stats.frameTimeHistogram[bucket];
+            if (frameTime > STUTTER_FACTOR * stats.percentiles[0].p50) ++stats.stutterFrames;
+
+            for (size_t pass{ 0 }; pass < m_PassNames.size(); ++pass)
+            {
+                stats.totalPassStatistics[pass] += m_Frames[frame].statistics[pass];
+                stats.totalStatistics += m_Frames[frame].statistics[pass];
+            }
+        }
 
         return stats;
     }
 
     void PerformanceTimer::SaveToCSV(const std::string& filename, bool includeSummary)
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
-
-        if (m_FrameMetrics.empty())
+        const uint32_t count = m_FrameCount.load(std::memory_order_acquire);
+        if (count == 0)
         {
             std::cout << "No performance data to save!" << std::endl;
             return;
@@ -195,65 +252,91 @@ namespace cat
         }
 
         std::cout << "Saving performance data to: " << filename << std::endl;
-        std::cout << "Frames recorded: " << m_FrameMetrics.size() << std::endl;
+        std::cout << "Frames recorded: " << count << std::endl;
 
-        // Write CSV header
-        file << "Frame,FrameTime(ms),DepthPrepass(ms),ShadowPass(ms),GeometryPass(ms),"
-            << "LightingPass(ms),VolumetricPass(ms),BlitPass(ms),TotalGPU(ms),"
-            << "CPUOverhead(ms),FPS,Triangles,DrawCalls\n";
+        // Write CSV header, generated from the registry
+        const std::vector<Column> columns = GetColumns();
+        file << "Frame,CameraPathTime(s)";
+        for (const Column& column : columns)
+        {
+            file << "," << column.name;
+        }
+        file << "\n";
 
         // Write frame data (first X frames only)
-        for (const auto& frame : m_FrameMetrics)
+        file << std::fixed << std::setprecision(3);
+        for (uint32_t frame{ 0 }; frame < count; ++frame)
         {
-            file << frame.GetAsCSV() << "\n";
+            const FrameRecord& record = m_Frames[frame];
+            file << record.frameNumber << ",";
+            if (record.cameraPathTime >= 0.0) file << record.cameraPathTime;
+            for (const Column& column : columns)
+            {
+                file << "," << column.get(record, column.id, *this);
+            }
+            file << "\n";
         }
 
+        const SummaryStats stats = CalculateSummary(columns);
+
         // Optional: Add summary statistics
         if (includeSummary)
         {
-            auto stats = CalculateSummary();
+            double totalTime = 0.0;
+            for (uint32_t frame{ 0 }; frame < count; ++frame)
+            {
+                totalTime += m_Frames[frame].frameTime;
+            }
 
             file << "\n\nSUMMARY STATISTICS\n";
             file << "Metric,Value\n";
-            file << "Total Frames," << m_FrameMetrics.size() << "\n";
-            file << "Total Time (s)," << std::fixed << std::setprecision(3) << (stats.totalTime / 1000.0) << "\n";
-            file << "Average Frame Time (ms)," << stats.avgFrameTime << "\n";
-            file << "Min Frame Time (ms)," << stats.minFrameTime << "\n";
-            file << "Max Frame Time (ms)," << stats.maxFrameTime << "\n";
-            file << "Average FPS," << std::setprecision(1) << stats.avgFPS << "\n";
-            file << "\nAverage Pass Times (ms)\n";
-            file << "Depth Prepass," << std::setprecision(3) << stats.avgDepthTime << "\n";
-            file << "Shadow Pass," << stats.avgShadowTime << "\n";
-            file << "Geometry Pass," << stats.avgGeometryTime << "\n";
-            file << "Lighting Pass," << stats.avgLightingTime << "\n";
-            file << "Volumetric Pass," << stats.avgVolumetricTime << "\n";
-            file << "Blit Pass," << stats.avgBlitTime << "\n";
-            file << "Total GPU," << (stats.avgDepthTime + stats.avgShadowTime + stats.avgGeometryTime +
-                stats.avgLightingTime + stats.avgVolumetricTime + stats.avgBlitTime) << "\n";
-            file << "CPU Overhead," << (stats.avgFrameTime - (stats.avgDepthTime + stats.avgShadowTime +
-                stats.avgGeometryTime + stats.avgLightingTime +
-                stats.avgVolumetricTime + stats.avgBlitTime)) << "\n";
+            file << "Total Frames," << count << "\n";
+            file << "Total Time (s)," << (totalTime / 1000.0) << "\n";
+            file << "Stutter Frames (> " << std::setprecision(1) << STUTTER_FACTOR << "x median)," << stats.stutterFrames << "\n";
+
+            file << "\nMetric,Average,Min,Max,StdDev,P50,P90,P95,P99,P99.9\n" << std::setprecision(3);
+            for (size_t column{ 0 }; column < columns.size(); ++column)
+            {
+                const Percentiles& percentiles = stats.percentiles[column];
+                file << columns[column].name << "," << stats.averages[column] << "," << stats.minimums[column] << "," << stats.maximums[column] << ","
+                    << stats.deviations[column] << "," << percentiles.p50 << "," << percentiles.p90 << "," << percentiles.p95 << ","
+                    << percentiles.p99 << "," << percentiles.p999 << "\n";
+            }
+
+            file << "\nFrame Time Histogram (ms),Frames\n" << std::setprecision(1);
+            for (size_t bucket{ 0 }; bucket < HISTOGRAM_BUCKETS; ++bucket)
+            {
+                file << bucket * HISTOGRAM_BUCKET_MS << "-";
+                if (bucket + 1 < HISTOGRAM_BUCKETS) file << (bucket + 1) * HISTOGRAM_BUCKET_MS;
+                file << "," << stats.frameTimeHistogram[bucket] << "\n";
+            }
+
+            const auto writeStatistics = [&file, count](const std::string& name, const PipelineStatistics& total)
+                {
+                    file << name << "," << total.inputVertices / count << "," << total.inputPrimitives / count << ","
+                        << total.vertexInvocations / count << "," << total.clippingPrimitives / count << ","
+                        << total.fragmentInvocations / count << "," << total.computeInvocations / count << "\n";
+                };
+            file << "\nAverage Pipeline Statistics,IA Vertices,IA Primitives,VS Invocations,Clipping Primitives,FS Invocations,CS Invocations\n";
+            for (size_t pass{ 0 }; pass < m_PassNames.size(); ++pass)
+            {
+                writeStatistics(m_PassNames[pass], stats.totalPassStatistics[pass]);
+            }
+            writeStatistics("Total", stats.totalStatistics);
         }
 
         file.close();
 
-        // Print summary to console
-        auto stats = CalculateSummary();
+        // Print summary to console, the columns that were ever non zero
         std::cout << "\n=== PERFORMANCE SUMMARY ===" << std::endl;
-        std::cout << "Average FPS: " << std::fixed << std::setprecision(1) << stats.avgFPS << std::endl;
-        std::cout << "Average frame time: " << std::setprecision(3) << stats.avgFrameTime << " ms" << std::endl;
-        std::cout << "Frame time range: " << stats.minFrameTime << " - " << stats.maxFrameTime << " ms" << std::endl;
-        std::cout << "\nPass breakdown (ms):" << std::endl;
-        std::cout << "  Depth prepass: " << stats.avgDepthTime << std::endl;
-        std::cout << "  Shadow pass: " << stats.avgShadowTime << std::endl;
-        std::cout << "  Geometry pass: " << stats.avgGeometryTime << std::endl;
-        std::cout << "  Lighting pass: " << stats.avgLightingTime << std::endl;
-        std::cout << "  Volumetric pass: " << stats.avgVolumetricTime << std::endl;
-        std::cout << "  Blit pass: " << stats.avgBlitTime << std::endl;
-        std::cout << "  Total GPU: " << (stats.avgDepthTime + stats.avgShadowTime + stats.avgGeometryTime +
-            stats.avgLightingTime + stats.avgVolumetricTime + stats.avgBlitTime) << std::endl;
-        std::cout << "  CPU overhead: " << (stats.avgFrameTime - (stats.avgDepthTime + stats.avgShadowTime +
-            stats.avgGeometryTime + stats.avgLightingTime +
-            stats.avgVolumetricTime + stats.avgBlitTime)) << std::endl;
+        std::cout << "Metric: average, P50 / P99 / max" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (size_t column{ 0 }; column < columns.size(); ++column)
+        {
+            if (stats.maximums[column] == 0.0) continue;
+            std::cout << "  " << columns[column].name << ": " << stats.averages[column] << ", " << stats.percentiles[column].p50 << " / "
+                << stats.percentiles[column].p99 << " / " << stats.maximums[column] << std::endl;
+        }
+        std::cout << "Stutter frames: " << stats.stutterFrames << " over " << std::setprecision(1) << STUTTER_FACTOR << "x the median" << std::endl;
     }
-}
\ No newline at end of file
+}
@@ -1,83 +1,113 @@
 // PerformanceTimer.h
 #pragma once
+#include <array>
 #include <chrono>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <fstream>
-#include <iomanip>
 #include <atomic>
-#include <mutex>
+
+#include "Statistics.h"
 
 namespace cat
 {
-    struct FrameMetrics
+    // Pipeline statistics queries of a pass, in the order Vulkan returns them
+    struct PipelineStatistics
     {
-        uint32_t frameNumber = 0;
-        double frameTime = 0.0;         // Total frame time (ms)
-        double depthPrepassTime = 0.0;  // Depth prepass GPU time
-        double shadowPassTime = 0.0;    // Shadow pass GPU time
-        double geometryPassTime = 0.0;  // Geometry pass GPU time
-        double lightingPassTime = 0.0;  // Lighting pass GPU time
-        double volumetricPassTime = 0.0;// Volumetric pass GPU time
-        double blitPassTime = 0.0;      // Blit pass GPU time
-        double totalGpuTime = 0.0;      // Sum of all pass times
-        double cpuOverhead = 0.0;       // Frame time - total GPU time
-        double fps = 0.0;               // Calculated FPS
-        uint32_t triangleCount = 0;     // Triangles rendered
-        uint32_t drawCalls = 0;         // Number of draw calls
-        
-        std::string GetAsCSV() const
+        uint64_t inputVertices = 0;         // Input assembly vertices
+        uint64_t inputPrimitives = 0;       // Input assembly primitives
+        uint64_t vertexInvocations = 0;     // Vertex shader invocations
+        uint64_t clippingPrimitives = 0;    // Primitives that left clipping
+        uint64_t fragmentInvocations = 0;   // Fragment shader invocations
+        uint64_t computeInvocations = 0;    // Compute shader invocations
+
+        PipelineStatistics& operator+=(const PipelineStatistics& other)
         {
-            std::stringstream ss;
-            ss << std::fixed << std::setprecision(3)
-                << frameNumber << ","
-                << frameTime << ","
-                << depthPrepassTime << ","
-                << shadowPassTime << ","
-                << geometryPassTime << ","
-                << lightingPassTime << ","
-                << volumetricPassTime << ","
-                << blitPassTime << ","
-                << totalGpuTime << ","
-                << cpuOverhead << ","
-                << fps << ","
-                << triangleCount << ","
-                << drawCalls;
-            return ss.str();
+            inputVertices += other.inputVertices;
+            inputPrimitives += other.inputPrimitives;
+            vertexInvocations += other.vertexInvocations;
+            clippingPrimitives += other.clippingPrimitives;
+            fragmentInvocations += other.fragmentInvocations;
+            computeInvocations += other.computeInvocations;
+            return *this;
         }
     };
 
+    // Records per-frame metrics of the passes & counters registered with it, the CSV columns follow the registration.
+    //  - a pass is a CPU recording & a GPU time column plus its pipeline statistics, several render graph passes can
+    //    be aliased to one, the names are interned once so recording only deals in ids,
+    //  - a counter is any other per-frame value, set once per frame,
+    //  - the frames go into a buffer sized by StartRecording, recording never allocates, locks or looks up names,
+    //    FindPass resolves a name once, e.g. when the render graph pass is added.
+    //    Registration & recording happen on the render thread, the finished frames can be read from any thread.
     class PerformanceTimer
     {
     public:
-        PerformanceTimer();
+        using MetricId = uint16_t;
+        static constexpr MetricId INVALID_METRIC = 0xFFFF;
+        static constexpr size_t MAX_PASSES = 16;
+        static constexpr size_t MAX_COUNTERS = 32;
+
+        // frame time histogram of the summary, the last bucket also counts every longer frame
+        static constexpr size_t HISTOGRAM_BUCKETS = 64;
+        static constexpr double HISTOGRAM_BUCKET_MS = 0.5;
+        // a frame is a stutter when it takes this many times the median frame time
+        static constexpr double STUTTER_FACTOR = 2.0;
+
+        PerformanceTimer() = default;
         ~PerformanceTimer() = default;
 
+        // Registry
+        // the same name returns the same id, its columns are <name>CPU(ms) & <name>GPU(ms)
+        MetricId RegisterPass(const std::string& name);
+        // the render graph pass is measured as part of pass
+        void AddPassAlias(const std::string& renderGraphPass, MetricId pass);
+        // INVALID_METRIC for passes that are not measured, hashes the name so keep the id rather than calling it per pass
+        MetricId FindPass(const std::string& name) const
+        {
+            const auto it = m_PassIds.find(name);
+            return it == m_PassIds.end() ? INVALID_METRIC : it->second;
+        }
+        // column is the CSV header, e.g. "Barriers" or "InputLatency(ms)"
+        MetricId RegisterCounter(const std::string& column);
+
         // Start recording first N frames
         void StartRecording(uint32_t maxFrames = 1000);
         void StopRecording();
 
         // Frame timing
-        void BeginFrame() ;
+        void BeginFrame();
         void EndFrame();
 
-        // Pass timing (GPU passes)
-        void BeginPass(const std::string& passName);
-        void EndPass(const std::string& passName);
-
-        // Set additional metrics
-        void SetTriangleCount(uint32_t count) {
-            std::lock_guard<std::mutex> lock(m_Mutex);
-            if (m_IsRecording && m_CurrentFrameMetrics.frameNumber <= m_MaxFrames) {
-                m_CurrentFrameMetrics.triangleCount = count;
-            }
+        // Pass timing, CPU recording
+        void BeginPass(MetricId pass)
+        {
+            if (pass != INVALID_METRIC && IsRecordingFrame())
+                m_PassStarts[pass] = std::chrono::high_resolution_clock::now();
+        }
+        void EndPass(MetricId pass)
+        {
+            if (pass != INVALID_METRIC && IsRecordingFrame())
+                m_CurrentFrame->cpuTimes[pass] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_PassStarts[pass]).count();
+        }
+        // GPU execution read back from the timestamp & statistics queries, see FrameSubmitter
+        void AddPassGpuResults(MetricId pass, double gpuMs, const PipelineStatistics& statistics)
+        {
+            if (pass == INVALID_METRIC || !IsRecordingFrame()) return;
+            m_CurrentFrame->gpuTimes[pass] += gpuMs;
+            m_CurrentFrame->statistics[pass] += statistics;
         }
 
-        void SetDrawCalls(uint32_t calls) {
-            std::lock_guard<std::mutex> lock(m_Mutex);
-            if (m_IsRecording && m_CurrentFrameMetrics.frameNumber <= m_MaxFrames) {
-                m_CurrentFrameMetrics.drawCalls = calls;
-            }
+        void SetCounter(MetricId counter, double value)
+        {
+            if (counter != INVALID_METRIC && IsRecordingFrame())
+                m_CurrentFrame->counters[counter] = value;
+        }
+        // see CameraPath, rows of the same path time show the same view
+        void SetCameraPathTime(double seconds)
+        {
+            if (IsRecordingFrame())
+                m_CurrentFrame->cameraPathTime = seconds;
         }
 
         // Save results
@@ -93,45 +123,66 @@ namespace cat
         void ToggleRecording(uint32_t maxFrames = 1000);
 
     private:
-        std::mutex m_Mutex;
-
-        // Recording state
-        std::atomic<bool> m_IsRecording{ false };
-        std::atomic<uint32_t> m_MaxFrames{ 1000 };
-        std::atomic<uint32_t> m_FrameCount{ 0 };
-
-        // Timing data
-        FrameMetrics m_CurrentFrameMetrics;
-        std::vector<FrameMetrics> m_FrameMetrics;
-
-        // Timers
-        std::chrono::high_resolution_clock::time_point m_FrameStart;
-        std::chrono::high_resolution_clock::time_point m_PassStart;
+        // one per frame, the slots are indexed by the metric ids
+        struct FrameRecord
+        {
+            uint32_t frameNumber = 0;
+            double frameTime = 0.0;         // Total frame time (ms)
+            double cameraPathTime = -1.0;   // Camera path time (s), negative without a path
+            std::array<double, MAX_PASSES> cpuTimes{};
+            std::array<double, MAX_PASSES> gpuTimes{};     // of the last frame that finished
+            std::array<PipelineStatistics, MAX_PASSES> statistics{};
+            std::array<double, MAX_COUNTERS> counters{};
+        };
 
-        // Current pass tracking
-        std::string m_CurrentPassName;
+        // a CSV column of the frame rows, see GetColumns
+        struct Column
+        {
+            std::string name;
+            double (*get)(const FrameRecord& frame, MetricId id, const PerformanceTimer& timer);
+            MetricId id = INVALID_METRIC;
+        };
 
         // Statistics for summary
         struct SummaryStats
         {
-            double avgFrameTime = 0.0;
-            double minFrameTime = std::numeric_limits<double>::max();
-            double maxFrameTime = 0.0;
-            double avgFPS = 0.0;
-            double totalTime = 0.0;
-
-            // Per-pass averages
-            double avgDepthTime = 0.0;
-            double avgShadowTime = 0.0;
-            double avgGeometryTime = 0.0;
-            double avgLightingTime = 0.0;
-            double avgVolumetricTime = 0.0;
-            double avgBlitTime = 0.0;
+            // per column of GetColumns
+            std::vector<double> averages;
+            std::vector<double> minimums;
+            std::vector<double> maximums;
+            std::vector<double> deviations;
+            std::vector<Percentiles> percentiles;
+
+            std::array<uint32_t, HISTOGRAM_BUCKETS> frameTimeHistogram{};
+            uint32_t stutterFrames = 0;     // over STUTTER_FACTOR x the median frame time
+
+            // summed, divided by the frame count when written
+            PipelineStatistics totalStatistics;
+            std::array<PipelineStatistics, MAX_PASSES> totalPassStatistics{};
         };
 
-        SummaryStats CalculateSummary() const;
+        bool IsRecordingFrame() const { return m_CurrentFrame != nullptr; }
+        double GetTotalCpuTime(const FrameRecord& frame) const;
+        double GetTotalGpuTime(const FrameRecord& frame) const;
+        std::vector<Column> GetColumns() const;
+        SummaryStats CalculateSummary(const std::vector<Column>& columns) const;
 
-        // Helper to map pass names to metrics
-        double* GetPassMetricPtr(const std::string& passName);
+        // Recording state
+        std::atomic<bool> m_IsRecording{ false };
+        std::atomic<uint32_t> m_MaxFrames{ 1000 };
+        std::atomic<uint32_t> m_FrameCount{ 0 };   // published after the frame's record is complete
+
+        // Registry
+        std::vector<std::string> m_PassNames;
+        std::unordered_map<std::string, MetricId> m_PassIds;   // names & aliases
+        std::vector<std::string> m_CounterNames;
+
+        // Timing data, sized once by StartRecording
+        std::vector<FrameRecord> m_Frames;
+        FrameRecord* m_CurrentFrame = nullptr;     // while a recorded frame is between BeginFrame & EndFrame
+
+        // Timers
+        std::chrono::high_resolution_clock::time_point m_FrameStart;
+        std::array<std::chrono::high_resolution_clock::time_point, MAX_PASSES> m_PassStarts{};
     };
-}
\ No newline at end of file
+}
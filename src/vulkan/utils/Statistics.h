@@ -0,0 +1,56 @@
+// Statistics.h
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace cat
+{
+	// Distribution of a per-frame metric, shared by PerformanceTimer & the catnip_compare tool
+	struct Percentiles
+	{
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double p999 = 0.0;
+	};
+
+	// p in [0, 1], linear between the closest ranks, values has to be sorted
+	inline double GetPercentile(const std::vector<double>& sortedValues, double p)
+	{
+		if (sortedValues.empty()) return 0.0;
+
+		const double rank = p * static_cast<double>(sortedValues.size() - 1);
+		const size_t lower = static_cast<size_t>(std::floor(rank));
+		const size_t upper = std::min(lower + 1, sortedValues.size() - 1);
+		return sortedValues[lower] + (sortedValues[upper] - sortedValues[lower]) * (rank - static_cast<double>(lower));
+	}
+
+	inline Percentiles CalculatePercentiles(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return { GetPercentile(values, 0.5), GetPercentile(values, 0.9), GetPercentile(values, 0.95),
+			GetPercentile(values, 0.99), GetPercentile(values, 0.999) };
+	}
+
+	inline double CalculateMean(const std::vector<double>& values)
+	{
+		return values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+	}
+
+	// sample variance, divided by n - 1
+	inline double CalculateVariance(const std::vector<double>& values)
+	{
+		if (values.size() < 2) return 0.0;
+
+		const double mean = CalculateMean(values);
+		double sum = 0.0;
+		for (double value : values)
+		{
+			sum += (value - mean) * (value - mean);
+		}
+		return sum / static_cast<double>(values.size() - 1);
+	}
+}